@@ -0,0 +1,412 @@
+/**
+ * Command-line encoder and decoder, a drop-in for the base64 tool of GNU
+ * coreutils on the options they share:
+ *
+ *     b64 [-d] [-u] [-w COLS] [-o OUTPUT] [FILE]
+ *
+ * -d decodes instead of encoding, -u uses the URL and filename safe alphabet,
+ * -w wraps the encoded lines after COLS characters (76 by default, 0 for no
+ * wrapping) and -o writes to OUTPUT instead of standard output. Without FILE,
+ * or when FILE is -, reads standard input. Decoding ignores newlines, and
+ * carries on after padding with the next encoding, as in concatenated files.
+ * Unlike coreutils, it also accepts a last group without its padding.
+ *
+ * Regular files are mapped in memory and read sequentially. Given the size of
+ * the input, OUTPUT is preallocated and mapped as well, and the codecs write
+ * straight into it; otherwise the output goes out in large writes. Every
+ * block runs through the parallel codecs.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base64.h"
+
+// Bytes encoded, and characters decoded, at a time. Large enough to be split
+// between several threads.
+#define ENCODE_BLOCK ((size_t)3 << 22)
+#define DECODE_BLOCK ((size_t)4 << 22)
+
+// Largest output of a block: an encoded one wrapped every character.
+#define OUTPUT_BUFFER (2 * (DECODE_BLOCK + 1))
+
+static void die(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "b64: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+static void *xmalloc(size_t size)
+{
+    void *memory = malloc(size);
+    if (!memory)
+        die("out of memory");
+    return memory;
+}
+
+// Either a regular file mapped in memory, or a file descriptor read one block
+// at a time into `buffer`.
+struct input {
+    int fd;
+    const char *map;
+    size_t size;
+    size_t offset;
+    char *buffer;
+};
+
+static void input_open(struct input *in, const char *path)
+{
+    *in = (struct input) { STDIN_FILENO, NULL, 0, 0, NULL };
+    if (path && strcmp(path, "-") != 0) {
+        in->fd = open(path, O_RDONLY);
+        if (in->fd < 0)
+            die("%s: %s", path, strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(in->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            in->map  = map;
+            in->size = st.st_size;
+            return;
+        }
+    }
+    in->buffer = xmalloc(DECODE_BLOCK);
+}
+
+// Returns the size of the next block of at most `size` bytes, stored in
+// `block`, or 0 at the end of the input. Every block but the last is full.
+static size_t input_read(struct input *in, size_t size, const char **block)
+{
+    if (in->map) {
+        if (size > in->size - in->offset)
+            size = in->size - in->offset;
+        *block = in->map + in->offset;
+        in->offset += size;
+        return size;
+    }
+
+    size_t filled = 0;
+    while (filled < size) {
+        ssize_t count = read(in->fd, in->buffer + filled, size - filled);
+        if (count == 0)
+            break;
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            die("read error: %s", strerror(errno));
+        }
+        filled += count;
+    }
+    *block = in->buffer;
+    return filled;
+}
+
+static void input_close(struct input *in)
+{
+    if (in->map)
+        munmap((void *)in->map, in->size);
+    free(in->buffer);
+    if (in->fd != STDIN_FILENO)
+        close(in->fd);
+}
+
+// Either a file preallocated and mapped in memory, written up to `size`, or a
+// file descriptor written through `buffer`.
+struct output {
+    int fd;
+    char *map;
+    size_t capacity;
+    size_t size;
+    char *buffer;
+    size_t buffered;
+};
+
+// Opens `path`, or standard output if NULL. Maps it if `capacity`, an upper
+// bound of the size of the output, is known and not 0.
+static void output_open(struct output *out, const char *path, size_t capacity)
+{
+    *out = (struct output) { STDOUT_FILENO, NULL, 0, 0, NULL, 0 };
+    if (path) {
+        out->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (out->fd < 0)
+            die("%s: %s", path, strerror(errno));
+
+        if (capacity > 0
+            && (posix_fallocate(out->fd, 0, capacity) == 0
+                || ftruncate(out->fd, capacity) == 0)) {
+            void *map = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+                MAP_SHARED, out->fd, 0);
+            if (map != MAP_FAILED) {
+                posix_madvise(map, capacity, POSIX_MADV_SEQUENTIAL);
+                out->map      = map;
+                out->capacity = capacity;
+                return;
+            }
+        }
+    }
+    out->buffer = xmalloc(OUTPUT_BUFFER);
+}
+
+static void write_all(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = write(fd, data, size);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            die("write error: %s", strerror(errno));
+        }
+        data += count;
+        size -= count;
+    }
+}
+
+static void output_flush(struct output *out)
+{
+    write_all(out->fd, out->buffer, out->buffered);
+    out->buffered = 0;
+}
+
+// Returns where to write the next `size` bytes of the output, at most
+// OUTPUT_BUFFER, then handed over to output_commit().
+static char *output_reserve(struct output *out, size_t size)
+{
+    if (out->map) {
+        if (size > out->capacity - out->size)
+            die("output larger than expected");
+        return out->map + out->size;
+    }
+    if (size > OUTPUT_BUFFER - out->buffered)
+        output_flush(out);
+    return out->buffer + out->buffered;
+}
+
+static void output_commit(struct output *out, size_t size)
+{
+    if (out->map)
+        out->size += size;
+    else
+        out->buffered += size;
+}
+
+static void output_close(struct output *out)
+{
+    if (out->map) {
+        munmap(out->map, out->capacity);
+        if (out->size < out->capacity && ftruncate(out->fd, out->size) != 0)
+            die("write error: %s", strerror(errno));
+    } else {
+        output_flush(out);
+    }
+    free(out->buffer);
+    if (out->fd != STDOUT_FILENO && close(out->fd) != 0)
+        die("write error: %s", strerror(errno));
+}
+
+// Exact size of the encoding of `length` bytes, wrapped every `columns`
+// characters, with a newline ending the last line.
+static size_t wrapped_length(
+    const struct base64_alphabet *alphabet, size_t length, size_t columns)
+{
+    size_t chars = base64_encoded_length_with(alphabet, length);
+    return columns ? chars + (chars + columns - 1) / columns : chars;
+}
+
+static void encode_file(struct input *in, struct output *out,
+    const struct base64_alphabet *alphabet, size_t columns)
+{
+    char *encoded = columns ? xmalloc(DECODE_BLOCK) : NULL;
+    size_t column = 0;
+    const char *block;
+    size_t length;
+
+    while ((length = input_read(in, ENCODE_BLOCK, &block)) > 0) {
+        size_t chars = base64_encoded_length_with(alphabet, length);
+        if (!columns) {
+            char *text = output_reserve(out, chars);
+            base64_encode_parallel_with(
+                alphabet, (const uint8_t *)block, length, text, chars, 0);
+            output_commit(out, chars);
+            continue;
+        }
+
+        // Encode the block as a whole, then cut it into lines.
+        base64_encode_parallel_with(
+            alphabet, (const uint8_t *)block, length, encoded, chars, 0);
+        char *text = output_reserve(out, chars + (column + chars) / columns);
+        char *line = text;
+        for (size_t i = 0; i < chars;) {
+            size_t count = columns - column;
+            if (count > chars - i)
+                count = chars - i;
+            memcpy(line, encoded + i, count);
+            line += count;
+            i += count;
+            column += count;
+            if (column == columns) {
+                *line++ = '\n';
+                column  = 0;
+            }
+        }
+        output_commit(out, line - text);
+    }
+
+    if (column > 0) {
+        *output_reserve(out, 1) = '\n';
+        output_commit(out, 1);
+    }
+    free(encoded);
+}
+
+// Flushes the last group of an encoding, which `decoder` is then ready to
+// follow with another.
+static void decode_final(struct base64_decoder *decoder, struct output *out)
+{
+    uint8_t *data = (uint8_t *)output_reserve(out, 2);
+    size_t bytes  = base64_decoder_final(decoder, data, 2);
+    if (bytes == BASE64_ERROR)
+        die("invalid input");
+    output_commit(out, bytes);
+}
+
+// Decodes joined lines. Padding that completes a group ends an encoding, and
+// another may follow it, as in concatenated files.
+static void decode_text(struct base64_decoder *decoder, struct output *out,
+    const char *text, size_t length)
+{
+    char padding = decoder->alphabet->padding;
+
+    while (length > 0) {
+        if (decoder->padding > 0 && decoder->carried + decoder->padding == 4)
+            decode_final(decoder, out);
+
+        // Up to the end of the next run of padding.
+        const char *end = padding ? memchr(text, padding, length) : NULL;
+        size_t chars    = end ? (size_t)(end - text) : length;
+        while (chars < length && text[chars] == padding)
+            chars++;
+
+        size_t bytes  = base64_decoder_update_length(decoder, chars);
+        uint8_t *data = (uint8_t *)output_reserve(out, bytes);
+        bytes = base64_decoder_update_parallel(
+            decoder, text, chars, data, bytes, 0);
+        if (bytes == BASE64_ERROR)
+            die("invalid input");
+        output_commit(out, bytes);
+        text += chars;
+        length -= chars;
+    }
+}
+
+static void decode_file(struct input *in, struct output *out,
+    const struct base64_alphabet *alphabet)
+{
+    struct base64_decoder decoder;
+    base64_decoder_init_with(&decoder, alphabet);
+    char *joined = xmalloc(DECODE_BLOCK);
+    const char *block;
+    size_t length;
+
+    while ((length = input_read(in, DECODE_BLOCK, &block)) > 0) {
+        // Join the lines of the block, unless it's a single one.
+        const char *text = block;
+        const char *end  = memchr(block, '\n', length);
+        if (end) {
+            char *next = joined;
+            for (const char *line = block; line < block + length;) {
+                end = memchr(line, '\n', block + length - line);
+                if (!end)
+                    end = block + length;
+                memcpy(next, line, end - line);
+                next += end - line;
+                line = end + 1;
+            }
+            text   = joined;
+            length = next - joined;
+        }
+        decode_text(&decoder, out, text, length);
+    }
+
+    decode_final(&decoder, out);
+    free(joined);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: b64 [-d] [-u] [-w COLS] [-o OUTPUT] [FILE]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const struct base64_alphabet *alphabet = &base64_standard;
+    const char *output                     = NULL;
+    size_t columns                         = 76;
+    bool decoding                          = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "duw:o:")) != -1) {
+        switch (option) {
+        case 'd':
+            decoding = true;
+            break;
+        case 'u':
+            alphabet = &base64_url;
+            break;
+        case 'w': {
+            char *end;
+            errno   = 0;
+            columns = strtoull(optarg, &end, 10);
+            if (errno || end == optarg || *end || optarg[0] == '-')
+                die("invalid wrap size: %s", optarg);
+            break;
+        }
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (argc - optind > 1)
+        usage();
+
+    struct input in;
+    struct output out;
+    input_open(&in, argv[optind]);
+
+    // The size of the output is only known for mapped inputs: exactly when
+    // encoding, at most when decoding, plus the room reserved for
+    // base64_decoder_final().
+    size_t capacity = 0;
+    if (in.map)
+        capacity = decoding ? base64_decoded_max_length(in.size) + 2
+                            : wrapped_length(alphabet, in.size, columns);
+    output_open(&out, output, capacity);
+
+    if (decoding)
+        decode_file(&in, &out, alphabet);
+    else
+        encode_file(&in, &out, alphabet, columns);
+
+    output_close(&out);
+    input_close(&in);
+    return 0;
+}
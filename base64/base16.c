@@ -0,0 +1,231 @@
+/**
+ * Base16 codec. The scalar kernel computes every digit, the wide one looks
+ * whole bytes up in tables, the SIMD ones are in base16_simd.c.
+ */
+
+#include <string.h>
+
+#include "base16.h"
+#include "base64.h"
+#include "base64_simd.h"
+
+static const char upper_digits[] = "0123456789ABCDEF";
+static const char lower_digits[] = "0123456789abcdef";
+
+// Digits of every byte, and bits of every digit shifted into place as the
+// high or the low half of a byte. Anything but a digit sets bit 8.
+#define DIGIT_(v, a) ((v) < 10 ? '0' + (v) : (a) + (v) - 10)
+#define VALUE_(c)                                                             \
+    ((c) >= '0' && (c) <= '9'         ? (c) - '0'                             \
+            : (c) >= 'A' && (c) <= 'F' ? (c) - 'A' + 10                       \
+            : (c) >= 'a' && (c) <= 'f' ? (c) - 'a' + 10                       \
+                                       : -1)
+#define PAIR_(x, n, a) { DIGIT_(((x) + (n)) >> 4, a), DIGIT_((n), a) }
+#define HIGH_(x, n, a) (VALUE_((x) + (n)) < 0 ? 0x100 : VALUE_((x) + (n)) << 4)
+#define LOW_(x, n, a) (VALUE_((x) + (n)) < 0 ? 0x100 : VALUE_((x) + (n)))
+#define ROW_(m, n, a) FOR16_B_(m, (n) * 16, a)
+#define TABLE_(m, a) FOR16_A_(ROW_, m, a)
+
+// Expand to m(x, n, a) for every n from 0 to 15. There are two copies, since
+// a macro can't expand to itself.
+#define FOR16_A_(m, x, a)                                                     \
+    m(x, 0, a), m(x, 1, a), m(x, 2, a), m(x, 3, a), m(x, 4, a), m(x, 5, a),   \
+        m(x, 6, a), m(x, 7, a), m(x, 8, a), m(x, 9, a), m(x, 10, a),          \
+        m(x, 11, a), m(x, 12, a), m(x, 13, a), m(x, 14, a), m(x, 15, a)
+#define FOR16_B_(m, x, a)                                                     \
+    m(x, 0, a), m(x, 1, a), m(x, 2, a), m(x, 3, a), m(x, 4, a), m(x, 5, a),   \
+        m(x, 6, a), m(x, 7, a), m(x, 8, a), m(x, 9, a), m(x, 10, a),          \
+        m(x, 11, a), m(x, 12, a), m(x, 13, a), m(x, 14, a), m(x, 15, a)
+
+static const char upper_pairs[256][2] = { TABLE_(PAIR_, 'A') };
+static const char lower_pairs[256][2] = { TABLE_(PAIR_, 'a') };
+static const uint16_t high_values[256] = { TABLE_(HIGH_, 0) };
+static const uint16_t low_values[256]  = { TABLE_(LOW_, 0) };
+
+static int digit_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+// The kernels, see base64_simd.h for their contract.
+static size_t scalar_encode(
+    const char *digits, const unsigned char *in, size_t len, char *out)
+{
+    for (size_t i = 0; i < len; i++) {
+        *out++ = digits[in[i] >> 4];
+        *out++ = digits[in[i] & 15];
+    }
+    return len;
+}
+
+static size_t scalar_decode(const char *in, size_t len, unsigned char *out)
+{
+    size_t done;
+    for (done = 0; len - done >= 2; done += 2) {
+        int high = digit_value(in[done]);
+        int low  = digit_value(in[done + 1]);
+        if ((high | low) < 0)
+            break;
+        *out++ = (unsigned char)(high << 4 | low);
+    }
+    return done;
+}
+
+static size_t wide_encode(
+    const char *digits, const unsigned char *in, size_t len, char *out)
+{
+    const char(*pairs)[2] = digits == upper_digits ? upper_pairs : lower_pairs;
+    for (size_t i = 0; i < len; i++)
+        memcpy(out + 2 * i, pairs[in[i]], 2);
+    return len;
+}
+
+static inline unsigned decode_pair(const char *in)
+{
+    return high_values[(unsigned char)in[0]] | low_values[(unsigned char)in[1]];
+}
+
+static size_t wide_decode(const char *in, size_t len, unsigned char *out)
+{
+    size_t done;
+    // Four bytes per step, with a single test for invalid digits.
+    for (done = 0; len - done >= 8; done += 8, out += 4) {
+        unsigned a = decode_pair(in + done);
+        unsigned b = decode_pair(in + done + 2);
+        unsigned c = decode_pair(in + done + 4);
+        unsigned d = decode_pair(in + done + 6);
+        if ((a | b | c | d) > 255)
+            break;
+        out[0] = (unsigned char)a;
+        out[1] = (unsigned char)b;
+        out[2] = (unsigned char)c;
+        out[3] = (unsigned char)d;
+    }
+    return done + scalar_decode(in + done, len - done, out);
+}
+
+struct kernel {
+    size_t (*encode)(
+        const char *digits, const unsigned char *in, size_t len, char *out);
+    size_t (*decode)(const char *in, size_t len, unsigned char *out);
+};
+
+static const struct kernel kernels[BASE64_KERNELS] = {
+    [BASE64_SCALAR] = { scalar_encode, scalar_decode },
+    [BASE64_WIDE]   = { wide_encode, wide_decode },
+#ifdef BASE64_X86
+    [BASE64_SSSE3]  = { base16_encode_ssse3, base16_decode_ssse3 },
+    [BASE64_AVX2]   = { base16_encode_avx2, base16_decode_avx2 },
+    [BASE64_AVX512] = { base16_encode_avx512, base16_decode_avx512 },
+#endif
+};
+
+// Encodes `length` bytes with the active kernel, the wide one finishing what
+// the vector kernels leave.
+static void encode_bulk(
+    const char *digits, const uint8_t *input, size_t length, char *output)
+{
+    const struct kernel *kernel = &kernels[base64_get_kernel()];
+    size_t done                 = kernel->encode(digits, input, length, output);
+    wide_encode(digits, input + done, length - done, output + 2 * done);
+}
+
+// Decodes the longest prefix of `input` made of digits, and returns the
+// number of digits consumed, always even.
+static size_t decode_valid(const char *input, size_t length, uint8_t *output)
+{
+    const struct kernel *kernel = &kernels[base64_get_kernel()];
+    size_t done                 = kernel->decode(input, length, output);
+    return done + wide_decode(input + done, length - done, output + done / 2);
+}
+
+size_t base16_encoded_length(size_t length)
+{
+    return length * 2;
+}
+
+size_t base16_decoded_length(size_t length)
+{
+    return length % 2 ? BASE16_ERROR : length / 2;
+}
+
+size_t base16_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    if (capacity < base16_encoded_length(length))
+        return BASE16_ERROR;
+    encode_bulk(upper_digits, input, length, output);
+    return base16_encoded_length(length);
+}
+
+size_t base16_encode_lower(
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    if (capacity < base16_encoded_length(length))
+        return BASE16_ERROR;
+    encode_bulk(lower_digits, input, length, output);
+    return base16_encoded_length(length);
+}
+
+size_t base16_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    size_t result_length = base16_decoded_length(length);
+    if (result_length == BASE16_ERROR || capacity < result_length
+        || decode_valid(input, length, output) != length)
+        return BASE16_ERROR;
+    return result_length;
+}
+
+void base16_decoder_init(struct base16_decoder *decoder)
+{
+    decoder->carried = false;
+}
+
+size_t base16_decoder_update_length(
+    const struct base16_decoder *decoder, size_t length)
+{
+    return (decoder->carried + length) / 2;
+}
+
+size_t base16_decoder_update(struct base16_decoder *decoder,
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    size_t result_length = base16_decoder_update_length(decoder, length);
+    if (capacity < result_length)
+        return BASE16_ERROR;
+
+    // Complete the byte left over by the previous chunk first.
+    if (decoder->carried && length > 0) {
+        char pair[2] = { decoder->carry, *input++ };
+        if (decode_valid(pair, 2, output++) != 2)
+            return BASE16_ERROR;
+        decoder->carried = false;
+        length--;
+    }
+
+    size_t bulk = length / 2 * 2;
+    if (decode_valid(input, bulk, output) != bulk)
+        return BASE16_ERROR;
+
+    if (bulk < length) {
+        if (digit_value(input[bulk]) < 0)
+            return BASE16_ERROR;
+        decoder->carry   = input[bulk];
+        decoder->carried = true;
+    }
+    return result_length;
+}
+
+size_t base16_decoder_final(struct base16_decoder *decoder)
+{
+    if (decoder->carried)
+        return BASE16_ERROR;
+    return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * Base16 (hex) codec of RFC 4648, on the same kernels as the base64 one: the
+ * fastest supported by the CPU, switched with base64_set_kernel().
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef BASE16_H
+#define BASE16_H
+
+// Returned by the codecs below when the output doesn't fit or the input is
+// malformed.
+#define BASE16_ERROR ((size_t)-1)
+
+// Exact number of characters base16_encode() writes for `length` bytes.
+size_t base16_encoded_length(size_t length);
+
+// Exact number of bytes base16_decode() writes for `length` characters, or
+// BASE16_ERROR if it's odd.
+size_t base16_decoded_length(size_t length);
+
+// Encode `length` bytes into `output`, which holds `capacity` characters, and
+// return the number of characters written. base16_encode() writes the upper
+// case digits of RFC 4648, base16_encode_lower() the lower case ones. Nothing
+// is allocated and no NUL terminator is written.
+size_t base16_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+size_t base16_encode_lower(
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+
+// Decode `length` digits of either case into `output`, which holds `capacity`
+// bytes, and return the number of bytes written. Returns BASE16_ERROR if the
+// input holds anything else, or an odd number of digits.
+size_t base16_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+
+// Streaming decoder, for inputs arriving in chunks of any size: each update
+// decodes as much of the chunk as possible and carries a digit left at its
+// end over to the next one. The functions return the number of bytes
+// written, or BASE16_ERROR if they don't fit in `capacity` or the input is
+// invalid. Encoding carries nothing over, so base16_encode() already streams.
+struct base16_decoder {
+    char carry;
+    bool carried;
+};
+
+void base16_decoder_init(struct base16_decoder *decoder);
+size_t base16_decoder_update_length(
+    const struct base16_decoder *decoder, size_t length);
+size_t base16_decoder_update(struct base16_decoder *decoder,
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+// Writes nothing, fails if a digit is left over.
+size_t base16_decoder_final(struct base16_decoder *decoder);
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * SSSE3, AVX2 and AVX-512 base16 kernels, compiled like the base64 ones.
+ *
+ * Encoding splits every byte into its two nibbles, side by side, and
+ * translates them with a 16-entry shuffle lookup of the digits. Decoding
+ * finds the digits and the letters of either case with unsigned comparisons,
+ * which also validate the input, and a multiply-add joins every pair of
+ * nibbles back into a byte.
+ */
+
+#include "base64_simd.h"
+
+#ifdef BASE64_X86
+
+#include <immintrin.h>
+
+#define SSSE3 __attribute__((target("ssse3")))
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
+/*
+ * SSSE3
+ */
+
+SSSE3 size_t base16_encode_ssse3(
+    const char *digits, const unsigned char *in, size_t len, char *out)
+{
+    __m128i table = _mm_loadu_si128((const __m128i *)digits);
+    __m128i mask  = _mm_set1_epi8(0x0f);
+    size_t i      = 0;
+
+    for (; len - i >= 16; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i high  = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+        __m128i low   = _mm_and_si128(bytes, mask);
+        high          = _mm_shuffle_epi8(table, high);
+        low           = _mm_shuffle_epi8(table, low);
+        _mm_storeu_si128(
+            (__m128i *)(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(
+            (__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    return i;
+}
+
+// Returns the values of 16 digits, and sets the bytes of `valid` holding one.
+SSSE3 static inline __m128i decode_digits(__m128i in, __m128i *valid)
+{
+    __m128i digit  = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+    __m128i letter = _mm_sub_epi8(
+        _mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i is_digit
+        = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i is_letter
+        = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+
+    *valid = _mm_or_si128(is_digit, is_letter);
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+        _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+SSSE3 size_t base16_decode_ssse3(const char *in, size_t len, unsigned char *out)
+{
+    // Every 16-bit pair of nibbles becomes high * 16 + low.
+    __m128i weights = _mm_set1_epi16(0x0110);
+    size_t i        = 0;
+
+    for (; len - i >= 32; i += 32) {
+        __m128i valid_a, valid_b;
+        __m128i a = decode_digits(
+            _mm_loadu_si128((const __m128i *)(in + i)), &valid_a);
+        __m128i b = decode_digits(
+            _mm_loadu_si128((const __m128i *)(in + i + 16)), &valid_b);
+        if (_mm_movemask_epi8(_mm_and_si128(valid_a, valid_b)) != 0xffff)
+            break;
+
+        a = _mm_maddubs_epi16(a, weights);
+        b = _mm_maddubs_epi16(b, weights);
+        _mm_storeu_si128((__m128i *)(out + i / 2), _mm_packus_epi16(a, b));
+    }
+    return i;
+}
+
+/*
+ * AVX2
+ */
+
+AVX2 size_t base16_encode_avx2(
+    const char *digits, const unsigned char *in, size_t len, char *out)
+{
+    __m256i table = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)digits));
+    size_t i = 0;
+
+    for (; len - i >= 16; i += 16) {
+        // Every byte widens to 16 bits, holding its high nibble in the first
+        // byte and its low one in the second.
+        __m256i bytes = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128((const __m128i *)(in + i)));
+        __m256i nibbles = _mm256_or_si256(_mm256_srli_epi16(bytes, 4),
+            _mm256_slli_epi16(
+                _mm256_and_si256(bytes, _mm256_set1_epi16(0x0f)), 8));
+        _mm256_storeu_si256((__m256i *)(out + 2 * i),
+            _mm256_shuffle_epi8(table, nibbles));
+    }
+    return i;
+}
+
+AVX2 static inline __m256i decode_digits_avx2(__m256i in, __m256i *valid)
+{
+    __m256i digit  = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+    __m256i letter = _mm256_sub_epi8(
+        _mm256_or_si256(in, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i is_digit = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    __m256i is_letter = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+
+    *valid = _mm256_or_si256(is_digit, is_letter);
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+        _mm256_and_si256(
+            is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+AVX2 size_t base16_decode_avx2(const char *in, size_t len, unsigned char *out)
+{
+    __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i        = 0;
+
+    for (; len - i >= 64; i += 64) {
+        __m256i valid_a, valid_b;
+        __m256i a = decode_digits_avx2(
+            _mm256_loadu_si256((const __m256i *)(in + i)), &valid_a);
+        __m256i b = decode_digits_avx2(
+            _mm256_loadu_si256((const __m256i *)(in + i + 32)), &valid_b);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid_a, valid_b)) != -1)
+            break;
+
+        // The packing works within 128-bit lanes, put them back in order.
+        __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights),
+            _mm256_maddubs_epi16(b, weights));
+        _mm256_storeu_si256((__m256i *)(out + i / 2),
+            _mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return i;
+}
+
+/*
+ * AVX-512
+ */
+
+AVX512 size_t base16_encode_avx512(
+    const char *digits, const unsigned char *in, size_t len, char *out)
+{
+    __m512i table
+        = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)digits));
+    size_t i = 0;
+
+    for (; len - i >= 32; i += 32) {
+        __m512i bytes = _mm512_cvtepu8_epi16(
+            _mm256_loadu_si256((const __m256i *)(in + i)));
+        __m512i nibbles = _mm512_or_si512(_mm512_srli_epi16(bytes, 4),
+            _mm512_slli_epi16(
+                _mm512_and_si512(bytes, _mm512_set1_epi16(0x0f)), 8));
+        _mm512_storeu_si512(out + 2 * i, _mm512_shuffle_epi8(table, nibbles));
+    }
+    return i;
+}
+
+// Returns the values of 64 digits, and sets the bits of `valid` of the bytes
+// holding one.
+AVX512 static inline __m512i decode_digits_avx512(
+    __m512i in, __mmask64 *valid)
+{
+    __m512i digit  = _mm512_sub_epi8(in, _mm512_set1_epi8('0'));
+    __m512i letter = _mm512_sub_epi8(
+        _mm512_or_si512(in, _mm512_set1_epi8(0x20)), _mm512_set1_epi8('a'));
+    __mmask64 is_digit = _mm512_cmple_epu8_mask(digit, _mm512_set1_epi8(9));
+    __mmask64 is_letter
+        = _mm512_cmple_epu8_mask(letter, _mm512_set1_epi8(5));
+
+    *valid = is_digit | is_letter;
+    return _mm512_mask_blend_epi8(
+        is_digit, _mm512_add_epi8(letter, _mm512_set1_epi8(10)), digit);
+}
+
+AVX512 size_t base16_decode_avx512(
+    const char *in, size_t len, unsigned char *out)
+{
+    __m512i weights = _mm512_set1_epi16(0x0110);
+    size_t i        = 0;
+
+    for (; len - i >= 64; i += 64) {
+        __mmask64 valid;
+        __m512i values
+            = decode_digits_avx512(_mm512_loadu_si512(in + i), &valid);
+        if (valid != ~(__mmask64)0)
+            break;
+
+        // Every byte ends up in the low half of a 16-bit lane, narrow them.
+        __m512i bytes = _mm512_maddubs_epi16(values, weights);
+        _mm256_storeu_si256(
+            (__m256i *)(out + i / 2), _mm512_cvtepi16_epi8(bytes));
+    }
+    return i;
+}
+
+#endif
@@ -0,0 +1,462 @@
+/**
+ * Base32 codecs. The scalar kernel works one byte or character at a time,
+ * the wide one reads and writes whole groups in 64-bit words and translates
+ * 10 bits at a time when encoding, the AVX-512 ones are in base32_simd.c.
+ */
+
+#include <string.h>
+
+#include "base32.h"
+#include "base64.h"
+#include "base64_simd.h"
+
+// Character of the value `v`, and value of the character `c`, in the standard
+// alphabet or the extended hex one, as constant expressions.
+#define CHAR_(v, hex)                                                         \
+    ((hex) ? ((v) < 10 ? '0' + (v) : 'A' + (v) - 10)                          \
+           : ((v) < 26 ? 'A' + (v) : '2' + (v) - 26))
+#define VALUE_(c, hex)                                                        \
+    ((hex) ? ((c) >= '0' && (c) <= '9'         ? (c) - '0'                    \
+                     : (c) >= 'A' && (c) <= 'V' ? (c) - 'A' + 10              \
+                                                : -1)                         \
+           : ((c) >= 'A' && (c) <= 'Z'         ? (c) - 'A'                    \
+                     : (c) >= '2' && (c) <= '7' ? (c) - '2' + 26              \
+                                                : -1))
+
+#define CHAR_AT_(x, v, hex) CHAR_(v, hex)
+#define VALUE_AT_(x, n, hex) VALUE_((x) + (n), hex)
+#define PAIR_(high, low, hex) { CHAR_(high, hex), CHAR_(low, hex) }
+#define PAIRS_(x, high, hex) FOR32_B_(PAIR_, high, hex)
+
+#define ALPHABET_(hex)                                                        \
+    {                                                                         \
+        { FOR32_A_(PAIRS_, 0, hex) }, { FOR32_A_(CHAR_AT_, 0, hex) },         \
+            { FOR32_A_(VALUE_AT_, 0, hex), FOR32_A_(VALUE_AT_, 32, hex),      \
+                FOR32_A_(VALUE_AT_, 64, hex), FOR32_A_(VALUE_AT_, 96, hex),   \
+                FOR32_A_(VALUE_AT_, 128, hex), FOR32_A_(VALUE_AT_, 160, hex), \
+                FOR32_A_(VALUE_AT_, 192, hex),                                \
+                FOR32_A_(VALUE_AT_, 224, hex) },                              \
+            '='                                                               \
+    }
+
+// Expand to m(x, n, hex) for every n from 0 to 31. There are two copies,
+// since a macro can't expand to itself.
+#define FOR32_A_(m, x, hex)                                                   \
+    m(x, 0, hex), m(x, 1, hex), m(x, 2, hex), m(x, 3, hex), m(x, 4, hex),     \
+        m(x, 5, hex), m(x, 6, hex), m(x, 7, hex), m(x, 8, hex), m(x, 9, hex), \
+        m(x, 10, hex), m(x, 11, hex), m(x, 12, hex), m(x, 13, hex),           \
+        m(x, 14, hex), m(x, 15, hex), m(x, 16, hex), m(x, 17, hex),           \
+        m(x, 18, hex), m(x, 19, hex), m(x, 20, hex), m(x, 21, hex),           \
+        m(x, 22, hex), m(x, 23, hex), m(x, 24, hex), m(x, 25, hex),           \
+        m(x, 26, hex), m(x, 27, hex), m(x, 28, hex), m(x, 29, hex),           \
+        m(x, 30, hex), m(x, 31, hex)
+#define FOR32_B_(m, x, hex)                                                   \
+    m(x, 0, hex), m(x, 1, hex), m(x, 2, hex), m(x, 3, hex), m(x, 4, hex),     \
+        m(x, 5, hex), m(x, 6, hex), m(x, 7, hex), m(x, 8, hex), m(x, 9, hex), \
+        m(x, 10, hex), m(x, 11, hex), m(x, 12, hex), m(x, 13, hex),           \
+        m(x, 14, hex), m(x, 15, hex), m(x, 16, hex), m(x, 17, hex),           \
+        m(x, 18, hex), m(x, 19, hex), m(x, 20, hex), m(x, 21, hex),           \
+        m(x, 22, hex), m(x, 23, hex), m(x, 24, hex), m(x, 25, hex),           \
+        m(x, 26, hex), m(x, 27, hex), m(x, 28, hex), m(x, 29, hex),           \
+        m(x, 30, hex), m(x, 31, hex)
+
+const struct base32_alphabet base32_standard = ALPHABET_(0);
+const struct base32_alphabet base32_hex      = ALPHABET_(1);
+
+// Characters holding the data of a last group of n bytes, and bytes held by a
+// last group of n characters, or -1 if there's no such group.
+static const size_t tail_chars[5] = { 0, 2, 4, 5, 7 };
+static const int tail_bytes[8]    = { 0, -1, 1, -1, 2, 3, -1, 4 };
+
+static void encode_group(const char *chars, const unsigned char *in, char *out)
+{
+    out[0] = chars[in[0] >> 3];
+    out[1] = chars[(in[0] & 7) << 2 | in[1] >> 6];
+    out[2] = chars[in[1] >> 1 & 31];
+    out[3] = chars[(in[1] & 1) << 4 | in[2] >> 4];
+    out[4] = chars[(in[2] & 15) << 1 | in[3] >> 7];
+    out[5] = chars[in[3] >> 2 & 31];
+    out[6] = chars[(in[3] & 3) << 3 | in[4] >> 5];
+    out[7] = chars[in[4] & 31];
+}
+
+// Returns false, writing nothing, if the group holds an invalid character.
+static bool decode_group(
+    const signed char *values, const char *in, unsigned char *out)
+{
+    int v[8], invalid = 0;
+    for (int i = 0; i < 8; i++)
+        invalid |= v[i] = values[(unsigned char)in[i]];
+    if (invalid < 0)
+        return false;
+
+    out[0] = (unsigned char)(v[0] << 3 | v[1] >> 2);
+    out[1] = (unsigned char)(v[1] << 6 | v[2] << 1 | v[3] >> 4);
+    out[2] = (unsigned char)(v[3] << 4 | v[4] >> 1);
+    out[3] = (unsigned char)(v[4] << 7 | v[5] << 2 | v[6] >> 3);
+    out[4] = (unsigned char)(v[6] << 5 | v[7]);
+    return true;
+}
+
+// The kernels, see base64_simd.h for their contract.
+static size_t scalar_encode(const struct base32_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    size_t done;
+    for (done = 0; len - done >= 5; done += 5, out += 8)
+        encode_group(alphabet->chars, in + done, out);
+    return done;
+}
+
+static size_t scalar_decode(const struct base32_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    size_t done;
+    for (done = 0; len - done >= 8; done += 8, out += 5)
+        if (!decode_group(alphabet->values, in + done, out))
+            break;
+    return done;
+}
+
+static size_t wide_encode(const struct base32_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    const char(*pairs)[2] = alphabet->pairs;
+    size_t done;
+
+    // Every step reads 8 bytes but only consumes 5.
+    for (done = 0; len - done >= 8; done += 5, out += 8) {
+        uint64_t word;
+        memcpy(&word, in + done, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        memcpy(out, pairs[word >> 54], 2);
+        memcpy(out + 2, pairs[word >> 44 & 0x3FF], 2);
+        memcpy(out + 4, pairs[word >> 34 & 0x3FF], 2);
+        memcpy(out + 6, pairs[word >> 24 & 0x3FF], 2);
+    }
+    return done;
+}
+
+static size_t wide_decode(const struct base32_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    const signed char *values = alphabet->values;
+    size_t done;
+
+    // Gather the 40 bits of every group in a word. An invalid character, -1,
+    // sets every bit above its own, so a single test finds it.
+    for (done = 0; len - done >= 8; done += 8, out += 5) {
+        const unsigned char *group = (const unsigned char *)in + done;
+        uint64_t word = (uint64_t)values[group[0]] << 35
+            | (uint64_t)values[group[1]] << 30
+            | (uint64_t)values[group[2]] << 25
+            | (uint64_t)values[group[3]] << 20
+            | (uint64_t)values[group[4]] << 15
+            | (uint64_t)values[group[5]] << 10
+            | (uint64_t)values[group[6]] << 5 | (uint64_t)values[group[7]];
+        if (word >> 40)
+            break;
+
+        word <<= 24;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        memcpy(out, &word, 5);
+    }
+    return done;
+}
+
+struct kernel {
+    size_t (*encode)(const struct base32_alphabet *alphabet,
+        const unsigned char *in, size_t len, char *out);
+    size_t (*decode)(const struct base32_alphabet *alphabet, const char *in,
+        size_t len, unsigned char *out);
+};
+
+// There are no SSSE3 and AVX2 kernels, the wide one stands in for them.
+static const struct kernel kernels[BASE64_KERNELS] = {
+    [BASE64_SCALAR] = { scalar_encode, scalar_decode },
+    [BASE64_WIDE]   = { wide_encode, wide_decode },
+    [BASE64_SSSE3]  = { wide_encode, wide_decode },
+    [BASE64_AVX2]   = { wide_encode, wide_decode },
+#ifdef BASE64_X86
+    [BASE64_AVX512] = { base32_encode_avx512, base32_decode_avx512 },
+#endif
+};
+
+static void encode_bulk(const struct base32_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output)
+{
+    const struct kernel *kernel = &kernels[base64_get_kernel()];
+    size_t done = kernel->encode(alphabet, input, length, output);
+    if (kernel != &kernels[BASE64_SCALAR])
+        done += wide_encode(
+            alphabet, input + done, length - done, output + done / 5 * 8);
+    done += scalar_encode(
+        alphabet, input + done, length - done, output + done / 5 * 8);
+    output += done / 5 * 8;
+
+    // Encode the last group as if completed with zeros, then pad it.
+    size_t tail = length - done;
+    if (tail > 0) {
+        unsigned char group[5] = { 0 };
+        char chars[8];
+        memcpy(group, input + done, tail);
+        encode_group(alphabet->chars, group, chars);
+        memcpy(output, chars, tail_chars[tail]);
+        memset(output + tail_chars[tail], alphabet->padding,
+            8 - tail_chars[tail]);
+    }
+}
+
+// Decodes the longest prefix of `input` made of whole groups of characters
+// from the alphabet, and returns the number of characters consumed.
+static size_t decode_valid(const struct base32_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output)
+{
+    const struct kernel *kernel = &kernels[base64_get_kernel()];
+    size_t done = kernel->decode(alphabet, input, length, output);
+    return done
+        + wide_decode(
+            alphabet, input + done, length - done, output + done / 8 * 5);
+}
+
+// Decodes the `count` characters of a last group, as if completed with zeros.
+static bool decode_tail(const struct base32_alphabet *alphabet,
+    const char *input, size_t count, uint8_t *output)
+{
+    char group[8];
+    unsigned char bytes[5];
+    memset(group, alphabet->chars[0], sizeof(group));
+    memcpy(group, input, count);
+    if (!decode_group(alphabet->values, group, bytes))
+        return false;
+    memcpy(output, bytes, tail_bytes[count]);
+    return true;
+}
+
+static size_t unpadded_length(
+    const struct base32_alphabet *alphabet, const char *input, size_t length)
+{
+    for (int i = 0;
+         i < 6 && length > 0 && input[length - 1] == alphabet->padding; i++)
+        length--;
+    return length;
+}
+
+size_t base32_encoded_length(size_t length)
+{
+    return (length + 4) / 5 * 8;
+}
+
+size_t base32_decoded_length_with(
+    const struct base32_alphabet *alphabet, const char *input, size_t length)
+{
+    length = unpadded_length(alphabet, input, length);
+    if (tail_bytes[length % 8] < 0)
+        return BASE32_ERROR;
+    return length / 8 * 5 + tail_bytes[length % 8];
+}
+
+size_t base32_decoded_length(const char *input, size_t length)
+{
+    return base32_decoded_length_with(&base32_standard, input, length);
+}
+
+size_t base32_encode_with(const struct base32_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    if (capacity < base32_encoded_length(length))
+        return BASE32_ERROR;
+    encode_bulk(alphabet, input, length, output);
+    return base32_encoded_length(length);
+}
+
+size_t base32_decode_with(const struct base32_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    size_t data    = unpadded_length(alphabet, input, length);
+    size_t padding = length - data;
+    size_t tail    = data % 8;
+    if (tail_bytes[tail] < 0 || (padding > 0 && tail + padding != 8))
+        return BASE32_ERROR;
+
+    size_t result_length = data / 8 * 5 + tail_bytes[tail];
+    if (capacity < result_length)
+        return BASE32_ERROR;
+
+    size_t bulk = data - tail;
+    if (decode_valid(alphabet, input, bulk, output) != bulk
+        || !decode_tail(alphabet, input + bulk, tail, output + bulk / 8 * 5))
+        return BASE32_ERROR;
+    return result_length;
+}
+
+size_t base32_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    return base32_encode_with(
+        &base32_standard, input, length, output, capacity);
+}
+
+size_t base32_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    return base32_decode_with(
+        &base32_standard, input, length, output, capacity);
+}
+
+size_t base32hex_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    return base32_encode_with(&base32_hex, input, length, output, capacity);
+}
+
+size_t base32hex_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    return base32_decode_with(&base32_hex, input, length, output, capacity);
+}
+
+void base32_encoder_init_with(
+    struct base32_encoder *encoder, const struct base32_alphabet *alphabet)
+{
+    encoder->alphabet = alphabet;
+    encoder->carried  = 0;
+}
+
+void base32_encoder_init(struct base32_encoder *encoder)
+{
+    base32_encoder_init_with(encoder, &base32_standard);
+}
+
+size_t base32_encoder_update_length(
+    const struct base32_encoder *encoder, size_t length)
+{
+    return (encoder->carried + length) / 5 * 8;
+}
+
+size_t base32_encoder_update(struct base32_encoder *encoder,
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    size_t result_length = base32_encoder_update_length(encoder, length);
+    if (capacity < result_length)
+        return BASE32_ERROR;
+
+    // Complete the group left over by the previous chunk first.
+    if (encoder->carried > 0) {
+        while (encoder->carried < 5 && length > 0) {
+            encoder->carry[encoder->carried++] = *input++;
+            length--;
+        }
+        if (encoder->carried < 5)
+            return 0;
+        encode_bulk(encoder->alphabet, encoder->carry, 5, output);
+        output += 8;
+        encoder->carried = 0;
+    }
+
+    size_t bulk = length / 5 * 5;
+    encode_bulk(encoder->alphabet, input, bulk, output);
+
+    encoder->carried = length - bulk;
+    memcpy(encoder->carry, input + bulk, encoder->carried);
+    return result_length;
+}
+
+size_t base32_encoder_final(
+    struct base32_encoder *encoder, char *output, size_t capacity)
+{
+    size_t result_length = base32_encoded_length(encoder->carried);
+    if (capacity < result_length)
+        return BASE32_ERROR;
+
+    encode_bulk(encoder->alphabet, encoder->carry, encoder->carried, output);
+    encoder->carried = 0;
+    return result_length;
+}
+
+void base32_decoder_init_with(
+    struct base32_decoder *decoder, const struct base32_alphabet *alphabet)
+{
+    decoder->alphabet = alphabet;
+    decoder->carried  = 0;
+    decoder->padding  = 0;
+}
+
+void base32_decoder_init(struct base32_decoder *decoder)
+{
+    base32_decoder_init_with(decoder, &base32_standard);
+}
+
+size_t base32_decoder_update_length(
+    const struct base32_decoder *decoder, size_t length)
+{
+    return (decoder->carried + length) / 8 * 5;
+}
+
+size_t base32_decoder_update(struct base32_decoder *decoder, const char *input,
+    size_t length, uint8_t *output, size_t capacity)
+{
+    const struct base32_alphabet *alphabet = decoder->alphabet;
+
+    // Everything from the first padding character on is padding, and ends
+    // the data.
+    const char *padding = length ? memchr(input, alphabet->padding, length)
+                                 : NULL;
+    size_t data_length  = padding ? (size_t)(padding - input) : length;
+
+    if (decoder->padding > 0 && data_length > 0)
+        return BASE32_ERROR;
+    size_t padding_length = decoder->padding + length - data_length;
+    for (size_t i = data_length; i < length; i++)
+        if (input[i] != alphabet->padding || padding_length > 6)
+            return BASE32_ERROR;
+
+    size_t result_length = base32_decoder_update_length(decoder, data_length);
+    if (capacity < result_length)
+        return BASE32_ERROR;
+    decoder->padding = padding_length;
+
+    if (decoder->carried > 0) {
+        while (decoder->carried < 8 && data_length > 0) {
+            decoder->carry[decoder->carried++] = *input++;
+            data_length--;
+        }
+        if (decoder->carried < 8)
+            return 0;
+        if (decode_valid(alphabet, decoder->carry, 8, output) != 8)
+            return BASE32_ERROR;
+        output += 5;
+        decoder->carried = 0;
+    }
+
+    size_t bulk = data_length / 8 * 8;
+    if (decode_valid(alphabet, input, bulk, output) != bulk)
+        return BASE32_ERROR;
+
+    decoder->carried = data_length - bulk;
+    memcpy(decoder->carry, input + bulk, decoder->carried);
+    return result_length;
+}
+
+size_t base32_decoder_final(
+    struct base32_decoder *decoder, uint8_t *output, size_t capacity)
+{
+    // The last group holds 2, 4, 5 or 7 characters, completed by the padding
+    // if there is any.
+    size_t carried = decoder->carried;
+    if (tail_bytes[carried] < 0
+        || (decoder->padding > 0 && carried + decoder->padding != 8))
+        return BASE32_ERROR;
+
+    size_t result_length = tail_bytes[carried];
+    if (capacity < result_length
+        || !decode_tail(decoder->alphabet, decoder->carry, carried, output))
+        return BASE32_ERROR;
+
+    base32_decoder_init_with(decoder, decoder->alphabet);
+    return result_length;
+}
@@ -0,0 +1,104 @@
+/**
+ * Base32 codecs of RFC 4648, with the standard alphabet and the extended hex
+ * one, on the same kernels as the base64 codec: the fastest supported by the
+ * CPU, switched with base64_set_kernel().
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef BASE32_H
+#define BASE32_H
+
+// Returned by the codecs below when the output doesn't fit or the input is
+// malformed.
+#define BASE32_ERROR ((size_t)-1)
+
+// Both translation tables of an alphabet, and the characters of every 10-bit
+// value for the wide kernel.
+struct base32_alphabet {
+    char pairs[1024][2];
+    char chars[32];
+    signed char values[256];
+    char padding;
+};
+
+// "A"-"Z", "2"-"7", and "0"-"9", "A"-"V", both padded with '='.
+extern const struct base32_alphabet base32_standard;
+extern const struct base32_alphabet base32_hex;
+
+// Exact number of characters base32_encode() writes for `length` bytes.
+size_t base32_encoded_length(size_t length);
+
+// Exact number of bytes base32_decode() writes for the `length` characters of
+// `input`, or BASE32_ERROR if no valid encoding has that length.
+size_t base32_decoded_length(const char *input, size_t length);
+
+// Encode `length` bytes into `output`, which holds `capacity` characters, and
+// return the number of characters written. Nothing is allocated and no NUL
+// terminator is written.
+size_t base32_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+
+// Decode `length` characters, padded or not, into `output`, which holds
+// `capacity` bytes, and return the number of bytes written. Returns
+// BASE32_ERROR if the input holds anything but the alphabet and its padding.
+size_t base32_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+
+// Streaming codecs, for inputs arriving in chunks of any size, that work like
+// the base64 ones: each update handles as much of the chunk as possible and
+// carries the incomplete group left at its end over to the next one, final
+// flushes it. The functions return the number of characters or bytes
+// written, or BASE32_ERROR if they don't fit in `capacity` or the input is
+// invalid.
+
+struct base32_encoder {
+    const struct base32_alphabet *alphabet;
+    uint8_t carry[5];
+    size_t carried;
+};
+
+void base32_encoder_init(struct base32_encoder *encoder);
+size_t base32_encoder_update_length(
+    const struct base32_encoder *encoder, size_t length);
+size_t base32_encoder_update(struct base32_encoder *encoder,
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+// Writes at most 8 characters.
+size_t base32_encoder_final(
+    struct base32_encoder *encoder, char *output, size_t capacity);
+
+struct base32_decoder {
+    const struct base32_alphabet *alphabet;
+    char carry[8];
+    size_t carried;
+    size_t padding; /* Number of padding characters seen so far */
+};
+
+void base32_decoder_init(struct base32_decoder *decoder);
+size_t base32_decoder_update_length(
+    const struct base32_decoder *decoder, size_t length);
+size_t base32_decoder_update(struct base32_decoder *decoder, const char *input,
+    size_t length, uint8_t *output, size_t capacity);
+// Writes at most 4 bytes.
+size_t base32_decoder_final(
+    struct base32_decoder *decoder, uint8_t *output, size_t capacity);
+
+// The functions above, for the extended hex alphabet or any other.
+size_t base32hex_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+size_t base32hex_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+size_t base32_decoded_length_with(
+    const struct base32_alphabet *alphabet, const char *input, size_t length);
+size_t base32_encode_with(const struct base32_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+size_t base32_decode_with(const struct base32_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+void base32_encoder_init_with(
+    struct base32_encoder *encoder, const struct base32_alphabet *alphabet);
+void base32_decoder_init_with(
+    struct base32_decoder *decoder, const struct base32_alphabet *alphabet);
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * AVX-512 VBMI base32 kernels, compiled like the base64 ones.
+ *
+ * Encoding spreads every 5-byte group over a 64-bit lane, most significant
+ * byte first, pulls its eight 5-bit fields into their own bytes with a
+ * multishift and translates them with a byte permute of the alphabet.
+ * Decoding translates every character with a two-table permute of the first
+ * 128 values, which also flags the invalid ones, then two multiply-adds and
+ * a pair of shifts gather the 40 bits of every group back into its lane.
+ */
+
+#include "base64_simd.h"
+
+#ifdef BASE64_X86
+
+#include <immintrin.h>
+
+#define AVX512 __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
+// Byte of 8 groups of 5 bytes going to each byte of the 64-bit lanes, so
+// that every group ends up in the top 5 bytes of its lane, big-endian.
+static const uint8_t encode_spread[64] = {
+#define SPREAD_(g)                                                            \
+    5 * (g), 5 * (g), 5 * (g), 5 * (g) + 4, 5 * (g) + 3, 5 * (g) + 2,         \
+        5 * (g) + 1, 5 * (g)
+    SPREAD_(0), SPREAD_(1), SPREAD_(2), SPREAD_(3), SPREAD_(4), SPREAD_(5),
+    SPREAD_(6), SPREAD_(7)
+#undef SPREAD_
+};
+
+// Bytes of the 64-bit lanes holding the 5 decoded bytes of every group, in
+// order.
+static const uint8_t decode_gather[64] = {
+#define GATHER_(g) 8 * (g) + 4, 8 * (g) + 3, 8 * (g) + 2, 8 * (g) + 1, 8 * (g)
+    GATHER_(0), GATHER_(1), GATHER_(2), GATHER_(3), GATHER_(4), GATHER_(5),
+    GATHER_(6), GATHER_(7)
+#undef GATHER_
+};
+
+AVX512 size_t base32_encode_avx512(const struct base32_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    __m512i spread = _mm512_loadu_si512(encode_spread);
+    __m512i chars  = _mm512_broadcast_i64x4(
+        _mm256_loadu_si256((const __m256i *)alphabet->chars));
+    // Offsets of the 8 fields of a lane, from the top.
+    __m512i shifts = _mm512_set1_epi64(0x181D22272C31363B);
+    __mmask64 load = ((__mmask64)1 << 40) - 1;
+    size_t i       = 0;
+
+    for (; len - i >= 40; i += 40, out += 64) {
+        __m512i groups = _mm512_permutexvar_epi8(
+            spread, _mm512_maskz_loadu_epi8(load, in + i));
+        __m512i indices = _mm512_and_si512(
+            _mm512_multishift_epi64_epi8(shifts, groups),
+            _mm512_set1_epi8(31));
+        _mm512_storeu_si512(out, _mm512_permutexvar_epi8(indices, chars));
+    }
+    return i;
+}
+
+AVX512 size_t base32_decode_avx512(const struct base32_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    __m512i low    = _mm512_loadu_si512(alphabet->values);
+    __m512i high   = _mm512_loadu_si512(alphabet->values + 64);
+    __m512i gather = _mm512_loadu_si512(decode_gather);
+    __mmask64 store = ((__mmask64)1 << 40) - 1;
+    size_t i        = 0;
+
+    for (; len - i >= 64; i += 64, out += 40) {
+        // Invalid characters have their top bit set, either to begin with or
+        // once translated to -1.
+        __m512i chars  = _mm512_loadu_si512(in + i);
+        __m512i values = _mm512_permutex2var_epi8(low, chars, high);
+        if (_mm512_test_epi8_mask(
+                _mm512_or_si512(chars, values), _mm512_set1_epi8(-128)))
+            break;
+
+        // Join pairs of values into 10 bits, then pairs of those into 20...
+        __m512i bits = _mm512_maddubs_epi16(values, _mm512_set1_epi16(0x0120));
+        bits = _mm512_madd_epi16(bits, _mm512_set1_epi32(0x00010400));
+        // ...and the two halves of every lane into 40.
+        bits = _mm512_or_si512(
+            _mm512_and_si512(_mm512_slli_epi64(bits, 20),
+                _mm512_set1_epi64(0xFFFFFFFFFF)),
+            _mm512_srli_epi64(bits, 32));
+
+        _mm512_mask_storeu_epi8(
+            out, store, _mm512_permutexvar_epi8(gather, bits));
+    }
+    return i;
+}
+
+#endif
@@ -3,44 +3,589 @@
 #include <string.h>
 
 #include "base64.h"
+#include "base64_simd.h"
 
-static void base64_encoding(
-    const char *input, unsigned int input_length, char *result);
-static void base64_decoding(
-    const char *input, unsigned int input_length, char *result);
-
-static const char *lookup_table
-    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-// clang-format off
-static const char ascii_table[256] = {
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
-    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
-    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
-    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
-    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+static void base64_encoding(const struct base64_alphabet *alphabet,
+    const unsigned char *input, size_t input_length, char *result);
+static void base64_decoding(const struct base64_alphabet *alphabet,
+    const char *input, size_t input_length, unsigned char *result);
+
+const struct base64_alphabet base64_standard = BASE64_ALPHABET('+', '/', '=');
+const struct base64_alphabet base64_url      = BASE64_ALPHABET('-', '_', 0);
+
+// Bulk encoder and decoder of a kernel, see base64_simd.h.
+struct kernel {
+    const char *name;
+    size_t (*encode)(const struct base64_alphabet *alphabet,
+        const unsigned char *in, size_t len, char *out);
+    size_t (*decode)(const struct base64_alphabet *alphabet, const char *in,
+        size_t len, unsigned char *out);
+    bool any_alphabet; /* Whether it supports alphabets without `ranges` */
+};
+
+// The scalar kernel is the reference the others are tested against. It
+// leaves encoding to base64_encoding(), and decodes one group at a time.
+static size_t scalar_encode(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    return 0;
+}
+
+static size_t scalar_decode(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    const signed char *values = alphabet->values;
+    size_t done;
+    for (done = 0; len - done >= 4; done += 4) {
+        int a = values[(unsigned char)in[done]];
+        int b = values[(unsigned char)in[done + 1]];
+        int c = values[(unsigned char)in[done + 2]];
+        int d = values[(unsigned char)in[done + 3]];
+        if ((a | b | c | d) < 0)
+            break;
+
+        *out++ = (unsigned char)(a << 2 | b >> 4);
+        *out++ = (unsigned char)(b << 4 | c >> 2);
+        *out++ = (unsigned char)(c << 6 | d);
+    }
+    return done;
+}
+
+static const struct kernel kernels[BASE64_KERNELS] = {
+    [BASE64_SCALAR] = { "scalar", scalar_encode, scalar_decode, true },
+    [BASE64_WIDE]   = { "wide", base64_encode_wide, base64_decode_wide, true },
+#ifdef BASE64_X86
+    [BASE64_SSSE3]
+    = { "ssse3", base64_encode_ssse3, base64_decode_ssse3, false },
+    [BASE64_AVX2] = { "avx2", base64_encode_avx2, base64_decode_avx2, false },
+    [BASE64_AVX512]
+    = { "avx512", base64_encode_avx512, base64_decode_avx512, true },
+#endif
 };
-// clang-format on
+
+static enum base64_kernel active_kernel = BASE64_SCALAR;
+
+static bool kernel_supported(enum base64_kernel kernel)
+{
+    switch (kernel) {
+    case BASE64_SCALAR:
+    case BASE64_WIDE:
+        return true;
+#ifdef BASE64_X86
+    case BASE64_SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case BASE64_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case BASE64_AVX512:
+        return __builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512vbmi");
+#endif
+    default:
+        return false;
+    }
+}
+
+// Picks the fastest kernel before main() runs, so that the codecs never have
+// to synchronize on it.
+__attribute__((constructor)) static void select_kernel(void)
+{
+#ifdef BASE64_X86
+    __builtin_cpu_init();
+#endif
+    for (int kernel = BASE64_KERNELS - 1; kernel > BASE64_WIDE; kernel--)
+        if (kernel_supported(kernel)) {
+            active_kernel = kernel;
+            return;
+        }
+    active_kernel = BASE64_WIDE;
+}
+
+// Returns the active kernel, or the wide one if it doesn't support
+// `alphabet`.
+static const struct kernel *kernel_for(const struct base64_alphabet *alphabet)
+{
+    const struct kernel *kernel = &kernels[active_kernel];
+    return alphabet->ranges || kernel->any_alphabet ? kernel
+                                                    : &kernels[BASE64_WIDE];
+}
+
+bool base64_set_kernel(enum base64_kernel kernel)
+{
+    if (kernel >= BASE64_KERNELS || !kernel_supported(kernel))
+        return false;
+    active_kernel = kernel;
+    return true;
+}
+
+enum base64_kernel base64_get_kernel(void)
+{
+    return active_kernel;
+}
+
+const char *base64_kernel_name(enum base64_kernel kernel)
+{
+    return kernel < BASE64_KERNELS && kernels[kernel].name
+        ? kernels[kernel].name
+        : "unknown";
+}
+
+bool base64_alphabet_init(
+    struct base64_alphabet *alphabet, const char *chars, char padding)
+{
+    memset(alphabet->values, -1, sizeof(alphabet->values));
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = (unsigned char)chars[i];
+        if (c == 0 || c > 127 || alphabet->values[c] >= 0 || c == padding)
+            return false;
+        alphabet->chars[i]  = (char)c;
+        alphabet->values[c] = (signed char)i;
+    }
+    if ((unsigned char)padding > 127)
+        return false;
+
+    for (int i = 0; i < 4096; i++) {
+        alphabet->pairs[i][0] = chars[i >> 6];
+        alphabet->pairs[i][1] = chars[i & 63];
+    }
+    for (int k = 0; k < 4; k++)
+        for (int c = 0; c < 256; c++)
+            alphabet->shifted[k][c] = alphabet->values[c] < 0
+                ? BASE64_INVALID_
+                : BASE64_SHIFT_(alphabet->values[c], k);
+
+    alphabet->padding = padding;
+    alphabet->ranges  = memcmp(chars, base64_standard.chars, 62) == 0;
+    return true;
+}
+
+size_t base64_encoded_length_with(
+    const struct base64_alphabet *alphabet, size_t length)
+{
+    if (alphabet->padding)
+        return (length + 2) / 3 * 4;
+    return length / 3 * 4 + (length % 3 ? length % 3 + 1 : 0);
+}
+
+size_t base64_encoded_length(size_t length)
+{
+    return base64_encoded_length_with(&base64_standard, length);
+}
+
+// Returns the number of characters before the padding, if any.
+static size_t unpadded_length(
+    const struct base64_alphabet *alphabet, const char *input, size_t length)
+{
+    for (int i = 0; i < 2 && length > 0 && alphabet->padding
+         && input[length - 1] == alphabet->padding;
+         i++)
+        length--;
+    return length;
+}
+
+size_t base64_decoded_length_with(
+    const struct base64_alphabet *alphabet, const char *input, size_t length)
+{
+    length = unpadded_length(alphabet, input, length);
+    if (length % 4 == 1)
+        return BASE64_ERROR;
+    return length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0);
+}
+
+size_t base64_decoded_length(const char *input, size_t length)
+{
+    return base64_decoded_length_with(&base64_standard, input, length);
+}
+
+// Encodes the whole input, the kernel handles the bulk of it and the scalar
+// code the rest. Returns the number of characters written.
+static size_t encode_bulk(const struct base64_alphabet *alphabet,
+    const unsigned char *input, size_t input_length, char *result)
+{
+    const struct kernel *kernel = kernel_for(alphabet);
+    size_t done = kernel->encode(alphabet, input, input_length, result);
+
+    // Except for the reference, the kernels leave up to a block of groups,
+    // finished with the wide tables.
+    if (kernel != &kernels[BASE64_SCALAR])
+        done += base64_encode_wide(alphabet, input + done, input_length - done,
+            result + done / 3 * 4);
+    base64_encoding(
+        alphabet, input + done, input_length - done, result + done / 3 * 4);
+    return base64_encoded_length_with(alphabet, input_length);
+}
+
+// Decodes `input_length` characters, padding excluded, without validating
+// them.
+static void decode_bulk(const struct base64_alphabet *alphabet,
+    const char *input, size_t input_length, unsigned char *result)
+{
+    size_t done = kernel_for(alphabet)->decode(
+        alphabet, input, input_length, result);
+    base64_decoding(
+        alphabet, input + done, input_length - done, result + done / 4 * 3);
+}
+
+size_t base64_encode_with(const struct base64_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    if (capacity < base64_encoded_length_with(alphabet, length))
+        return BASE64_ERROR;
+    return encode_bulk(alphabet, input, length, output);
+}
+
+size_t base64_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    return base64_encode_with(
+        &base64_standard, input, length, output, capacity);
+}
+
+size_t base64url_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    return base64_encode_with(&base64_url, input, length, output, capacity);
+}
+
+// Decodes the longest prefix of `input` made of whole groups of characters
+// from the alphabet, without writing more than `capacity` bytes. Returns the
+// number of characters consumed.
+static size_t decode_valid(const struct base64_alphabet *alphabet,
+    const char *input, size_t length, unsigned char *result, size_t capacity)
+{
+    // The kernels may write a few bytes past the groups they decode, but
+    // never past the 3/4 of the input they were given.
+    if (length > capacity / 3 * 4)
+        length = capacity / 3 * 4;
+
+    size_t done = kernel_for(alphabet)->decode(alphabet, input, length, result);
+
+    // The kernel stops at the first block holding a character outside of the
+    // alphabet, finish the groups before it with the wide tables.
+    return done
+        + base64_decode_wide(
+            alphabet, input + done, length - done, result + done / 4 * 3);
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v'
+        || c == '\f';
+}
+
+size_t base64_decoded_max_length(size_t length)
+{
+    return (length + 3) / 4 * 3;
+}
+
+size_t base64_decode_with(const struct base64_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output, size_t capacity,
+    unsigned flags, size_t *error_offset)
+{
+    bool skip   = flags & BASE64_SKIP_WHITESPACE;
+    char pad    = alphabet->padding;
+    size_t i    = 0;
+    size_t size = 0;
+
+    if (error_offset)
+        *error_offset = BASE64_ERROR;
+
+    for (;;) {
+        // Whole groups run at the speed of the kernel...
+        size_t done = decode_valid(
+            alphabet, input + i, length - i, output + size, capacity - size);
+        i += done;
+        size += done / 4 * 3;
+
+        // ...until it finds whitespace, padding, an invalid character or the
+        // end of the input. Gather the next group one character at a time.
+        char group[4];
+        size_t count = 0;
+        for (; i < length && count < 4; i++) {
+            if (skip && is_space(input[i]))
+                continue;
+            if (pad && input[i] == pad)
+                break;
+            if (alphabet->values[(unsigned char)input[i]] < 0)
+                goto invalid;
+            group[count++] = input[i];
+        }
+
+        if (count == 4) {
+            if (capacity - size < 3)
+                return BASE64_ERROR;
+            decode_valid(alphabet, group, 4, output + size, 3);
+            size += 3;
+            continue;
+        }
+
+        // The data ended, with 2 or 3 characters in the last group, possibly
+        // completed by padding and followed by nothing but whitespace. A
+        // group of padding alone is invalid from its first character.
+        size_t padding = 0;
+        for (; i < length; i++) {
+            if (skip && is_space(input[i]))
+                continue;
+            if (input[i] != pad || count == 0 || count + padding == 4)
+                goto invalid;
+            padding++;
+        }
+        if (count == 1 || (padding > 0 && count + padding != 4))
+            goto invalid;
+
+        if (count > 0) {
+            if (capacity - size < count - 1)
+                return BASE64_ERROR;
+            base64_decoding(alphabet, group, count, output + size);
+            size += count - 1;
+        }
+        return size;
+    }
+
+invalid:
+    if (error_offset)
+        *error_offset = i;
+    return BASE64_ERROR;
+}
+
+size_t base64_decode_checked(const char *input, size_t length,
+    uint8_t *output, size_t capacity, unsigned flags, size_t *error_offset)
+{
+    return base64_decode_with(&base64_standard, input, length, output,
+        capacity, flags, error_offset);
+}
+
+size_t base64_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    return base64_decode_with(
+        &base64_standard, input, length, output, capacity, 0, NULL);
+}
+
+size_t base64url_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity)
+{
+    return base64_decode_with(
+        &base64_url, input, length, output, capacity, 0, NULL);
+}
+
+// Every kernel writes behind what it has read, even counting the bytes it
+// writes past its output, so the codec works in place as it is.
+size_t base64_decode_in_place_with(const struct base64_alphabet *alphabet,
+    char *buffer, size_t length, unsigned flags, size_t *error_offset)
+{
+    return base64_decode_with(alphabet, buffer, length, (uint8_t *)buffer,
+        length, flags, error_offset);
+}
+
+size_t base64_decode_in_place(
+    char *buffer, size_t length, unsigned flags, size_t *error_offset)
+{
+    return base64_decode_in_place_with(
+        &base64_standard, buffer, length, flags, error_offset);
+}
+
+void base64_encoder_init_with(
+    struct base64_encoder *encoder, const struct base64_alphabet *alphabet)
+{
+    encoder->alphabet = alphabet;
+    encoder->carried  = 0;
+}
+
+void base64_encoder_init(struct base64_encoder *encoder)
+{
+    base64_encoder_init_with(encoder, &base64_standard);
+}
+
+size_t base64_encoder_update_length(
+    const struct base64_encoder *encoder, size_t length)
+{
+    return (encoder->carried + length) / 3 * 4;
+}
+
+size_t base64_encoder_update(struct base64_encoder *encoder,
+    const uint8_t *input, size_t length, char *output, size_t capacity)
+{
+    size_t result_length = base64_encoder_update_length(encoder, length);
+    if (capacity < result_length)
+        return BASE64_ERROR;
+
+    // Complete the group left over by the previous chunk first.
+    if (encoder->carried > 0) {
+        while (encoder->carried < 3 && length > 0) {
+            encoder->carry[encoder->carried++] = *input++;
+            length--;
+        }
+        if (encoder->carried < 3)
+            return 0;
+        output += encode_bulk(encoder->alphabet, encoder->carry, 3, output);
+        encoder->carried = 0;
+    }
+
+    size_t bulk = length / 3 * 3;
+    encode_bulk(encoder->alphabet, input, bulk, output);
+
+    encoder->carried = length - bulk;
+    for (size_t i = 0; i < encoder->carried; i++)
+        encoder->carry[i] = input[bulk + i];
+    return result_length;
+}
+
+size_t base64_encoder_final(
+    struct base64_encoder *encoder, char *output, size_t capacity)
+{
+    size_t result_length
+        = base64_encoded_length_with(encoder->alphabet, encoder->carried);
+    if (capacity < result_length)
+        return BASE64_ERROR;
+
+    encode_bulk(encoder->alphabet, encoder->carry, encoder->carried, output);
+    encoder->carried = 0;
+    return result_length;
+}
+
+void base64_decoder_init_with(
+    struct base64_decoder *decoder, const struct base64_alphabet *alphabet)
+{
+    decoder->alphabet = alphabet;
+    decoder->carried  = 0;
+    decoder->padding  = 0;
+}
+
+void base64_decoder_init(struct base64_decoder *decoder)
+{
+    base64_decoder_init_with(decoder, &base64_standard);
+}
+
+size_t base64_decoder_update_length(
+    const struct base64_decoder *decoder, size_t length)
+{
+    return (decoder->carried + length) / 4 * 3;
+}
+
+size_t base64_decoder_update(struct base64_decoder *decoder, const char *input,
+    size_t length, uint8_t *output, size_t capacity)
+{
+    const struct base64_alphabet *alphabet = decoder->alphabet;
+
+    // Everything from the first padding character on is padding, and ends
+    // the data.
+    const char *padding = length && alphabet->padding
+        ? memchr(input, alphabet->padding, length)
+        : NULL;
+    size_t data_length = padding ? (size_t)(padding - input) : length;
+
+    if (decoder->padding > 0 && data_length > 0)
+        return BASE64_ERROR;
+    size_t padding_length = decoder->padding + length - data_length;
+    for (size_t i = data_length; i < length; i++)
+        if (input[i] != alphabet->padding || padding_length > 2)
+            return BASE64_ERROR;
+
+    size_t result_length = base64_decoder_update_length(decoder, data_length);
+    if (capacity < result_length)
+        return BASE64_ERROR;
+    decoder->padding = padding_length;
+
+    if (decoder->carried > 0) {
+        while (decoder->carried < 4 && data_length > 0) {
+            decoder->carry[decoder->carried++] = *input++;
+            data_length--;
+        }
+        if (decoder->carried < 4)
+            return 0;
+        if (decode_valid(alphabet, decoder->carry, 4, output, 3) != 4)
+            return BASE64_ERROR;
+        output += 3;
+        decoder->carried = 0;
+    }
+
+    size_t bulk = data_length / 4 * 4;
+    if (decode_valid(alphabet, input, bulk, output, bulk / 4 * 3) != bulk)
+        return BASE64_ERROR;
+
+    decoder->carried = data_length - bulk;
+    for (size_t i = 0; i < decoder->carried; i++)
+        decoder->carry[i] = input[bulk + i];
+    return result_length;
+}
+
+size_t base64_decoder_final(
+    struct base64_decoder *decoder, uint8_t *output, size_t capacity)
+{
+    // The last group holds 2 or 3 characters, completed by the padding if
+    // there is any.
+    size_t carried = decoder->carried;
+    if (carried == 1
+        || (decoder->padding > 0 && carried + decoder->padding != 4))
+        return BASE64_ERROR;
+
+    for (size_t i = 0; i < carried; i++)
+        if (decoder->alphabet->values[(unsigned char)decoder->carry[i]] < 0)
+            return BASE64_ERROR;
+
+    size_t result_length = carried ? carried - 1 : 0;
+    if (capacity < result_length)
+        return BASE64_ERROR;
+
+    base64_decoding(decoder->alphabet, decoder->carry, carried, output);
+    base64_decoder_init_with(decoder, decoder->alphabet);
+    return result_length;
+}
+
+void base64_reader_init_with(struct base64_reader *reader,
+    const struct base64_alphabet *alphabet, const char *input, size_t length)
+{
+    base64_decoder_init_with(&reader->decoder, alphabet);
+    reader->input    = input;
+    reader->length   = length;
+    reader->offset   = 0;
+    reader->finished = false;
+}
+
+void base64_reader_init(
+    struct base64_reader *reader, const char *input, size_t length)
+{
+    base64_reader_init_with(reader, &base64_standard, input, length);
+}
+
+size_t base64_reader_next(struct base64_reader *reader, const uint8_t **block)
+{
+    *block = reader->block;
+
+    // Feed the decoder as many characters as fit in a block, skipping over
+    // chunks that only hold padding.
+    while (reader->offset < reader->length) {
+        size_t chunk = BASE64_READER_BLOCK / 3 * 4 - reader->decoder.carried;
+        if (chunk > reader->length - reader->offset)
+            chunk = reader->length - reader->offset;
+
+        size_t size = base64_decoder_update(&reader->decoder,
+            reader->input + reader->offset, chunk, reader->block,
+            BASE64_READER_BLOCK);
+        if (size == BASE64_ERROR)
+            return BASE64_ERROR;
+        reader->offset += chunk;
+        if (size > 0)
+            return size;
+    }
+
+    if (reader->finished)
+        return 0;
+    reader->finished = true;
+    return base64_decoder_final(
+        &reader->decoder, reader->block, BASE64_READER_BLOCK);
+}
 
 char *encode(const char *string)
 {
     // Calculate the size of the resulting string.
-    int input_length = strlen(string);
-    int length       = (input_length + 2) / 3 * 4;
-    char *result     = (char *)calloc(length + 1, sizeof(char));
+    size_t input_length = strlen(string);
+    size_t length       = base64_encoded_length(input_length);
+    char *result        = (char *)calloc(length + 1, sizeof(char));
 
-    base64_encoding(string, input_length, result);
+    encode_bulk(
+        &base64_standard, (const unsigned char *)string, input_length, result);
 
     return result;
 }
@@ -48,24 +593,23 @@ char *encode(const char *string)
 char *decode(const char *string)
 {
     // Calculate the size of the resulting string.
-    int input_length = 0;
-    while (string[input_length] != '=' && string[input_length] != '\0'
-        && ++input_length)
-        ;
-    int length   = (input_length + 2) / 4 * 3;
-    char *result = (char *)calloc(length + 1, sizeof(char));
+    size_t input_length = strcspn(string, "=");
+    size_t length       = (input_length + 2) / 4 * 3;
+    char *result        = (char *)calloc(length + 1, sizeof(char));
 
-    base64_decoding(string, input_length, result);
+    decode_bulk(
+        &base64_standard, string, input_length, (unsigned char *)result);
 
     return result;
 }
 
-static void base64_encoding(
-    const char *input, unsigned int input_length, char *result)
+static void base64_encoding(const struct base64_alphabet *alphabet,
+    const unsigned char *input, size_t input_length, char *result)
 {
-    unsigned int result_index = 0;
-    unsigned int i;
-    for (i = 0; i < input_length - 2; i += 3) {
+    const char *lookup_table = alphabet->chars;
+    size_t result_index      = 0;
+    size_t i;
+    for (i = 0; i + 2 < input_length; i += 3) {
         result[result_index++] = lookup_table[(input[i] >> 2) & 0x3F];
         result[result_index++] = lookup_table[((input[i] << 4) & 0x30)
             | ((input[i + 1] >> 4) & 0x0F)];
@@ -80,43 +624,47 @@ static void base64_encoding(
 
         if (i == input_length - 1) {
             result[result_index++] = lookup_table[(input[i] << 4) & 0x30];
-            result[result_index++] = '=';
+            if (alphabet->padding)
+                result[result_index++] = alphabet->padding;
         } else { /* If input length % 3 == 1 */
             result[result_index++] = lookup_table[((input[i] << 4) & 0x30)
                 | ((input[i + 1] >> 4) & 0x0F)];
             result[result_index++] = lookup_table[(input[i + 1] << 2) & 0x3C];
         } /* Else if input length % 3 == 2 */
-        result[result_index++] = '=';
+        if (alphabet->padding)
+            result[result_index++] = alphabet->padding;
     }
-
-    result[result_index++] = '\0';
 }
 
-static void base64_decoding(
-    const char *input, unsigned int input_length, char *result)
+static void base64_decoding(const struct base64_alphabet *alphabet,
+    const char *input, size_t input_length, unsigned char *result)
 {
-    unsigned int result_index = 0;
-    unsigned int i;
-    for (i = 0; i < input_length - 3; i += 4) {
-        result[result_index++] = ((ascii_table[(int)input[i]] << 2) & 0xFC)
-            | ((ascii_table[(int)input[i + 1]] >> 4) & 0x03);
-        result[result_index++] = ((ascii_table[(int)input[i + 1]] << 4) & 0xF0)
-            | ((ascii_table[(int)input[i + 2]] >> 2) & 0x0F);
-        result[result_index++] = ((ascii_table[(int)input[i + 2]] << 6) & 0xC0)
-            | (ascii_table[(int)input[i + 3]] & 0x3F);
+    const signed char *ascii_table = alphabet->values;
+    size_t result_index            = 0;
+    size_t i;
+    for (i = 0; i + 3 < input_length; i += 4) {
+        result[result_index++]
+            = ((ascii_table[(unsigned char)input[i]] << 2) & 0xFC)
+            | ((ascii_table[(unsigned char)input[i + 1]] >> 4) & 0x03);
+        result[result_index++]
+            = ((ascii_table[(unsigned char)input[i + 1]] << 4) & 0xF0)
+            | ((ascii_table[(unsigned char)input[i + 2]] >> 2) & 0x0F);
+        result[result_index++]
+            = ((ascii_table[(unsigned char)input[i + 2]] << 6) & 0xC0)
+            | (ascii_table[(unsigned char)input[i + 3]] & 0x3F);
     }
 
     // Will only execute if the input contained '='s.
     if (i < input_length) {
-        result[result_index++] = ((ascii_table[(int)input[i]] << 2) & 0xFC)
-            | ((ascii_table[(int)input[i + 1]] >> 4) & 0x03);
+        result[result_index++]
+            = ((ascii_table[(unsigned char)input[i]] << 2) & 0xFC)
+            | ((ascii_table[(unsigned char)input[i + 1]] >> 4) & 0x03);
 
         // If the input string has 2 '='s.
         if (i == input_length - 3) {
             result[result_index++]
-                = ((ascii_table[(int)input[i + 1]] << 4) & 0xF0)
-                | ((ascii_table[(int)input[i + 2]] >> 2) & 0x0F);
+                = ((ascii_table[(unsigned char)input[i + 1]] << 4) & 0xF0)
+                | ((ascii_table[(unsigned char)input[i + 2]] >> 2) & 0x0F);
         }
-        result[result_index++] = '\0';
     }
 }
@@ -1,7 +1,193 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base64_alphabet.h"
+
 #ifndef BASE64_H
 #define BASE64_H
 
 char *encode(const char *string);
 char *decode(const char *string);
 
+// Returned by the codecs below when the output doesn't fit or the input is
+// malformed.
+#define BASE64_ERROR ((size_t)-1)
+
+// Exact number of characters base64_encode() writes for `length` bytes.
+size_t base64_encoded_length(size_t length);
+
+// Exact number of bytes base64_decode() writes for the `length` characters of
+// `input`, or BASE64_ERROR if no valid encoding has that length.
+size_t base64_decoded_length(const char *input, size_t length);
+
+// Encode `length` bytes into `output`, which holds `capacity` characters, and
+// return the number of characters written. Nothing is allocated and no NUL
+// terminator is written.
+size_t base64_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+
+// Decode `length` characters, padded or not, into `output`, which holds
+// `capacity` bytes, and return the number of bytes written. Returns
+// BASE64_ERROR if the input holds anything but the alphabet and its padding.
+size_t base64_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+
+// Flags of base64_decode_checked().
+#define BASE64_SKIP_WHITESPACE 1 /* Ignore whitespace, as in MIME */
+
+// Upper bound of the bytes base64_decode_checked() writes for `length`
+// characters, whitespace included.
+size_t base64_decoded_max_length(size_t length);
+
+// Same as base64_decode(), with `flags`. When the input is invalid, stores the
+// offset of the first character at fault in `error_offset`, or `length` if the
+// input ends in the middle of a group; stores BASE64_ERROR there if the input
+// is valid or the output doesn't fit. `error_offset` may be NULL.
+size_t base64_decode_checked(const char *input, size_t length,
+    uint8_t *output, size_t capacity, unsigned flags, size_t *error_offset);
+
+// Same as base64_decode_checked(), decoding the `length` characters at
+// `buffer` over themselves, front to back, so that the data ends up at its
+// start. The output is always shorter than the input, so nothing else needs
+// to be allocated. On error, the contents of `buffer` are unspecified.
+size_t base64_decode_in_place(
+    char *buffer, size_t length, unsigned flags, size_t *error_offset);
+
+// Streaming codecs, for inputs arriving in chunks of any size. Each update
+// encodes or decodes as much of the chunk as possible with the same kernels
+// as the codecs above, and carries the incomplete group left at its end over
+// to the next one; final flushes it, with the padding. The state is a few
+// bytes whatever the size of the whole input.
+//
+// The functions return the number of characters or bytes written, or
+// BASE64_ERROR if they don't fit in `capacity`, in which case the state is
+// left untouched. The *_update_length() functions tell how much the next
+// update will write at most.
+
+struct base64_encoder {
+    const struct base64_alphabet *alphabet;
+    uint8_t carry[3];
+    size_t carried;
+};
+
+void base64_encoder_init(struct base64_encoder *encoder);
+size_t base64_encoder_update_length(
+    const struct base64_encoder *encoder, size_t length);
+size_t base64_encoder_update(struct base64_encoder *encoder,
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+// Writes at most 4 characters.
+size_t base64_encoder_final(
+    struct base64_encoder *encoder, char *output, size_t capacity);
+
+struct base64_decoder {
+    const struct base64_alphabet *alphabet;
+    char carry[4];
+    size_t carried;
+    size_t padding; /* Number of padding characters seen so far */
+};
+
+void base64_decoder_init(struct base64_decoder *decoder);
+size_t base64_decoder_update_length(
+    const struct base64_decoder *decoder, size_t length);
+// Also returns BASE64_ERROR on a character outside of the alphabet, after
+// which the decoder has to be initialized again.
+size_t base64_decoder_update(struct base64_decoder *decoder, const char *input,
+    size_t length, uint8_t *output, size_t capacity);
+// Writes at most 2 bytes. Also returns BASE64_ERROR if the input ended in the
+// middle of a group or had misplaced padding.
+size_t base64_decoder_final(
+    struct base64_decoder *decoder, uint8_t *output, size_t capacity);
+
+// Zero-copy reader, for consumers that only scan the data: it decodes the
+// input lazily, one block of at most BASE64_READER_BLOCK bytes at a time,
+// into the reader itself, which fits on the stack.
+#define BASE64_READER_BLOCK 768
+
+struct base64_reader {
+    struct base64_decoder decoder;
+    const char *input;
+    size_t length;
+    size_t offset;
+    bool finished;
+    uint8_t block[BASE64_READER_BLOCK];
+};
+
+void base64_reader_init(
+    struct base64_reader *reader, const char *input, size_t length);
+// Decodes the next block and points `block` at it. Returns its size, 0 at the
+// end of the input, or BASE64_ERROR if the input is invalid, as
+// base64_decoder_update() and base64_decoder_final() would.
+size_t base64_reader_next(struct base64_reader *reader, const uint8_t **block);
+
+// The standard alphabet of RFC 4648, used by every function above, and the
+// URL and filename safe one, without padding. See base64_alphabet.h for
+// other alphabets.
+extern const struct base64_alphabet base64_standard;
+extern const struct base64_alphabet base64_url;
+
+size_t base64url_encode(
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+size_t base64url_decode(
+    const char *input, size_t length, uint8_t *output, size_t capacity);
+
+// The functions above, for any alphabet. Encoding writes no padding for the
+// alphabets without, and decoding then rejects it.
+size_t base64_encoded_length_with(
+    const struct base64_alphabet *alphabet, size_t length);
+size_t base64_decoded_length_with(
+    const struct base64_alphabet *alphabet, const char *input, size_t length);
+size_t base64_encode_with(const struct base64_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output, size_t capacity);
+size_t base64_decode_with(const struct base64_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output, size_t capacity,
+    unsigned flags, size_t *error_offset);
+void base64_encoder_init_with(
+    struct base64_encoder *encoder, const struct base64_alphabet *alphabet);
+void base64_decoder_init_with(
+    struct base64_decoder *decoder, const struct base64_alphabet *alphabet);
+size_t base64_decode_in_place_with(const struct base64_alphabet *alphabet,
+    char *buffer, size_t length, unsigned flags, size_t *error_offset);
+void base64_reader_init_with(struct base64_reader *reader,
+    const struct base64_alphabet *alphabet, const char *input, size_t length);
+
+// Same as base64_encode_with() and base64_decode_with() without flags, split
+// between at most `threads` threads, or one per online CPU if 0, for buffers
+// of many megabytes. Smaller inputs are handled on the calling thread.
+size_t base64_encode_parallel(const uint8_t *input, size_t length,
+    char *output, size_t capacity, unsigned threads);
+size_t base64_decode_parallel(const char *input, size_t length,
+    uint8_t *output, size_t capacity, unsigned threads);
+size_t base64_encode_parallel_with(const struct base64_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output, size_t capacity,
+    unsigned threads);
+size_t base64_decode_parallel_with(const struct base64_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output, size_t capacity,
+    unsigned threads);
+// Same as base64_decoder_update(), with the whole groups after the one
+// carried over split between threads the same way, for streams fed blocks of
+// many megabytes whatever their length.
+size_t base64_decoder_update_parallel(struct base64_decoder *decoder,
+    const char *input, size_t length, uint8_t *output, size_t capacity,
+    unsigned threads);
+
+// Implementations of the bulk of the work, from slowest to fastest. The
+// fastest one supported by the CPU is selected when the program starts.
+enum base64_kernel {
+    BASE64_SCALAR,
+    BASE64_WIDE,
+    BASE64_SSSE3,
+    BASE64_AVX2,
+    BASE64_AVX512,
+    BASE64_KERNELS
+};
+
+// Switches every codec to `kernel`. Returns false, leaving the current kernel
+// in place, if the CPU doesn't support it. Not thread-safe: meant for tests
+// and benchmarks.
+bool base64_set_kernel(enum base64_kernel kernel);
+
+enum base64_kernel base64_get_kernel(void);
+const char *base64_kernel_name(enum base64_kernel kernel);
+
 #endif
@@ -0,0 +1,155 @@
+/**
+ * Alphabets of the base64 codecs.
+ *
+ * An alphabet holds both of its translation tables. The ones made of 'A'-'Z',
+ * 'a'-'z', '0'-'9' and two other characters, like the standard alphabet and
+ * base64url, are written with BASE64_ALPHABET(), which generates the tables
+ * at compile time:
+ *
+ *     static const struct base64_alphabet imap = BASE64_ALPHABET('+', ',', 0);
+ *
+ * Those get every kernel. Any other alphabet of 64 ASCII characters can be
+ * set up at run time with base64_alphabet_init(), and is only supported by
+ * the scalar, wide and AVX-512 kernels.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef BASE64_ALPHABET_H
+#define BASE64_ALPHABET_H
+
+// The wide tables translate 12 bits at a time when encoding, and hold the bits
+// each character of a group contributes to its 3 bytes when decoding, at
+// their place in a 32-bit word as laid out in memory. The 4th byte of the
+// word is set for the characters outside of the alphabet.
+struct base64_alphabet {
+    uint32_t shifted[4][256]; /* Bits of the characters at each position */
+    char pairs[4096][2];      /* Characters of every 12-bit value */
+    char chars[64];           /* Character of every 6-bit value */
+    signed char values[256];  /* Value of every character, or -1 */
+    char padding;             /* Padding character, '\0' for no padding */
+    bool ranges;              /* Whether it's 'A'-'Z', 'a'-'z', '0'-'9'... */
+};
+
+// Sets `alphabet` up with `chars` and `padding`, which may be '\0' for no
+// padding. Returns false if the characters aren't all distinct and ASCII.
+bool base64_alphabet_init(
+    struct base64_alphabet *alphabet, const char *chars, char padding);
+
+#define BASE64_ALPHABET(c62, c63, padding)                                    \
+    {                                                                         \
+        { { BASE64_SHIFTED_(0, c62, c63) },                                   \
+            { BASE64_SHIFTED_(1, c62, c63) },                                 \
+            { BASE64_SHIFTED_(2, c62, c63) },                                 \
+            { BASE64_SHIFTED_(3, c62, c63) } },                               \
+            { BASE64_FOR64_A_(BASE64_PAIRS_, 0, c62, c63) },                  \
+            { BASE64_FOR64_A_(BASE64_CHAR_AT_, 0, c62, c63) },                \
+            { BASE64_VALUES_(0, c62, c63), BASE64_VALUES_(64, c62, c63),      \
+                BASE64_VALUES_(128, c62, c63),                                \
+                BASE64_VALUES_(192, c62, c63) },                              \
+            padding, true                                                     \
+    }
+
+// Character of the value `v`, and value of the character `c`, as constant
+// expressions.
+#define BASE64_CHAR_(v, c62, c63)                                             \
+    ((v) < 26 ? 'A' + (v)                                                     \
+            : (v) < 52 ? 'a' + (v) - 26                                       \
+            : (v) < 62 ? '0' + (v) - 52                                       \
+            : (v) == 62 ? (c62)                                               \
+                        : (c63))
+#define BASE64_VALUE_(c, c62, c63)                                            \
+    ((c) >= 'A' && (c) <= 'Z'         ? (c) - 'A'                             \
+            : (c) >= 'a' && (c) <= 'z' ? (c) - 'a' + 26                       \
+            : (c) >= '0' && (c) <= '9' ? (c) - '0' + 52                       \
+            : (c) == (c62)             ? 62                                   \
+            : (c) == (c63)             ? 63                                   \
+                                       : -1)
+
+#define BASE64_CHAR_AT_(x, v, c62, c63) BASE64_CHAR_(v, c62, c63)
+#define BASE64_VALUE_AT_(x, n, c62, c63) BASE64_VALUE_((x) + (n), c62, c63)
+#define BASE64_VALUES_(c, c62, c63)                                           \
+    BASE64_FOR64_A_(BASE64_VALUE_AT_, c, c62, c63)
+
+// The 64 pairs starting with the character of `high`.
+#define BASE64_PAIR_(high, low, c62, c63)                                     \
+    { BASE64_CHAR_(high, c62, c63), BASE64_CHAR_(low, c62, c63) }
+#define BASE64_PAIRS_(x, high, c62, c63)                                      \
+    BASE64_FOR64_B_(BASE64_PAIR_, high, c62, c63)
+
+// Bits the value `v` contributes to a group from position `k`.
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BASE64_INVALID_ 0x000000FFu
+#define BASE64_SHIFT_(v, k) ((uint32_t)(v) << (26 - 6 * (k)))
+#else
+#define BASE64_INVALID_ 0xFF000000u
+#define BASE64_SHIFT_(v, k)                                                   \
+    ((k) == 0       ? (uint32_t)(v) << 2                                      \
+            : (k) == 1 ? (uint32_t)(v) >> 4 | ((uint32_t)(v) & 15) << 12      \
+            : (k) == 2 ? (uint32_t)(v) >> 2 << 8 | ((uint32_t)(v) & 3) << 22  \
+                       : (uint32_t)(v) << 16)
+#endif
+
+#define BASE64_SHIFTED_AT_(x, n, c62, c63)                                    \
+    (BASE64_VALUE_(((x) & 255) + (n), c62, c63) < 0                           \
+            ? BASE64_INVALID_                                                 \
+            : BASE64_SHIFT_(                                                  \
+                BASE64_VALUE_(((x) & 255) + (n), c62, c63), (x) >> 8))
+#define BASE64_SHIFTED_(k, c62, c63)                                          \
+    BASE64_FOR64_A_(BASE64_SHIFTED_AT_, (k) << 8, c62, c63),                  \
+        BASE64_FOR64_A_(BASE64_SHIFTED_AT_, (k) << 8 | 64, c62, c63),         \
+        BASE64_FOR64_A_(BASE64_SHIFTED_AT_, (k) << 8 | 128, c62, c63),        \
+        BASE64_FOR64_A_(BASE64_SHIFTED_AT_, (k) << 8 | 192, c62, c63)
+
+// Expand to m(x, n, c62, c63) for every n from 0 to 63. There are two copies,
+// since a macro can't expand to itself.
+#define BASE64_FOR64_A_(m, x, c62, c63)                                       \
+    m(x, 0, c62, c63), m(x, 1, c62, c63), m(x, 2, c62, c63),                  \
+        m(x, 3, c62, c63), m(x, 4, c62, c63), m(x, 5, c62, c63),              \
+        m(x, 6, c62, c63), m(x, 7, c62, c63), m(x, 8, c62, c63),              \
+        m(x, 9, c62, c63), m(x, 10, c62, c63), m(x, 11, c62, c63),            \
+        m(x, 12, c62, c63), m(x, 13, c62, c63), m(x, 14, c62, c63),           \
+        m(x, 15, c62, c63), m(x, 16, c62, c63), m(x, 17, c62, c63),           \
+        m(x, 18, c62, c63), m(x, 19, c62, c63), m(x, 20, c62, c63),           \
+        m(x, 21, c62, c63), m(x, 22, c62, c63), m(x, 23, c62, c63),           \
+        m(x, 24, c62, c63), m(x, 25, c62, c63), m(x, 26, c62, c63),           \
+        m(x, 27, c62, c63), m(x, 28, c62, c63), m(x, 29, c62, c63),           \
+        m(x, 30, c62, c63), m(x, 31, c62, c63), m(x, 32, c62, c63),           \
+        m(x, 33, c62, c63), m(x, 34, c62, c63), m(x, 35, c62, c63),           \
+        m(x, 36, c62, c63), m(x, 37, c62, c63), m(x, 38, c62, c63),           \
+        m(x, 39, c62, c63), m(x, 40, c62, c63), m(x, 41, c62, c63),           \
+        m(x, 42, c62, c63), m(x, 43, c62, c63), m(x, 44, c62, c63),           \
+        m(x, 45, c62, c63), m(x, 46, c62, c63), m(x, 47, c62, c63),           \
+        m(x, 48, c62, c63), m(x, 49, c62, c63), m(x, 50, c62, c63),           \
+        m(x, 51, c62, c63), m(x, 52, c62, c63), m(x, 53, c62, c63),           \
+        m(x, 54, c62, c63), m(x, 55, c62, c63), m(x, 56, c62, c63),           \
+        m(x, 57, c62, c63), m(x, 58, c62, c63), m(x, 59, c62, c63),           \
+        m(x, 60, c62, c63), m(x, 61, c62, c63), m(x, 62, c62, c63),           \
+        m(x, 63, c62, c63)
+#define BASE64_FOR64_B_(m, x, c62, c63)                                       \
+    m(x, 0, c62, c63), m(x, 1, c62, c63), m(x, 2, c62, c63),                  \
+        m(x, 3, c62, c63), m(x, 4, c62, c63), m(x, 5, c62, c63),              \
+        m(x, 6, c62, c63), m(x, 7, c62, c63), m(x, 8, c62, c63),              \
+        m(x, 9, c62, c63), m(x, 10, c62, c63), m(x, 11, c62, c63),            \
+        m(x, 12, c62, c63), m(x, 13, c62, c63), m(x, 14, c62, c63),           \
+        m(x, 15, c62, c63), m(x, 16, c62, c63), m(x, 17, c62, c63),           \
+        m(x, 18, c62, c63), m(x, 19, c62, c63), m(x, 20, c62, c63),           \
+        m(x, 21, c62, c63), m(x, 22, c62, c63), m(x, 23, c62, c63),           \
+        m(x, 24, c62, c63), m(x, 25, c62, c63), m(x, 26, c62, c63),           \
+        m(x, 27, c62, c63), m(x, 28, c62, c63), m(x, 29, c62, c63),           \
+        m(x, 30, c62, c63), m(x, 31, c62, c63), m(x, 32, c62, c63),           \
+        m(x, 33, c62, c63), m(x, 34, c62, c63), m(x, 35, c62, c63),           \
+        m(x, 36, c62, c63), m(x, 37, c62, c63), m(x, 38, c62, c63),           \
+        m(x, 39, c62, c63), m(x, 40, c62, c63), m(x, 41, c62, c63),           \
+        m(x, 42, c62, c63), m(x, 43, c62, c63), m(x, 44, c62, c63),           \
+        m(x, 45, c62, c63), m(x, 46, c62, c63), m(x, 47, c62, c63),           \
+        m(x, 48, c62, c63), m(x, 49, c62, c63), m(x, 50, c62, c63),           \
+        m(x, 51, c62, c63), m(x, 52, c62, c63), m(x, 53, c62, c63),           \
+        m(x, 54, c62, c63), m(x, 55, c62, c63), m(x, 56, c62, c63),           \
+        m(x, 57, c62, c63), m(x, 58, c62, c63), m(x, 59, c62, c63),           \
+        m(x, 60, c62, c63), m(x, 61, c62, c63), m(x, 62, c62, c63),           \
+        m(x, 63, c62, c63)
+
+#endif
@@ -0,0 +1,203 @@
+/**
+ * Multi-threaded codecs for very large buffers.
+ *
+ * Base64 has no state beyond the group being encoded or decoded, so the input
+ * is cut into chunks of whole groups, each handled by the one-shot codecs of
+ * base64.c on a thread of its own, straight into its place in the output.
+ * Only the last chunk may hold an incomplete group, and with it the padding.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base64.h"
+
+// Most threads a single call starts.
+#define MAX_THREADS 64
+
+// Least work worth a thread of its own, in bytes of unencoded data. Below it,
+// starting the thread costs more than it saves.
+#define MIN_CHUNK (1 << 20)
+
+// Chunks are made of whole blocks of 16 groups, the unit of the widest
+// kernels, so that no thread but the last needs to deal with a tail.
+#define BLOCK_GROUPS 16
+
+struct job {
+    const struct base64_alphabet *alphabet;
+    const void *input;
+    size_t length;
+    void *output;
+    size_t capacity;
+    size_t result;
+};
+
+static void *encode_job(void *arg)
+{
+    struct job *job = arg;
+    job->result     = base64_encode_with(job->alphabet, job->input, job->length,
+            job->output, job->capacity);
+    return NULL;
+}
+
+static void *decode_job(void *arg)
+{
+    struct job *job = arg;
+    job->result     = base64_decode_with(job->alphabet, job->input, job->length,
+            job->output, job->capacity, 0, NULL);
+    return NULL;
+}
+
+// Splits `groups` groups into chunks of at least `min_groups` for at most
+// `threads` threads, or one per online CPU if 0. Stores the number of groups
+// per chunk in `chunk_groups` and returns the number of chunks, the last of
+// which is never empty.
+static unsigned split(
+    size_t groups, size_t min_groups, unsigned threads, size_t *chunk_groups)
+{
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads   = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if (threads > groups / min_groups)
+        threads = groups / min_groups;
+    if (threads <= 1) {
+        *chunk_groups = groups;
+        return 1;
+    }
+
+    size_t chunk  = (groups + threads - 1) / threads;
+    chunk         = (chunk + BLOCK_GROUPS - 1) / BLOCK_GROUPS * BLOCK_GROUPS;
+    *chunk_groups = chunk;
+    return (unsigned)((groups + chunk - 1) / chunk);
+}
+
+// Runs `function` on each of the `count` jobs, the first one on the calling
+// thread. A job whose thread can't be started runs on the calling thread too.
+static void run(struct job *jobs, unsigned count, void *(*function)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    bool started[MAX_THREADS];
+
+    for (unsigned t = 1; t < count; t++)
+        started[t] = pthread_create(&threads[t], NULL, function, &jobs[t]) == 0;
+    function(&jobs[0]);
+    for (unsigned t = 1; t < count; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            function(&jobs[t]);
+    }
+}
+
+size_t base64_encode_parallel_with(const struct base64_alphabet *alphabet,
+    const uint8_t *input, size_t length, char *output, size_t capacity,
+    unsigned threads)
+{
+    size_t encoded_length = base64_encoded_length_with(alphabet, length);
+    if (capacity < encoded_length)
+        return BASE64_ERROR;
+
+    size_t chunk_groups;
+    unsigned count = split(length / 3, MIN_CHUNK / 3, threads, &chunk_groups);
+
+    struct job jobs[MAX_THREADS];
+    for (unsigned t = 0; t < count; t++) {
+        size_t start = t * chunk_groups * 3;
+        size_t end   = t == count - 1 ? length : start + chunk_groups * 3;
+        jobs[t]      = (struct job) { alphabet, input + start, end - start,
+                 output + start / 3 * 4, capacity - start / 3 * 4, 0 };
+    }
+    run(jobs, count, encode_job);
+
+    return encoded_length;
+}
+
+size_t base64_decode_parallel_with(const struct base64_alphabet *alphabet,
+    const char *input, size_t length, uint8_t *output, size_t capacity,
+    unsigned threads)
+{
+    size_t chunk_groups;
+    unsigned count = split(length / 4, MIN_CHUNK / 3, threads, &chunk_groups);
+
+    // Every chunk but the last decodes to exactly 3 bytes per group.
+    size_t last = (count - 1) * chunk_groups * 3;
+    if (capacity < last)
+        return BASE64_ERROR;
+
+    struct job jobs[MAX_THREADS];
+    for (unsigned t = 0; t < count; t++) {
+        size_t start = t * chunk_groups * 4;
+        size_t end   = t == count - 1 ? length : start + chunk_groups * 4;
+        size_t room  = t == count - 1 ? capacity - last : chunk_groups * 3;
+        jobs[t]      = (struct job) { alphabet, input + start, end - start,
+                 output + start / 4 * 3, room, 0 };
+    }
+    run(jobs, count, decode_job);
+
+    // Any chunk but the last decoding to fewer bytes held padding.
+    for (unsigned t = 0; t < count - 1; t++)
+        if (jobs[t].result != chunk_groups * 3)
+            return BASE64_ERROR;
+    if (jobs[count - 1].result == BASE64_ERROR)
+        return BASE64_ERROR;
+    return last + jobs[count - 1].result;
+}
+
+size_t base64_decoder_update_parallel(struct base64_decoder *decoder,
+    const char *input, size_t length, uint8_t *output, size_t capacity,
+    unsigned threads)
+{
+    if (capacity < base64_decoder_update_length(decoder, length))
+        return BASE64_ERROR;
+
+    // Complete the carried group first, so that whole groups follow.
+    size_t start = 0, result = 0;
+    if (decoder->carried > 0 && decoder->padding == 0) {
+        start  = 4 - decoder->carried < length ? 4 - decoder->carried : length;
+        result = base64_decoder_update(decoder, input, start, output, capacity);
+        if (result == BASE64_ERROR)
+            return BASE64_ERROR;
+    }
+
+    // The whole groups before any padding go to the threads, and the rest to
+    // the decoder, which keeps track of the padding.
+    if (decoder->carried == 0 && decoder->padding == 0) {
+        char padding    = decoder->alphabet->padding;
+        const char *end = padding && start < length
+            ? memchr(input + start, padding, length - start)
+            : NULL;
+        size_t data  = end ? (size_t)(end - input) : length;
+        size_t chars = (data - start) / 4 * 4;
+        size_t bytes = chars / 4 * 3;
+        if (base64_decode_parallel_with(decoder->alphabet, input + start,
+                chars, output + result, capacity - result, threads)
+            != bytes)
+            return BASE64_ERROR;
+        start += chars;
+        result += bytes;
+    }
+
+    size_t bytes = base64_decoder_update(decoder, input + start,
+        length - start, output + result, capacity - result);
+    return bytes == BASE64_ERROR ? BASE64_ERROR : result + bytes;
+}
+
+size_t base64_encode_parallel(const uint8_t *input, size_t length,
+    char *output, size_t capacity, unsigned threads)
+{
+    return base64_encode_parallel_with(
+        &base64_standard, input, length, output, capacity, threads);
+}
+
+size_t base64_decode_parallel(const char *input, size_t length,
+    uint8_t *output, size_t capacity, unsigned threads)
+{
+    return base64_decode_parallel_with(
+        &base64_standard, input, length, output, capacity, threads);
+}
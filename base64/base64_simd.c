@@ -0,0 +1,397 @@
+/**
+ * SSSE3, AVX2 and AVX-512 VBMI base64 kernels.
+ *
+ * The functions are compiled with target attributes rather than -m flags, so
+ * the rest of the program still runs on any x86 CPU; base64.c only calls them
+ * after checking the CPU supports them.
+ *
+ * Encoding moves the 6-bit fields of every 3-byte group into their own bytes
+ * with a shuffle and two multiplications, then translates them to ASCII with
+ * a 16-entry shuffle lookup keyed by the range each value falls in. Decoding
+ * does the opposite: the ranges of the alphabet ('A'-'Z', 'a'-'z', '0'-'9',
+ * and the last two characters) are found with comparisons, which also
+ * validate the input, and two multiply-adds pack the 6-bit values back into
+ * bytes. Those kernels only support alphabets made of these ranges, the two
+ * last characters are broadcast once per call. AVX-512 VBMI has byte permutes
+ * across the whole register, so its kernels translate through the tables of
+ * any alphabet directly.
+ */
+
+#include "base64_simd.h"
+
+#ifdef BASE64_X86
+
+#include <immintrin.h>
+
+#define SSSE3 __attribute__((target("ssse3")))
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
+/*
+ * SSSE3
+ */
+
+// Spreads the 12 bytes at the start of `in` into 16 bytes, each holding one
+// 6-bit value.
+SSSE3 static inline __m128i encode_split(__m128i in)
+{
+    // Every group of 3 bytes becomes b1 b0 b2 b1, so that each 16-bit half
+    // holds two of the fields.
+    in = _mm_shuffle_epi8(
+        in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+    // Shift the first and third fields down to the bottom of their bytes...
+    __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+        _mm_set1_epi32(0x04000040));
+    // ...and the second and fourth ones up to the bottom of theirs.
+    __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+        _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(ac, bd);
+}
+
+// Offsets from the values of each range of the alphabet to its characters,
+// in the order of encode_translate().
+SSSE3 static inline __m128i encode_offsets(
+    const struct base64_alphabet *alphabet)
+{
+    return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        (char)(alphabet->chars[62] - 62), (char)(alphabet->chars[63] - 63),
+        'A', 0, 0);
+}
+
+// Translates 6-bit values to their characters.
+SSSE3 static inline __m128i encode_translate(__m128i indices, __m128i offsets)
+{
+    // Map every value to the range it falls in: 0 for 'a'-'z', 1 to 10 for
+    // '0'-'9', 11 and 12 for the last two characters and 13 for 'A'-'Z'...
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+    // ...and add the offset from the values of that range to its characters.
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+// The last two characters of an alphabet, and the offsets to their values.
+struct specials {
+    __m128i c62, c63, offset62, offset63;
+};
+
+SSSE3 static inline struct specials decode_specials(
+    const struct base64_alphabet *alphabet)
+{
+    struct specials specials = {
+        _mm_set1_epi8(alphabet->chars[62]),
+        _mm_set1_epi8(alphabet->chars[63]),
+        _mm_set1_epi8((char)(62 - alphabet->chars[62])),
+        _mm_set1_epi8((char)(63 - alphabet->chars[63])),
+    };
+    return specials;
+}
+
+// Translates characters to their 6-bit values, and sets every byte of
+// `valid` holding one from the alphabet.
+SSSE3 static inline __m128i decode_translate(
+    __m128i in, const struct specials *specials, __m128i *valid)
+{
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)),
+        _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), in));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)),
+        _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), in));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)),
+        _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), in));
+    __m128i c62   = _mm_cmpeq_epi8(in, specials->c62);
+    __m128i c63   = _mm_cmpeq_epi8(in, specials->c63);
+
+    __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    offset
+        = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset
+        = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(c62, specials->offset62));
+    offset = _mm_or_si128(offset, _mm_and_si128(c63, specials->offset63));
+
+    *valid = _mm_or_si128(_mm_or_si128(upper, lower),
+        _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+    return _mm_add_epi8(in, offset);
+}
+
+// Packs 16 6-bit values into the first 12 bytes.
+SSSE3 static inline __m128i decode_pack(__m128i values)
+{
+    // Merge pairs of values into 12 bits, then pairs of those into 24.
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    merged         = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+    // The 24 bits are stored little-endian, the output wants them big-endian.
+    return _mm_shuffle_epi8(merged,
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+SSSE3 size_t base64_encode_ssse3(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    const __m128i offsets = encode_offsets(alphabet);
+    size_t i              = 0;
+
+    // Every step reads 16 bytes but only consumes 12.
+    for (; len - i >= 16; i += 12, out += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(in + i));
+        block         = encode_translate(encode_split(block), offsets);
+        _mm_storeu_si128((__m128i *)out, block);
+    }
+
+    return i;
+}
+
+SSSE3 size_t base64_decode_ssse3(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    const struct specials specials = decode_specials(alphabet);
+    size_t i                       = 0;
+
+    // Validate 4 blocks at once, with a single branch on the combined masks.
+    for (; len - i >= 72; i += 64, out += 48) {
+        __m128i valid_a, valid_b, valid_c, valid_d;
+        __m128i block[4];
+        for (int j = 0; j < 4; j++)
+            block[j] = _mm_loadu_si128((const __m128i *)(in + i) + j);
+        __m128i a = decode_translate(block[0], &specials, &valid_a);
+        __m128i b = decode_translate(block[1], &specials, &valid_b);
+        __m128i c = decode_translate(block[2], &specials, &valid_c);
+        __m128i d = decode_translate(block[3], &specials, &valid_d);
+        __m128i valid = _mm_and_si128(
+            _mm_and_si128(valid_a, valid_b), _mm_and_si128(valid_c, valid_d));
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            break;
+        _mm_storeu_si128((__m128i *)out, decode_pack(a));
+        _mm_storeu_si128((__m128i *)(out + 12), decode_pack(b));
+        _mm_storeu_si128((__m128i *)(out + 24), decode_pack(c));
+        _mm_storeu_si128((__m128i *)(out + 36), decode_pack(d));
+    }
+
+    // Every step writes 16 bytes but only produces 12. Leaving at least 8
+    // characters for later guarantees the output has room for the other 4.
+    for (; len - i >= 24; i += 16, out += 12) {
+        __m128i valid;
+        __m128i block = _mm_loadu_si128((const __m128i *)(in + i));
+        block         = decode_translate(block, &specials, &valid);
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            break;
+        _mm_storeu_si128((__m128i *)out, decode_pack(block));
+    }
+
+    return i;
+}
+
+/*
+ * AVX2: the same algorithms, on two 128-bit lanes at a time.
+ */
+
+AVX2 static inline __m256i encode_split_avx2(__m256i in)
+{
+    in = _mm256_shuffle_epi8(in,
+        _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1,
+            0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+    __m256i ac = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    ac         = _mm256_mulhi_epu16(ac, _mm256_set1_epi32(0x04000040));
+    __m256i bd = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    bd         = _mm256_mullo_epi16(bd, _mm256_set1_epi32(0x01000010));
+
+    return _mm256_or_si256(ac, bd);
+}
+
+AVX2 static inline __m256i encode_translate_avx2(
+    __m256i indices, __m256i offsets)
+{
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range         = _mm256_or_si256(
+        range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+
+    return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+}
+
+AVX2 static inline __m256i in_range_avx2(__m256i in, char first, char last)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(first - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(last + 1), in));
+}
+
+struct specials_avx2 {
+    __m256i c62, c63, offset62, offset63;
+};
+
+AVX2 static inline struct specials_avx2 decode_specials_avx2(
+    const struct base64_alphabet *alphabet)
+{
+    struct specials_avx2 specials = {
+        _mm256_set1_epi8(alphabet->chars[62]),
+        _mm256_set1_epi8(alphabet->chars[63]),
+        _mm256_set1_epi8((char)(62 - alphabet->chars[62])),
+        _mm256_set1_epi8((char)(63 - alphabet->chars[63])),
+    };
+    return specials;
+}
+
+AVX2 static inline __m256i decode_translate_avx2(
+    __m256i in, const struct specials_avx2 *specials, __m256i *valid)
+{
+    __m256i upper = in_range_avx2(in, 'A', 'Z');
+    __m256i lower = in_range_avx2(in, 'a', 'z');
+    __m256i digit = in_range_avx2(in, '0', '9');
+    __m256i c62   = _mm256_cmpeq_epi8(in, specials->c62);
+    __m256i c63   = _mm256_cmpeq_epi8(in, specials->c63);
+
+    __m256i offset = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    offset = _mm256_or_si256(
+        offset, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    offset = _mm256_or_si256(
+        offset, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(c62, specials->offset62));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(c63, specials->offset63));
+
+    *valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+        _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+    return _mm256_add_epi8(in, offset);
+}
+
+AVX2 static inline __m256i decode_pack_avx2(__m256i values)
+{
+    __m256i merged
+        = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+
+    return _mm256_shuffle_epi8(merged,
+        _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+AVX2 size_t base64_encode_avx2(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    const __m256i offsets
+        = _mm256_broadcastsi128_si256(encode_offsets(alphabet));
+    size_t i = 0;
+
+    // Each lane gets its own 12 bytes, the second load reads 4 past them.
+    for (; len - i >= 28; i += 24, out += 32) {
+        __m256i block = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+            _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+        block = encode_translate_avx2(encode_split_avx2(block), offsets);
+        _mm256_storeu_si256((__m256i *)out, block);
+    }
+
+    return i;
+}
+
+AVX2 size_t base64_decode_avx2(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    const struct specials_avx2 specials = decode_specials_avx2(alphabet);
+    size_t i                            = 0;
+
+    for (; len - i >= 136; i += 128, out += 96) {
+        __m256i valid[4], block[4];
+        for (int j = 0; j < 4; j++)
+            block[j] = decode_translate_avx2(
+                _mm256_loadu_si256((const __m256i *)(in + i) + j), &specials,
+                &valid[j]);
+        __m256i all = _mm256_and_si256(_mm256_and_si256(valid[0], valid[1]),
+            _mm256_and_si256(valid[2], valid[3]));
+        if (_mm256_movemask_epi8(all) != -1)
+            break;
+        for (int j = 0; j < 4; j++) {
+            __m256i packed = decode_pack_avx2(block[j]);
+            _mm_storeu_si128(
+                (__m128i *)(out + 24 * j), _mm256_castsi256_si128(packed));
+            _mm_storeu_si128((__m128i *)(out + 24 * j + 12),
+                _mm256_extracti128_si256(packed, 1));
+        }
+    }
+
+    // As for SSSE3, the second store writes 4 bytes past the block.
+    for (; len - i >= 40; i += 32, out += 24) {
+        __m256i valid;
+        __m256i block = _mm256_loadu_si256((const __m256i *)(in + i));
+        block         = decode_translate_avx2(block, &specials, &valid);
+        if (_mm256_movemask_epi8(valid) != -1)
+            break;
+        block = decode_pack_avx2(block);
+        _mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(block));
+        _mm_storeu_si128(
+            (__m128i *)(out + 12), _mm256_extracti128_si256(block, 1));
+    }
+
+    return i;
+}
+
+/*
+ * AVX-512 VBMI: 48 bytes to 64 characters per step, with masked loads and
+ * stores so that nothing is read or written past the blocks.
+ */
+
+#define MASK_48 0xFFFFFFFFFFFFull
+
+AVX512 size_t base64_encode_avx512(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    // Byte i of the output is looked up from the (i % 4)th field of group
+    // i / 4, laid out as b1 b0 b2 b1 like the SSSE3 split.
+    const __m512i spread = _mm512_setr_epi32(0x01020001, 0x04050304,
+        0x07080607, 0x0a0b090a, 0x0d0e0c0d, 0x10110f10, 0x13141213, 0x16171516,
+        0x191a1819, 0x1c1d1b1c, 0x1f201e1f, 0x22232122, 0x25262425, 0x28292728,
+        0x2b2c2a2b, 0x2e2f2d2e);
+    // Bit offsets of the four fields within every 32 bits of the spread
+    // groups, the lookup ignores the 2 bits above each field.
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040aull);
+    const __m512i lookup = _mm512_loadu_si512(alphabet->chars);
+
+    size_t i = 0;
+    for (; len - i >= 48; i += 48, out += 64) {
+        __m512i block = _mm512_maskz_loadu_epi8(MASK_48, in + i);
+        block         = _mm512_permutexvar_epi8(spread, block);
+        block         = _mm512_multishift_epi64_epi8(shifts, block);
+        block         = _mm512_permutexvar_epi8(block, lookup);
+        _mm512_storeu_si512(out, block);
+    }
+
+    return i;
+}
+
+AVX512 size_t base64_decode_avx512(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    // Selects the 3 bytes of every 32-bit group, most significant first.
+    const __m512i pack = _mm512_setr_epi32(0x06000102, 0x090a0405,
+        0x0c0d0e08, 0x16101112, 0x191a1415, 0x1c1d1e18, 0x26202122, 0x292a2425,
+        0x2c2d2e28, 0x36303132, 0x393a3435, 0x3c3d3e38, 0, 0, 0, 0);
+    // Characters above 127 are never in the alphabet.
+    const __m512i low  = _mm512_loadu_si512(alphabet->values);
+    const __m512i high = _mm512_loadu_si512(alphabet->values + 64);
+
+    size_t i = 0;
+    for (; len - i >= 64; i += 64, out += 48) {
+        __m512i block = _mm512_loadu_si512(in + i);
+        __m512i value = _mm512_permutex2var_epi8(low, block, high);
+
+        // Characters above 127 and the ones not in the alphabet both end up
+        // with their high bit set.
+        if (_mm512_movepi8_mask(_mm512_or_si512(block, value)) != 0)
+            break;
+
+        value = _mm512_maddubs_epi16(value, _mm512_set1_epi32(0x01400140));
+        value = _mm512_madd_epi16(value, _mm512_set1_epi32(0x00011000));
+        value = _mm512_permutexvar_epi8(pack, value);
+        _mm512_mask_storeu_epi8(out, MASK_48, value);
+    }
+
+    return i;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * Kernels behind the codecs in base64.c, base32.c and base16.c.
+ *
+ * Every kernel only handles the bulk of the input: the encoders stop at the
+ * last complete block of groups (3 bytes in base64, 5 in base32, 1 in base16),
+ * the decoders at the first block containing a character outside of the
+ * alphabet (padding included). Both return how much of the input they
+ * consumed and leave the rest to the scalar code, so they never need to deal
+ * with tails.
+ */
+
+#include <stddef.h>
+
+#include "base32.h"
+#include "base64_alphabet.h"
+
+#ifndef BASE64_SIMD_H
+#define BASE64_SIMD_H
+
+// The portable kernels of base64_wide.c.
+size_t base64_encode_wide(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out);
+size_t base64_decode_wide(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BASE64_X86 1
+
+// Return the number of bytes consumed, always a multiple of 3. The SSSE3 and
+// AVX2 kernels only support alphabets with `ranges` set.
+size_t base64_encode_ssse3(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out);
+size_t base64_encode_avx2(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out);
+size_t base64_encode_avx512(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out);
+
+// Return the number of characters consumed, always a multiple of 4.
+size_t base64_decode_ssse3(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out);
+size_t base64_decode_avx2(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out);
+size_t base64_decode_avx512(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out);
+
+// The base32 kernels work on groups of 5 bytes and 8 characters.
+size_t base32_encode_avx512(const struct base32_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out);
+size_t base32_decode_avx512(const struct base32_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out);
+
+// The base16 kernels encode with the 16 `digits` given, and decode either
+// case, 2 characters per byte.
+size_t base16_encode_ssse3(
+    const char *digits, const unsigned char *in, size_t len, char *out);
+size_t base16_encode_avx2(
+    const char *digits, const unsigned char *in, size_t len, char *out);
+size_t base16_encode_avx512(
+    const char *digits, const unsigned char *in, size_t len, char *out);
+size_t base16_decode_ssse3(const char *in, size_t len, unsigned char *out);
+size_t base16_decode_avx2(const char *in, size_t len, unsigned char *out);
+size_t base16_decode_avx512(const char *in, size_t len, unsigned char *out);
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * Portable kernels, for CPUs without any of the vector extensions.
+ *
+ * The encoder reads 6 bytes at a time with a single 64-bit load and
+ * translates them 12 bits at a time through the pairs table of the alphabet,
+ * then finishes with 32-bit loads of 3 bytes. The decoder looks every
+ * character up in the table of its position within the group, which holds
+ * its bits already shifted into place, so that a group decodes with three
+ * ORs and one test for invalid characters.
+ */
+
+#include <string.h>
+
+#include "base64_simd.h"
+
+// Return the bytes at `in` as a big-endian number.
+static inline uint64_t load64(const unsigned char *in)
+{
+    uint64_t word;
+    memcpy(&word, in, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+static inline uint32_t load32(const unsigned char *in)
+{
+    uint32_t word;
+    memcpy(&word, in, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+#endif
+    return word;
+}
+
+size_t base64_encode_wide(const struct base64_alphabet *alphabet,
+    const unsigned char *in, size_t len, char *out)
+{
+    const char(*pairs)[2] = alphabet->pairs;
+    size_t i              = 0;
+
+    // Every step reads 8 bytes but only consumes 6.
+    for (; len - i >= 8; i += 6, out += 8) {
+        uint64_t word = load64(in + i);
+        memcpy(out, pairs[word >> 52], 2);
+        memcpy(out + 2, pairs[word >> 40 & 0xFFF], 2);
+        memcpy(out + 4, pairs[word >> 28 & 0xFFF], 2);
+        memcpy(out + 6, pairs[word >> 16 & 0xFFF], 2);
+    }
+
+    for (; len - i >= 4; i += 3, out += 4) {
+        uint32_t word = load32(in + i);
+        memcpy(out, pairs[word >> 20], 2);
+        memcpy(out + 2, pairs[word >> 8 & 0xFFF], 2);
+    }
+
+    return i;
+}
+
+// Returns the 3 bytes of the group at `in` in the first 3 bytes of the
+// result, or BASE64_INVALID_ bits if it holds an invalid character.
+static inline uint32_t decode_group(
+    const uint32_t (*shifted)[256], const char *in)
+{
+    return shifted[0][(unsigned char)in[0]] | shifted[1][(unsigned char)in[1]]
+        | shifted[2][(unsigned char)in[2]] | shifted[3][(unsigned char)in[3]];
+}
+
+size_t base64_decode_wide(const struct base64_alphabet *alphabet,
+    const char *in, size_t len, unsigned char *out)
+{
+    const uint32_t(*shifted)[256] = alphabet->shifted;
+    size_t i                      = 0;
+
+    // Two groups per step, stored 4 bytes at a time. Leaving at least one
+    // group for later guarantees the output has room for the extra byte.
+    for (; len - i >= 12; i += 8, out += 6) {
+        uint32_t a = decode_group(shifted, in + i);
+        uint32_t b = decode_group(shifted, in + i + 4);
+        if ((a | b) & BASE64_INVALID_)
+            break;
+        memcpy(out, &a, 4);
+        memcpy(out + 3, &b, 4);
+    }
+
+    for (; len - i >= 4; i += 4, out += 3) {
+        uint32_t a = decode_group(shifted, in + i);
+        if (a & BASE64_INVALID_)
+            break;
+        memcpy(out, &a, 3);
+    }
+
+    return i;
+}
@@ -0,0 +1,236 @@
+/**
+ * Measures the throughput, in GB/s of unencoded data, and the latency per call
+ * of every kernel supported by the CPU, from token-sized inputs up to 1 GiB,
+ * and of the parallel codecs on the largest ones:
+ *
+ *     ./benchmark [MAX_SIZE]
+ *
+ * Every size is verified first. Every kernel has to encode random inputs of
+ * up to that size, at any alignment, exactly like the scalar one, decode them
+ * back, and reject them with a character corrupted at the right offset. The
+ * measured runs are checked too.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base64.h"
+
+// Minimum time spent measuring each size, in seconds.
+#define DURATION 0.25
+
+// Random inputs checked per size, for the sizes small enough.
+#define FUZZ_ROUNDS 200
+#define FUZZ_MAX_SIZE (1 << 20)
+
+// Calls between two readings of the clock, so that reading it doesn't weigh
+// on the latency of the smallest inputs.
+#define BATCH_BYTES (1 << 16)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void check(bool ok, const char *what, size_t size, int kernel)
+{
+    if (!ok) {
+        fprintf(stderr, "%s failed on %zu bytes with the %s kernel\n", what,
+            size, kernel < 0 ? "parallel" : base64_kernel_name(kernel));
+        exit(1);
+    }
+}
+
+static void *xmalloc(size_t size)
+{
+    void *memory = malloc(size ? size : 1);
+    if (!memory) {
+        fprintf(stderr, "out of memory for %zu bytes\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+static void randomize(uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        data[i] = (uint8_t)rand();
+}
+
+// Cheap hash of an encoding, to compare the kernels without keeping a copy of
+// it around.
+static uint64_t hash(const char *data, size_t size)
+{
+    uint64_t h = 14695981039346656037u;
+    for (size_t i = 0; i < size; i++)
+        h = (h ^ (unsigned char)data[i]) * 1099511628211u;
+    return h;
+}
+
+// Round trips FUZZ_ROUNDS random inputs of at most `size` bytes, at random
+// offsets into the buffers, through every kernel.
+static void fuzz(size_t size)
+{
+    size_t capacity = base64_encoded_length(size);
+    uint8_t *input  = xmalloc(size + 64);
+    uint8_t *output = xmalloc(size + 64);
+    char *expected  = xmalloc(capacity);
+    char *encoded   = xmalloc(capacity + 64);
+
+    for (int round = 0; round < FUZZ_ROUNDS; round++) {
+        size_t length         = (size_t)rand() % (size + 1);
+        size_t encoded_length = base64_encoded_length(length);
+        uint8_t *in           = input + rand() % 64;
+        uint8_t *out          = output + rand() % 64;
+        char *text            = encoded + rand() % 64;
+        randomize(in, length);
+
+        base64_set_kernel(BASE64_SCALAR);
+        base64_encode(in, length, expected, capacity);
+
+        for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+            if (!base64_set_kernel(kernel))
+                continue;
+
+            check(base64_encode(in, length, text, encoded_length)
+                        == encoded_length
+                    && memcmp(text, expected, encoded_length) == 0,
+                "encoding", length, kernel);
+            check(base64_decode(text, encoded_length, out, length) == length
+                    && memcmp(out, in, length) == 0,
+                "decoding", length, kernel);
+
+            if (encoded_length == 0)
+                continue;
+            size_t at = (size_t)rand() % encoded_length, offset;
+            char c    = text[at];
+            text[at]  = "!*.\n\xff"[rand() % 5];
+            check(base64_decode_checked(
+                      text, encoded_length, out, length, 0, &offset)
+                        == BASE64_ERROR
+                    && offset == at,
+                "rejecting", length, kernel);
+            text[at] = c;
+        }
+    }
+
+    free(input);
+    free(output);
+    free(expected);
+    free(encoded);
+}
+
+struct run {
+    const uint8_t *input;
+    size_t size;
+    char *encoded;
+    size_t encoded_size;
+    uint8_t *decoded;
+    bool parallel;
+};
+
+static void encode_run(const struct run *run)
+{
+    if (run->parallel)
+        base64_encode_parallel(
+            run->input, run->size, run->encoded, run->encoded_size, 0);
+    else
+        base64_encode(run->input, run->size, run->encoded, run->encoded_size);
+}
+
+static void decode_run(const struct run *run)
+{
+    if (run->parallel)
+        base64_decode_parallel(
+            run->encoded, run->encoded_size, run->decoded, run->size, 0);
+    else
+        base64_decode(run->encoded, run->encoded_size, run->decoded, run->size);
+}
+
+// Returns the seconds per call of `function`.
+static double measure(void (*function)(const struct run *), struct run *run)
+{
+    size_t batch = BATCH_BYTES / (run->size + 1) + 1;
+    size_t calls = 0;
+    double start = now(), elapsed;
+    do {
+        for (size_t i = 0; i < batch; i++)
+            function(run);
+        calls += batch;
+    } while ((elapsed = now() - start) < DURATION);
+    return elapsed / calls;
+}
+
+// Measures `run` and checks its results, labeled `kernel`, or -1 for the
+// parallel codecs.
+static void benchmark_run(struct run *run, int kernel, uint64_t expected)
+{
+    double encoding = measure(encode_run, run);
+    check(hash(run->encoded, run->encoded_size) == expected, "encoding",
+        run->size, kernel);
+
+    memset(run->decoded, 0, run->size);
+    double decoding = measure(decode_run, run);
+    check(memcmp(run->decoded, run->input, run->size) == 0, "decoding",
+        run->size, kernel);
+
+    printf("%10zu %-8s %8.2f %8.2f %12.1f %12.1f\n", run->size,
+        kernel < 0 ? "parallel" : base64_kernel_name(kernel),
+        run->size / encoding * 1e-9, run->size / decoding * 1e-9,
+        encoding * 1e9, decoding * 1e9);
+}
+
+static void benchmark(size_t size)
+{
+    if (size <= FUZZ_MAX_SIZE)
+        fuzz(size);
+
+    uint8_t *input = xmalloc(size);
+    struct run run = { input, size, NULL, base64_encoded_length(size),
+        xmalloc(size), false };
+    run.encoded    = xmalloc(run.encoded_size);
+    randomize(input, size);
+
+    enum base64_kernel original = base64_get_kernel();
+    base64_set_kernel(BASE64_SCALAR);
+    base64_encode(input, size, run.encoded, run.encoded_size);
+    uint64_t expected = hash(run.encoded, run.encoded_size);
+
+    for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++)
+        if (base64_set_kernel(kernel))
+            benchmark_run(&run, kernel, expected);
+    base64_set_kernel(original);
+
+    // The parallel codecs, with every CPU and the fastest kernel.
+    if (size >= 1 << 24) {
+        run.parallel = true;
+        benchmark_run(&run, -1, expected);
+    }
+
+    free(input);
+    free(run.encoded);
+    free(run.decoded);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max_size = argc > 1 ? strtoull(argv[1], NULL, 0) : (size_t)1 << 30;
+
+    static const size_t sizes[] = { 16, 64, 256, 1 << 10, 1 << 12, 1 << 16,
+        1 << 20, 1 << 24, 1 << 28, 1 << 30 };
+
+    printf("%10s %-8s %8s %8s %12s %12s\n", "bytes", "kernel", "enc GB/s",
+        "dec GB/s", "enc ns", "dec ns");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        if (sizes[i] <= max_size)
+            benchmark(sizes[i]);
+    return 0;
+}
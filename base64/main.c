@@ -1,17 +1,43 @@
 #include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "base16.h"
+#include "base32.h"
 #include "base64.h"
 
 void test_encoding(void);
 void test_decoding(void);
+void test_buffers(void);
+void test_streaming(void);
+void test_validation(void);
+void test_alphabets(void);
+void test_kernels(void);
+void test_parallel(void);
+void test_decoder_parallel(void);
+void test_base32(void);
+void test_base16(void);
+void test_in_place(void);
+void test_reader(void);
 
 int main(void)
 {
     test_encoding();
     test_decoding();
+    test_buffers();
+    test_streaming();
+    test_validation();
+    test_alphabets();
+    test_kernels();
+    test_parallel();
+    test_decoder_parallel();
+    test_base32();
+    test_base16();
+    test_in_place();
+    test_reader();
     printf("All tests passed!\n");
     return 0;
 }
@@ -75,3 +101,827 @@ void test_decoding(void)
 
     printf("Decoding tests passed!\n");
 }
+
+void test_buffers(void)
+{
+    // Binary data, NUL bytes included, into stack buffers.
+    const uint8_t binary[] = { 0x00, 0xFF, 0x00, 0x10, 0x00 };
+    char encoded[8];
+    uint8_t decoded[5];
+
+    assert(base64_encoded_length(0) == 0);
+    assert(base64_encoded_length(sizeof(binary)) == sizeof(encoded));
+    assert(base64_encode(binary, sizeof(binary), encoded, sizeof(encoded))
+        == sizeof(encoded));
+    assert(memcmp(encoded, "AP8AEAA=", sizeof(encoded)) == 0);
+
+    assert(base64_decoded_length(encoded, sizeof(encoded)) == sizeof(binary));
+    assert(base64_decode(encoded, sizeof(encoded), decoded, sizeof(decoded))
+        == sizeof(decoded));
+    assert(memcmp(decoded, binary, sizeof(binary)) == 0);
+
+    // Padding is optional.
+    memset(decoded, 0, sizeof(decoded));
+    assert(base64_decoded_length(encoded, 7) == sizeof(binary));
+    assert(base64_decode(encoded, 7, decoded, sizeof(decoded))
+        == sizeof(decoded));
+    assert(memcmp(decoded, binary, sizeof(binary)) == 0);
+
+    // Exact sizes of every tail.
+    assert(base64_decoded_length("", 0) == 0);
+    assert(base64_decoded_length("YQ==", 4) == 1);
+    assert(base64_decoded_length("YWI=", 4) == 2);
+    assert(base64_decoded_length("YWJj", 4) == 3);
+    assert(base64_decoded_length("YWJjZ", 5) == BASE64_ERROR);
+
+    // Outputs that don't fit are left alone.
+    assert(base64_encode(binary, sizeof(binary), encoded, 7) == BASE64_ERROR);
+    assert(base64_decode(encoded, sizeof(encoded), decoded, 4) == BASE64_ERROR);
+    assert(base64_decode("YWJjZ", 5, decoded, 5) == BASE64_ERROR);
+
+    printf("Buffer tests passed!\n");
+}
+
+// Encodes and decodes random data in chunks of random sizes, and compares
+// with the one-shot codecs.
+void test_streaming(void)
+{
+    enum { LENGTH = 4096 };
+    uint8_t *input   = malloc(LENGTH);
+    uint8_t *decoded = malloc(LENGTH);
+    char *expected   = malloc(base64_encoded_length(LENGTH));
+    char *encoded    = malloc(base64_encoded_length(LENGTH));
+
+    srand(7);
+    for (int round = 0; round < 200; round++) {
+        size_t length = rand() % LENGTH;
+        for (size_t i = 0; i < length; i++)
+            input[i] = (uint8_t)rand();
+        size_t encoded_length = base64_encoded_length(length);
+        base64_encode(input, length, expected, encoded_length);
+
+        // Chunks up to 100 bytes, empty ones included.
+        struct base64_encoder encoder;
+        base64_encoder_init(&encoder);
+        size_t written = 0;
+        for (size_t done = 0, chunk; done < length; done += chunk) {
+            chunk = rand() % 101;
+            if (chunk > length - done)
+                chunk = length - done;
+            size_t expected_written
+                = base64_encoder_update_length(&encoder, chunk);
+            assert(base64_encoder_update(&encoder, input + done, chunk,
+                       encoded + written, encoded_length - written)
+                == expected_written);
+            written += expected_written;
+        }
+        written += base64_encoder_final(
+            &encoder, encoded + written, encoded_length - written);
+        assert(written == encoded_length);
+        assert(memcmp(encoded, expected, encoded_length) == 0);
+
+        // The padding may arrive on its own, split or not.
+        struct base64_decoder decoder;
+        base64_decoder_init(&decoder);
+        written = 0;
+        for (size_t done = 0, chunk; done < encoded_length; done += chunk) {
+            chunk = rand() % 101;
+            if (chunk > encoded_length - done)
+                chunk = encoded_length - done;
+            size_t result = base64_decoder_update(&decoder, encoded + done,
+                chunk, decoded + written, length - written);
+            assert(result != BASE64_ERROR);
+            written += result;
+        }
+        written += base64_decoder_final(
+            &decoder, decoded + written, length - written);
+        assert(written == length);
+        assert(memcmp(decoded, input, length) == 0);
+    }
+
+    // Misplaced padding and truncated groups.
+    struct base64_decoder decoder;
+    uint8_t output[8];
+    base64_decoder_init(&decoder);
+    assert(base64_decoder_update(&decoder, "YQ=", 3, output, 8) == 0);
+    assert(base64_decoder_update(&decoder, "Y", 1, output, 8) == BASE64_ERROR);
+    assert(base64_decoder_update(&decoder, "==", 2, output, 8) == BASE64_ERROR);
+    assert(base64_decoder_update(&decoder, "=", 1, output, 8) == 0);
+    assert(base64_decoder_final(&decoder, output, 8) == 1 && output[0] == 'a');
+
+    base64_decoder_init(&decoder);
+    assert(base64_decoder_update(&decoder, "YWJjZ", 5, output, 8) == 3);
+    assert(base64_decoder_final(&decoder, output, 8) == BASE64_ERROR);
+
+    // Outputs that don't fit are left alone.
+    struct base64_encoder encoder;
+    char text[8];
+    base64_encoder_init(&encoder);
+    assert(base64_encoder_update(&encoder, (const uint8_t *)"abcd", 4, text, 3)
+        == BASE64_ERROR);
+    assert(base64_encoder_update(&encoder, (const uint8_t *)"abcd", 4, text, 4)
+        == 4);
+    assert(base64_encoder_final(&encoder, text + 4, 3) == BASE64_ERROR);
+    assert(base64_encoder_final(&encoder, text + 4, 4) == 4);
+    assert(memcmp(text, "YWJjZA==", 8) == 0);
+
+    free(input);
+    free(decoded);
+    free(expected);
+    free(encoded);
+    printf("Streaming tests passed!\n");
+}
+
+// Decodes `input` with `flags`, and returns the error offset, or the decoded
+// length if there was no error.
+static size_t check(const char *input, unsigned flags)
+{
+    uint8_t output[64];
+    size_t error;
+    size_t length = base64_decode_checked(
+        input, strlen(input), output, sizeof(output), flags, &error);
+    assert((length == BASE64_ERROR) != (error == BASE64_ERROR));
+    return length == BASE64_ERROR ? error : length;
+}
+
+void test_validation(void)
+{
+    assert(check("YWJj", 0) == 3);
+    assert(check("YW=j", 0) == 3);
+    assert(check("YWJ!", 0) == 3);
+    assert(check("YWJjZ", 0) == 5);
+    assert(check("YQ=", 0) == 3);
+    assert(check("YQ===", 0) == 4);
+    assert(check("YWJj=", 0) == 4);
+    assert(check("=", 0) == 0);
+    assert(check("====", 0) == 0);
+    assert(check("YWJj====", 0) == 4);
+    assert(check("YQ==YQ==", 0) == 4);
+    assert(check("YWJj\r\nZA==", 0) == 4);
+
+    // MIME-style line breaks and stray whitespace anywhere.
+    assert(check("YWJj\r\nZA==", BASE64_SKIP_WHITESPACE) == 4);
+    assert(check(" Y W\tJ j Z\nA = = \r\n", BASE64_SKIP_WHITESPACE) == 4);
+    assert(check("YWJj\r\nZA=!", BASE64_SKIP_WHITESPACE) == 9);
+    assert(check("\n\n", BASE64_SKIP_WHITESPACE) == 0);
+
+    // A group of padding alone, which decodes to nothing but is no more valid
+    // in place or split between threads.
+    char padding[] = "====";
+    uint8_t bytes[3];
+    assert(base64_decode(padding, 4, bytes, sizeof(bytes)) == BASE64_ERROR);
+    assert(base64_decode_in_place(padding, 4, 0, NULL) == BASE64_ERROR);
+    assert(base64_decode_parallel("YWJj====", 8, bytes, sizeof(bytes), 2)
+        == BASE64_ERROR);
+
+    // An invalid character at every position of inputs long enough for the
+    // kernels, found by every one of them.
+    enum { LENGTH = 300 };
+    char input[LENGTH];
+    uint8_t output[LENGTH];
+    for (size_t i = 0; i < LENGTH; i++)
+        input[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                   "0123456789+/"[i * 7 % 64];
+
+    enum base64_kernel original = base64_get_kernel();
+    for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+        if (!base64_set_kernel(kernel))
+            continue;
+        for (size_t i = 0; i < LENGTH; i++) {
+            char saved = input[i];
+            size_t error;
+            for (size_t j = 0; j < 3; j++) {
+                input[i] = "*\x80\n"[j];
+                assert(base64_decode_checked(input, LENGTH, output, LENGTH, 0,
+                           &error)
+                        == BASE64_ERROR
+                    && error == i);
+            }
+            input[i] = saved;
+        }
+
+        // The same text, wrapped at 76 characters.
+        char wrapped[LENGTH + LENGTH / 76 * 2];
+        size_t length = 0;
+        for (size_t i = 0; i < LENGTH; i++) {
+            if (i > 0 && i % 76 == 0) {
+                wrapped[length++] = '\r';
+                wrapped[length++] = '\n';
+            }
+            wrapped[length++] = input[i];
+        }
+        uint8_t expected[LENGTH];
+        assert(base64_decode(input, LENGTH, expected, LENGTH)
+            == LENGTH / 4 * 3);
+        assert(base64_decode_checked(wrapped, length, output,
+                   LENGTH / 4 * 3, BASE64_SKIP_WHITESPACE, NULL)
+            == LENGTH / 4 * 3);
+        assert(memcmp(output, expected, LENGTH / 4 * 3) == 0);
+    }
+    base64_set_kernel(original);
+
+    printf("Validation tests passed!\n");
+}
+
+// Round-trips random data of every length up to 300 through `alphabet`, on
+// every kernel, and compares with the scalar encoding.
+static void check_alphabet(const struct base64_alphabet *alphabet)
+{
+    enum { LENGTH = 300 };
+    uint8_t input[LENGTH], decoded[LENGTH];
+    char expected[LENGTH * 2], encoded[LENGTH * 2];
+    enum base64_kernel original = base64_get_kernel();
+
+    for (size_t length = 0; length <= LENGTH; length++) {
+        for (size_t i = 0; i < length; i++)
+            input[i] = (uint8_t)rand();
+        size_t encoded_length = base64_encoded_length_with(alphabet, length);
+
+        base64_set_kernel(BASE64_SCALAR);
+        assert(base64_encode_with(
+                   alphabet, input, length, expected, encoded_length)
+            == encoded_length);
+
+        for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+            if (!base64_set_kernel(kernel))
+                continue;
+            assert(base64_encode_with(
+                       alphabet, input, length, encoded, encoded_length)
+                == encoded_length);
+            assert(memcmp(encoded, expected, encoded_length) == 0);
+            assert(base64_decode_with(alphabet, encoded, encoded_length,
+                       decoded, length, 0, NULL)
+                == length);
+            assert(memcmp(decoded, input, length) == 0);
+        }
+    }
+
+    base64_set_kernel(original);
+}
+
+void test_alphabets(void)
+{
+    const uint8_t input[] = { 0xFB, 0xFF };
+    char encoded[4];
+    uint8_t decoded[2];
+
+    assert(base64_encode(input, 2, encoded, 4) == 4);
+    assert(memcmp(encoded, "+/8=", 4) == 0);
+    assert(base64url_encode(input, 2, encoded, 4) == 3);
+    assert(memcmp(encoded, "-_8", 3) == 0);
+    assert(base64url_decode("-_8", 3, decoded, 2) == 2);
+    assert(memcmp(decoded, input, 2) == 0);
+    assert(base64url_decode("-_8=", 4, decoded, 2) == BASE64_ERROR);
+    assert(base64url_decode("+/8", 3, decoded, 2) == BASE64_ERROR);
+    assert(base64_encoded_length_with(&base64_url, 4) == 6);
+    assert(base64_decoded_length_with(&base64_url, "YWJjZA", 6) == 4);
+
+    // The tables generated at compile time match the ones built at run time.
+    struct base64_alphabet url;
+    assert(base64_alphabet_init(&url, base64_url.chars, 0));
+    assert(memcmp(url.shifted, base64_url.shifted, sizeof(url.shifted)) == 0);
+    assert(memcmp(url.pairs, base64_url.pairs, sizeof(url.pairs)) == 0);
+    assert(memcmp(url.chars, base64_url.chars, sizeof(url.chars)) == 0);
+    assert(memcmp(url.values, base64_url.values, sizeof(url.values)) == 0);
+    assert(url.padding == base64_url.padding && url.ranges);
+
+    // Alphabets that aren't made of ranges, or invalid.
+    struct base64_alphabet reversed;
+    char chars[64];
+    for (int i = 0; i < 64; i++)
+        chars[i] = base64_standard.chars[63 - i];
+    assert(base64_alphabet_init(&reversed, chars, '='));
+    assert(!reversed.ranges);
+    assert(!base64_alphabet_init(&url, chars, '+'));
+    chars[0] = chars[1];
+    assert(!base64_alphabet_init(&url, chars, 0));
+    chars[0] = (char)0xC0;
+    assert(!base64_alphabet_init(&url, chars, 0));
+
+    // Every alphabet, on every kernel.
+    static const struct base64_alphabet imap = BASE64_ALPHABET('+', ',', 0);
+    srand(11);
+    check_alphabet(&base64_standard);
+    check_alphabet(&base64_url);
+    check_alphabet(&imap);
+    check_alphabet(&reversed);
+
+    // Streaming, with the same alphabet.
+    struct base64_encoder encoder;
+    base64_encoder_init_with(&encoder, &base64_url);
+    assert(base64_encoder_update(&encoder, input, 1, encoded, 4) == 0);
+    assert(base64_encoder_update(&encoder, input + 1, 1, encoded, 4) == 0);
+    assert(base64_encoder_final(&encoder, encoded, 4) == 3);
+    assert(memcmp(encoded, "-_8", 3) == 0);
+
+    struct base64_decoder decoder;
+    base64_decoder_init_with(&decoder, &base64_url);
+    assert(base64_decoder_update(&decoder, "-_8", 3, decoded, 2) == 0);
+    assert(base64_decoder_final(&decoder, decoded, 2) == 2);
+    assert(memcmp(decoded, input, 2) == 0);
+
+    printf("Alphabet tests passed!\n");
+}
+
+// Checks every kernel the CPU supports against the scalar code, on all the
+// lengths around the block sizes of the kernels.
+void test_kernels(void)
+{
+    enum base64_kernel original = base64_get_kernel();
+    uint8_t *input              = malloc(1024);
+    uint8_t *decoded            = malloc(1024);
+    char *expected              = malloc(base64_encoded_length(1024));
+    char *encoded               = malloc(base64_encoded_length(1024));
+
+    srand(42);
+    for (size_t length = 0; length <= 1024; length++) {
+        // Every buffer ends where its allocation does, so that the sanitizers
+        // catch any access past it.
+        size_t encoded_length = base64_encoded_length(length);
+        uint8_t *in           = input + 1024 - length;
+        uint8_t *out          = decoded + 1024 - length;
+        char *text            = encoded + base64_encoded_length(1024)
+            - encoded_length;
+
+        for (size_t i = 0; i < length; i++)
+            in[i] = (uint8_t)rand();
+
+        base64_set_kernel(BASE64_SCALAR);
+        base64_encode(in, length, expected, encoded_length);
+
+        for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+            if (!base64_set_kernel(kernel))
+                continue;
+
+            assert(base64_encode(in, length, text, encoded_length)
+                == encoded_length);
+            assert(memcmp(text, expected, encoded_length) == 0);
+
+            assert(base64_decode(text, encoded_length, out, length) == length);
+            assert(memcmp(out, in, length) == 0);
+        }
+    }
+
+    for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++)
+        if (base64_set_kernel(kernel))
+            printf("Kernel %s tests passed!\n", base64_kernel_name(kernel));
+
+    free(input);
+    free(decoded);
+    free(expected);
+    free(encoded);
+    base64_set_kernel(original);
+}
+
+void test_parallel(void)
+{
+    // Large enough to be split between 3 threads, with an incomplete group.
+    size_t length         = (3 << 20) + 2;
+    size_t encoded_length = base64_encoded_length(length);
+    uint8_t *input        = malloc(length);
+    uint8_t *decoded      = malloc(length);
+    char *expected        = malloc(encoded_length);
+    char *encoded         = malloc(encoded_length);
+
+    srand(42);
+    for (size_t i = 0; i < length; i++)
+        input[i] = (uint8_t)rand();
+    base64_encode(input, length, expected, encoded_length);
+
+    for (unsigned threads = 0; threads <= 4; threads++) {
+        assert(base64_encode_parallel(
+                   input, length, encoded, encoded_length, threads)
+            == encoded_length);
+        assert(memcmp(encoded, expected, encoded_length) == 0);
+
+        assert(base64_decode_parallel(
+                   encoded, encoded_length, decoded, length, threads)
+            == length);
+        assert(memcmp(decoded, input, length) == 0);
+    }
+
+    // Buffers too small, by a byte.
+    assert(base64_encode_parallel(input, length, encoded, encoded_length - 1, 4)
+        == BASE64_ERROR);
+    assert(base64_decode_parallel(encoded, encoded_length, decoded, length - 1,
+               4)
+        == BASE64_ERROR);
+
+    // Padding in the middle, at the end of a group wherever the chunks end.
+    for (size_t i = 4; i < encoded_length; i += encoded_length / 7 / 4 * 4) {
+        memcpy(encoded + i - 2, "==", 2);
+        assert(base64_decode_parallel(
+                   encoded, encoded_length, decoded, length, 4)
+            == BASE64_ERROR);
+        memcpy(encoded + i - 2, expected + i - 2, 2);
+    }
+
+    // Without padding.
+    size_t url_length = base64_encoded_length_with(&base64_url, length);
+    assert(base64_encode_parallel_with(
+               &base64_url, input, length, encoded, encoded_length, 4)
+        == url_length);
+    assert(base64_decode_parallel_with(
+               &base64_url, encoded, url_length, decoded, length, 4)
+        == length);
+    assert(memcmp(decoded, input, length) == 0);
+
+    free(input);
+    free(decoded);
+    free(expected);
+    free(encoded);
+    printf("Parallel tests passed!\n");
+}
+
+// Threads started so far, counted by wrapping pthread_create() when linking,
+// see the Makefile.
+static unsigned threads_started;
+
+int __real_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+    void *(*start)(void *), void *arg);
+
+int __wrap_pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+    void *(*start)(void *), void *arg)
+{
+    threads_started++;
+    return __real_pthread_create(thread, attr, start, arg);
+}
+
+void test_decoder_parallel(void)
+{
+    // Blocks as long as b64 joins from wrapped lines, each enough for 2
+    // threads, which leave 1 to 3 characters carried over to the next.
+    size_t length         = (9 << 20) + 1;
+    size_t encoded_length = base64_encoded_length(length);
+    size_t blocks[]       = { (3 << 20) + 1, (3 << 20) + 2, (3 << 20) + 3 };
+    uint8_t *input        = malloc(length);
+    uint8_t *decoded      = malloc(length + 2);
+    char *encoded         = malloc(encoded_length);
+
+    srand(42);
+    for (size_t i = 0; i < length; i++)
+        input[i] = (uint8_t)rand();
+    base64_encode(input, length, encoded, encoded_length);
+
+    struct base64_decoder decoder;
+    base64_decoder_init(&decoder);
+    size_t read = 0, written = 0;
+    for (size_t b = 0; read < encoded_length; b++) {
+        size_t block     = b < 3 ? blocks[b] : encoded_length - read;
+        unsigned started = threads_started;
+        size_t bytes     = base64_decoder_update_parallel(&decoder,
+                encoded + read, block, decoded + written, length + 2 - written,
+                2);
+        assert(bytes != BASE64_ERROR);
+        assert(threads_started == started + 1);
+        assert(decoder.carried == (read + block) % 4 || decoder.padding > 0);
+        read += block;
+        written += bytes;
+    }
+    written += base64_decoder_final(&decoder, decoded + written, 2);
+    assert(written == length);
+    assert(memcmp(decoded, input, length) == 0);
+
+    // Misplaced padding, carried over or not.
+    base64_decoder_init(&decoder);
+    assert(base64_decoder_update_parallel(&decoder, "QQ", 2, decoded, 3, 2)
+        == 0);
+    assert(base64_decoder_update_parallel(&decoder, "==QUJD", 6, decoded, 3, 2)
+        == BASE64_ERROR);
+    base64_decoder_init(&decoder);
+    assert(base64_decoder_update_parallel(&decoder, "QUJD=QUJD", 9, decoded, 6,
+               2)
+        == BASE64_ERROR);
+
+    free(input);
+    free(decoded);
+    free(encoded);
+    printf("Parallel streaming tests passed!\n");
+}
+
+// Checks the encoding of `string` with `alphabet`, and decodes it back.
+static void check_base32(const struct base32_alphabet *alphabet,
+    const char *string, const char *expected)
+{
+    size_t length = strlen(string), encoded_length = strlen(expected);
+    char encoded[32];
+    uint8_t decoded[16];
+
+    assert(base32_encoded_length(length) == encoded_length);
+    assert(base32_encode_with(alphabet, (const uint8_t *)string, length,
+               encoded, encoded_length)
+        == encoded_length);
+    assert(memcmp(encoded, expected, encoded_length) == 0);
+
+    assert(base32_decoded_length_with(alphabet, expected, encoded_length)
+        == length);
+    assert(base32_decode_with(
+               alphabet, expected, encoded_length, decoded, length)
+        == length);
+    assert(memcmp(decoded, string, length) == 0);
+
+    // Without the padding.
+    size_t unpadded = strcspn(expected, "=");
+    assert(base32_decode_with(alphabet, expected, unpadded, decoded, length)
+        == length);
+}
+
+void test_base32(void)
+{
+    // The test vectors of RFC 4648.
+    static const char *strings[] = { "", "f", "fo", "foo", "foob", "fooba",
+        "foobar" };
+    static const char *standard[] = { "", "MY======", "MZXQ====", "MZXW6===",
+        "MZXW6YQ=", "MZXW6YTB", "MZXW6YTBOI======" };
+    static const char *hex[] = { "", "CO======", "CPNG====", "CPNMU===",
+        "CPNMUOG=", "CPNMUOJ1", "CPNMUOJ1E8======" };
+    for (int i = 0; i < 7; i++) {
+        check_base32(&base32_standard, strings[i], standard[i]);
+        check_base32(&base32_hex, strings[i], hex[i]);
+    }
+
+    // Invalid characters, lengths and padding, and buffers too small.
+    uint8_t output[16];
+    assert(base32_decode("MZXW6YT!", 8, output, 16) == BASE32_ERROR);
+    assert(base32_decode("mzxw6ytb", 8, output, 16) == BASE32_ERROR);
+    assert(base32_decode("MZX=====", 8, output, 16) == BASE32_ERROR);
+    assert(base32_decode("MZXW6YQ", 7, output, 16) == 4);
+    assert(base32_decode("MZXW6Y", 6, output, 16) == BASE32_ERROR);
+    assert(base32_decode("MY=", 3, output, 16) == BASE32_ERROR);
+    assert(base32_decode("MY======MY======", 16, output, 16) == BASE32_ERROR);
+    assert(base32_decode("MZXW6YTB", 8, output, 4) == BASE32_ERROR);
+    assert(base32_encode((const uint8_t *)"f", 1, (char *)output, 7)
+        == BASE32_ERROR);
+
+    // Every kernel against the scalar one, with every buffer ending where its
+    // allocation does, and in chunks.
+    enum { LENGTH = 1000 };
+    enum base64_kernel original = base64_get_kernel();
+    size_t capacity             = base32_encoded_length(LENGTH);
+    uint8_t *input              = malloc(LENGTH);
+    uint8_t *decoded            = malloc(LENGTH);
+    char *expected              = malloc(capacity);
+    char *encoded               = malloc(capacity);
+
+    srand(32);
+    for (size_t length = 0; length <= LENGTH; length += 1 + length / 16) {
+        size_t encoded_length = base32_encoded_length(length);
+        uint8_t *in           = input + LENGTH - length;
+        uint8_t *out          = decoded + LENGTH - length;
+        char *text            = encoded + capacity - encoded_length;
+        for (size_t i = 0; i < length; i++)
+            in[i] = (uint8_t)rand();
+
+        base64_set_kernel(BASE64_SCALAR);
+        base32_encode(in, length, expected, encoded_length);
+
+        for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+            if (!base64_set_kernel(kernel))
+                continue;
+
+            assert(base32_encode(in, length, text, encoded_length)
+                == encoded_length);
+            assert(memcmp(text, expected, encoded_length) == 0);
+            assert(base32_decode(text, encoded_length, out, length) == length);
+            assert(memcmp(out, in, length) == 0);
+
+            // A character corrupted anywhere.
+            if (encoded_length > 0) {
+                size_t at = rand() % encoded_length;
+                char c    = text[at];
+                text[at]  = '1';
+                assert(base32_decode(text, encoded_length, out, length)
+                    == BASE32_ERROR);
+                text[at] = c;
+            }
+        }
+
+        struct base32_encoder encoder;
+        struct base32_decoder decoder;
+        size_t written = 0;
+        base32_encoder_init(&encoder);
+        for (size_t done = 0, chunk; done < length; done += chunk) {
+            chunk = rand() % 20;
+            if (chunk > length - done)
+                chunk = length - done;
+            written += base32_encoder_update(&encoder, in + done, chunk,
+                text + written, encoded_length - written);
+        }
+        written += base32_encoder_final(
+            &encoder, text + written, encoded_length - written);
+        assert(written == encoded_length);
+        assert(memcmp(text, expected, encoded_length) == 0);
+
+        written = 0;
+        base32_decoder_init(&decoder);
+        for (size_t done = 0, chunk; done < encoded_length; done += chunk) {
+            chunk = rand() % 20;
+            if (chunk > encoded_length - done)
+                chunk = encoded_length - done;
+            size_t result = base32_decoder_update(&decoder, text + done, chunk,
+                out + written, length - written);
+            assert(result != BASE32_ERROR);
+            written += result;
+        }
+        written += base32_decoder_final(
+            &decoder, out + written, length - written);
+        assert(written == length);
+        assert(memcmp(out, in, length) == 0);
+    }
+
+    free(input);
+    free(decoded);
+    free(expected);
+    free(encoded);
+    base64_set_kernel(original);
+    printf("Base32 tests passed!\n");
+}
+
+void test_base16(void)
+{
+    // The test vector of RFC 4648, and both cases.
+    char encoded[16];
+    uint8_t output[8];
+    assert(base16_encode((const uint8_t *)"foobar", 6, encoded, 12) == 12);
+    assert(memcmp(encoded, "666F6F626172", 12) == 0);
+    assert(base16_encode_lower((const uint8_t *)"\xDE\xAD", 2, encoded, 4)
+        == 4);
+    assert(memcmp(encoded, "dead", 4) == 0);
+    assert(base16_decode("DeAdBeEf", 8, output, 4) == 4);
+    assert(memcmp(output, "\xDE\xAD\xBE\xEF", 4) == 0);
+
+    // Invalid digits and lengths, and buffers too small.
+    assert(base16_decode("DEAG", 4, output, 8) == BASE16_ERROR);
+    assert(base16_decode("DEA", 3, output, 8) == BASE16_ERROR);
+    assert(base16_decode("DEAD", 4, output, 1) == BASE16_ERROR);
+    assert(base16_encode(output, 2, encoded, 3) == BASE16_ERROR);
+
+    // Every kernel against the scalar one, with every buffer ending where its
+    // allocation does.
+    enum { LENGTH = 300 };
+    enum base64_kernel original = base64_get_kernel();
+    uint8_t *input              = malloc(LENGTH);
+    uint8_t *decoded            = malloc(LENGTH);
+    char *expected              = malloc(2 * LENGTH);
+    char *text                  = malloc(2 * LENGTH);
+
+    srand(16);
+    for (size_t length = 0; length <= LENGTH; length++) {
+        uint8_t *in  = input + LENGTH - length;
+        uint8_t *out = decoded + LENGTH - length;
+        char *hex    = text + 2 * (LENGTH - length);
+        for (size_t i = 0; i < length; i++)
+            in[i] = (uint8_t)rand();
+
+        base64_set_kernel(BASE64_SCALAR);
+        base16_encode_lower(in, length, expected, 2 * length);
+
+        for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+            if (!base64_set_kernel(kernel))
+                continue;
+
+            assert(base16_encode_lower(in, length, hex, 2 * length)
+                == 2 * length);
+            assert(memcmp(hex, expected, 2 * length) == 0);
+            assert(base16_decode(hex, 2 * length, out, length) == length);
+            assert(memcmp(out, in, length) == 0);
+
+            assert(base16_encode(in, length, hex, 2 * length) == 2 * length);
+            assert(base16_decode(hex, 2 * length, out, length) == length);
+            assert(memcmp(out, in, length) == 0);
+
+            // The characters on both sides of the digits and the letters.
+            if (length > 0) {
+                size_t at = rand() % (2 * length);
+                char c    = hex[at];
+                hex[at]   = "/:@G`g"[rand() % 6];
+                assert(base16_decode(hex, 2 * length, out, length)
+                    == BASE16_ERROR);
+                hex[at] = c;
+            }
+        }
+
+        // Streaming, one odd chunk at a time.
+        struct base16_decoder decoder;
+        size_t written = 0;
+        base16_decoder_init(&decoder);
+        for (size_t done = 0, chunk; done < 2 * length; done += chunk) {
+            chunk = 1 + 2 * (rand() % 10);
+            if (chunk > 2 * length - done)
+                chunk = 2 * length - done;
+            size_t result = base16_decoder_update(
+                &decoder, hex + done, chunk, out + written, length - written);
+            assert(result != BASE16_ERROR);
+            written += result;
+        }
+        assert(base16_decoder_final(&decoder) == 0);
+        assert(written == length);
+        assert(memcmp(out, in, length) == 0);
+    }
+
+    free(input);
+    free(decoded);
+    free(expected);
+    free(text);
+    base64_set_kernel(original);
+    printf("Base16 tests passed!\n");
+}
+
+void test_in_place(void)
+{
+    enum { LENGTH = 1000 };
+    enum base64_kernel original = base64_get_kernel();
+    size_t capacity             = base64_encoded_length(LENGTH);
+    uint8_t *input              = malloc(LENGTH);
+    char *encoded               = malloc(capacity);
+    char *buffer                = malloc(capacity + capacity / 10);
+
+    srand(70);
+    for (size_t length = 0; length <= LENGTH; length += 1 + length / 32) {
+        size_t encoded_length = base64_encoded_length(length);
+        for (size_t i = 0; i < length; i++)
+            input[i] = (uint8_t)rand();
+        base64_encode(input, length, encoded, encoded_length);
+
+        for (int kernel = BASE64_SCALAR; kernel < BASE64_KERNELS; kernel++) {
+            if (!base64_set_kernel(kernel))
+                continue;
+
+            memcpy(buffer, encoded, encoded_length);
+            assert(base64_decode_in_place(buffer, encoded_length, 0, NULL)
+                == length);
+            assert(memcmp(buffer, input, length) == 0);
+
+            // With a line break every 10 characters.
+            size_t wrapped = 0;
+            for (size_t i = 0; i < encoded_length; i++) {
+                if (i % 10 == 9)
+                    buffer[wrapped++] = '\n';
+                buffer[wrapped++] = encoded[i];
+            }
+            assert(base64_decode_in_place(
+                       buffer, wrapped, BASE64_SKIP_WHITESPACE, NULL)
+                == length);
+            assert(memcmp(buffer, input, length) == 0);
+        }
+    }
+
+    size_t offset;
+    char invalid[] = "TWFu!GlzIGRp";
+    assert(base64_decode_in_place(invalid, 12, 0, &offset) == BASE64_ERROR);
+    assert(offset == 4);
+
+    free(input);
+    free(encoded);
+    free(buffer);
+    base64_set_kernel(original);
+    printf("In-place tests passed!\n");
+}
+
+void test_reader(void)
+{
+    enum { LENGTH = 5000 };
+    uint8_t *input   = malloc(LENGTH);
+    uint8_t *decoded = malloc(LENGTH);
+    char *encoded    = malloc(base64_encoded_length(LENGTH));
+
+    srand(71);
+    for (size_t length = 0; length <= LENGTH; length += 1 + length / 4) {
+        size_t encoded_length = base64_encoded_length(length);
+        for (size_t i = 0; i < length; i++)
+            input[i] = (uint8_t)rand();
+        base64_encode(input, length, encoded, encoded_length);
+
+        struct base64_reader reader;
+        const uint8_t *block;
+        size_t size, read = 0;
+        base64_reader_init(&reader, encoded, encoded_length);
+        while ((size = base64_reader_next(&reader, &block)) > 0) {
+            assert(size != BASE64_ERROR && size <= BASE64_READER_BLOCK);
+            assert(block >= reader.block
+                && block + size <= reader.block + BASE64_READER_BLOCK);
+            memcpy(decoded + read, block, size);
+            read += size;
+        }
+        assert(read == length);
+        assert(memcmp(decoded, input, length) == 0);
+        assert(base64_reader_next(&reader, &block) == 0);
+
+        // Corrupt the last character, which every reader gets to.
+        if (encoded_length > 0) {
+            char last                   = encoded[encoded_length - 1];
+            encoded[encoded_length - 1] = '!';
+            base64_reader_init(&reader, encoded, encoded_length);
+            while ((size = base64_reader_next(&reader, &block)) > 0
+                && size != BASE64_ERROR)
+                ;
+            assert(size == BASE64_ERROR);
+            encoded[encoded_length - 1] = last;
+        }
+    }
+
+    free(input);
+    free(decoded);
+    free(encoded);
+    printf("Reader tests passed!\n");
+}
@@ -1,5 +1,8 @@
+#include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <functional>
+#include <sys/resource.h>
 
 #include "Heap.hh"
 #include "benchmark.hh"
@@ -248,7 +251,7 @@ void test_structures(void)
     vector<TestStructure> test_heapified_elements_num2;
 
     // Randomize the actual array.
-    randomize_array(array, SIZE, sizeof(TestStructure));
+    randomize_array(array, SIZE);
 
     // Create heaps and insert elements into them.
     Heap<TestStructure, ComparatorNum1>            heap_num1;
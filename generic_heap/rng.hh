@@ -0,0 +1,114 @@
+/**
+ * Fast seedable pseudo-random number generator, xoshiro256** by Blackman and
+ * Vigna, in place of rand(): it's lock-free, yields 64 bits per call, and
+ * every generator is an explicit state that can be seeded for reproducible
+ * sequences, or split into independent streams with rng_jump().
+ *
+ * The generators aren't suitable for cryptography.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifndef RNG_HH
+#define RNG_HH
+
+struct rng {
+    uint64_t s[4];
+};
+
+// Seeds the generator from a single 64-bit value, expanded with splitmix64 as
+// its authors recommend, so that every seed gives a good state.
+inline void rng_seed(struct rng *rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        rng->s[i]  = z ^ (z >> 31);
+    }
+}
+
+// Returns 64 uniformly distributed bits.
+inline uint64_t rng_next(struct rng *rng)
+{
+    auto rotl = [](uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+    uint64_t *s    = rng->s;
+    uint64_t value = rotl(s[1] * 5, 7) * 9;
+    uint64_t t     = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return value;
+}
+
+// Returns an integer uniformly distributed in [0, bound), for a bound above
+// 0, without the bias of reducing modulo `bound`. Lemire's method takes the
+// high half of a 128-bit product and only divides in the rare case where it
+// has to reject a draw.
+inline uint64_t rng_bounded(struct rng *rng, uint64_t bound)
+{
+    unsigned __int128 product = (unsigned __int128)rng_next(rng) * bound;
+
+    if ((uint64_t)product < bound) {
+        uint64_t threshold = -bound % bound;
+        while ((uint64_t)product < threshold)
+            product = (unsigned __int128)rng_next(rng) * bound;
+    }
+    return (uint64_t)(product >> 64);
+}
+
+// Returns a double uniformly distributed in [0, 1).
+inline double rng_double(struct rng *rng)
+{
+    return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+// Advances the generator by 2^128 draws, as many as 2^128 calls to
+// rng_next(). Jumping copies of a generator 1, 2, 3... times gives streams
+// that never overlap, to hand out to threads.
+inline void rng_jump(struct rng *rng)
+{
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+        0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+    uint64_t s[4] = { 0 };
+
+    for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (uint64_t)1 << b)
+                for (int j = 0; j < 4; j++)
+                    s[j] ^= rng->s[j];
+            rng_next(rng);
+        }
+
+    for (int j = 0; j < 4; j++)
+        rng->s[j] = s[j];
+}
+
+// Returns the generator of the calling thread. Every thread's is seeded
+// differently on first use, from the clock and a counter; seed it with
+// rng_seed() for reproducible sequences.
+inline struct rng *rng_thread(void)
+{
+    static std::atomic<uint64_t> threads;
+    static thread_local struct rng rng;
+    static thread_local bool seeded;
+
+    if (!seeded) {
+        // The counter tells apart threads starting within a clock tick.
+        rng_seed(&rng,
+            (uint64_t)std::chrono::high_resolution_clock::now()
+                    .time_since_epoch()
+                    .count()
+                ^ threads++ << 48);
+        seeded = true;
+    }
+    return &rng;
+}
+
+#endif
@@ -8,6 +8,8 @@
 #ifndef TESTS_HH
 #define TESTS_HH
 
+#include <cassert>
+
 #include "Heap.hh"
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -2,20 +2,23 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include "randomize_array/rng.h"
+
 int main(int argc, char **argv)
 {
-    if (argc != 3) {
+    if (argc != 3 || atoi(argv[2]) <= 0) {
         printf("Usage: %s num mod\n", argv[0]);
         return 1;
     }
 
-    srand(time(NULL));
+    struct rng rng;
+    rng_seed(&rng, time(NULL));
 
     int num = atoi(argv[1]);
     int mod = atoi(argv[2]);
 
     for (int i = 0; i < num; i++)
-        printf("%i\n", rand() % mod);
+        printf("%i\n", (int)rng_bounded(&rng, mod));
 
     return 0;
 }
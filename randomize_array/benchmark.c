@@ -0,0 +1,196 @@
+/**
+ * Measures how the shuffles scale, in nanoseconds per element, from arrays
+ * that fit in cache up to MAX_ELEMENTS elements (2^26 by default) of 4 and 8
+ * bytes: Fisher-Yates and the bucket shuffle on the calling thread, and the
+ * parallel shuffle on 1, 2, 4... threads up to one per online CPU:
+ *
+ *     ./benchmark [MAX_ELEMENTS]
+ *
+ * Every shuffle is checked to leave a permutation of the array behind. Then
+ * it measures the throughput of the samplers on an array, or stream, of
+ * MAX_ELEMENTS 4-byte elements.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "randomize_array.h"
+#include "sample.h"
+
+// Minimum time spent measuring each size, in seconds.
+#define DURATION 0.25
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void check(bool ok, const char *what, size_t nel, size_t width)
+{
+    if (!ok) {
+        fprintf(stderr, "%s failed on %zu elements of %zu bytes\n", what, nel,
+            width);
+        exit(1);
+    }
+}
+
+// Sum of the elements, which a shuffle leaves alone.
+static uint64_t sum(const void *array, size_t nel, size_t width)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < nel; i++) {
+        uint64_t value = 0;
+        memcpy(&value, (const char *)array + i * width, width);
+        total += value;
+    }
+    return total;
+}
+
+// Shuffles `array` with randomize_array(), randomize_array_buckets(), or
+// randomize_array_parallel() on `threads` threads if not 0, for at least
+// DURATION seconds and returns the time per call.
+static double measure(
+    bool buckets, void *array, size_t nel, size_t width, unsigned threads)
+{
+    uint64_t expected = sum(array, nel, width);
+    double start = now(), elapsed;
+    size_t calls = 0;
+
+    do {
+        if (threads)
+            randomize_array_parallel(array, nel, width, threads);
+        else if (buckets)
+            randomize_array_buckets(array, nel, width);
+        else
+            randomize_array(array, nel, width);
+        calls++;
+    } while ((elapsed = now() - start) < DURATION);
+
+    check(sum(array, nel, width) == expected,
+        threads       ? "parallel shuffle"
+            : buckets ? "bucket shuffle"
+                      : "serial shuffle",
+        nel, width);
+    return elapsed / calls;
+}
+
+// Repeats `statement` for at least DURATION seconds, and prints the time it
+// took per unit of the `units` each repetition handles.
+#define MEASURE(name, units, unit, statement)                                 \
+    do {                                                                      \
+        double start = now(), elapsed;                                        \
+        size_t calls = 0;                                                     \
+        do {                                                                  \
+            statement;                                                        \
+            calls++;                                                          \
+        } while ((elapsed = now() - start) < DURATION);                       \
+        printf("%-30s %12.2f ns/%s %12.2f M%ss/s\n", name,                    \
+            elapsed * 1e9 / calls / (units), unit,                            \
+            calls * (double)(units) / elapsed * 1e-6, unit);                  \
+    } while (0)
+
+static void benchmark_sampling(int *array, size_t nel)
+{
+    const size_t K = 1000;
+    struct rng rng;
+    int sample[1000];
+    size_t indices[1000];
+
+    rng_seed(&rng, 1);
+    for (size_t i = 0; i < nel; i++)
+        array[i] = i;
+    printf("\nsampling %zu of %zu elements\n", K, nel);
+
+    MEASURE("partial Fisher-Yates", K, "sample",
+        sample_array(&rng, array, nel, sizeof(int), K));
+    MEASURE("Floyd indices", K, "sample",
+        sample_indices(&rng, nel, K, indices));
+    MEASURE("Floyd indices of 2^60", K, "sample",
+        sample_indices(&rng, (size_t)1 << 60, K, indices));
+
+    struct reservoir reservoir;
+    MEASURE("reservoir, one at a time", nel, "element", {
+        reservoir_init(&reservoir, &rng, sample, K, sizeof(int));
+        for (size_t i = 0; i < nel; i++)
+            reservoir_add(&reservoir, &array[i]);
+    });
+    MEASURE("reservoir, all at once", nel, "element", {
+        reservoir_init(&reservoir, &rng, sample, K, sizeof(int));
+        reservoir_add_array(&reservoir, array, nel);
+    });
+
+    // Weights of every element, as large as its index modulo 7.
+    double *weights = malloc(nel * sizeof(double));
+    struct alias_table table;
+    for (size_t i = 0; i < nel; i++)
+        weights[i] = i % 7;
+    MEASURE("alias table, building", nel, "weight", {
+        if (!alias_table_init(&table, weights, nel)) {
+            fprintf(stderr, "out of memory for %zu weights\n", nel);
+            exit(1);
+        }
+        alias_table_free(&table);
+    });
+    alias_table_init(&table, weights, nel);
+    size_t total = 0;
+    MEASURE("alias table, sampling", K, "sample", {
+        for (size_t i = 0; i < K; i++)
+            total += alias_table_sample(&table, &rng);
+    });
+    check(total > 0, "alias table sampling", nel, sizeof(double));
+    alias_table_free(&table);
+    free(weights);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_elements  = argc > 1 ? strtoull(argv[1], NULL, 0) : 1 << 26;
+    long cpus            = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned max_threads = cpus > 1 ? (unsigned)cpus : 1;
+
+    char *array = malloc(max_elements * 8);
+    if (!array) {
+        fprintf(stderr, "out of memory for %zu elements\n", max_elements);
+        return 1;
+    }
+
+    printf("%-10s %5s %10s %12s %8s\n", "elements", "width", "shuffle",
+        "ns/element", "speedup");
+    for (size_t width = 4; width <= 8; width *= 2)
+        for (size_t nel = 1 << 10; nel <= max_elements; nel *= 4) {
+            for (size_t i = 0; i < nel; i++) {
+                uint64_t value = i;
+                memcpy(array + i * width, &value, width);
+            }
+
+            double serial = measure(false, array, nel, width, 0);
+            printf("%-10zu %5zu %10s %12.2f %8s\n", nel, width, "serial",
+                serial * 1e9 / nel, "1.00");
+            double seconds = measure(true, array, nel, width, 0);
+            printf("%-10zu %5zu %10s %12.2f %8.2f\n", nel, width, "buckets",
+                seconds * 1e9 / nel, serial / seconds);
+            for (unsigned threads = 1;; threads *= 2) {
+                if (threads > max_threads)
+                    threads = max_threads;
+                seconds = measure(false, array, nel, width, threads);
+                printf("%-10zu %5zu %7u th %12.2f %8.2f\n", nel, width,
+                    threads, seconds * 1e9 / nel, serial / seconds);
+                if (threads == max_threads)
+                    break;
+            }
+        }
+
+    benchmark_sampling((int *)array, max_elements);
+
+    free(array);
+    return 0;
+}
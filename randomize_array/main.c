@@ -1,10 +1,13 @@
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "randomize_array.h"
+#include "rng.h"
+#include "sample.h"
 
 void test(void);
 
@@ -126,6 +129,343 @@ void test_structures(void)
     free(array);
 }
 
+void test_widths(void)
+{
+    // Setup. Every element holds its index in each of its bytes, so that a
+    // permutation can be told from a torn swap.
+    const size_t SIZE     = 64;
+    const size_t WIDTHS[] = { 3, 16, 24, 300, 1000 };
+    const size_t NWIDTHS  = sizeof(WIDTHS) / sizeof(WIDTHS[0]);
+    unsigned char *array  = (unsigned char *)malloc(SIZE * 1000);
+    bool seen[64];
+
+    for (size_t w = 0; w < NWIDTHS; w++) {
+        size_t width = WIDTHS[w];
+        for (size_t i = 0; i < SIZE; i++)
+            memset(array + i * width, (int)i, width);
+
+        // Randomize the array.
+        randomize_array(array, SIZE, width);
+
+        // Test.
+        bool array_is_randomized = false;
+        memset(seen, 0, sizeof(seen));
+        for (size_t i = 0; i < SIZE; i++) {
+            unsigned char value = array[i * width];
+            for (size_t j = 1; j < width; j++)
+                assert(array[i * width + j] == value);
+            assert(value < SIZE && !seen[value]);
+            seen[value] = true;
+            if (value != i)
+                array_is_randomized = true;
+        }
+        assert(array_is_randomized);
+    }
+
+    // Arrays too short to shuffle are left alone.
+    array[0] = 42;
+    randomize_array(array, 1, sizeof(char));
+    randomize_array(array, 0, sizeof(char));
+    assert(array[0] == 42);
+
+    // Cleanup.
+    free(array);
+}
+
+void test_rng(void)
+{
+    // The reference outputs of xoshiro256** from the state { 1, 2, 3, 4 }.
+    struct rng rng = { { 1, 2, 3, 4 } };
+    assert(rng_next(&rng) == 11520);
+    assert(rng_next(&rng) == 0);
+    assert(rng_next(&rng) == 1509978240);
+    assert(rng_next(&rng) == 1215971899390074240);
+
+    // Equal seeds give equal sequences, jumped ones differ.
+    struct rng a, b;
+    rng_seed(&a, 42);
+    rng_seed(&b, 42);
+    for (int i = 0; i < 100; i++)
+        assert(rng_next(&a) == rng_next(&b));
+    rng_jump(&b);
+    assert(rng_next(&a) != rng_next(&b));
+
+    // Bounded integers fall in range, in roughly equal counts: every count
+    // of 10000 expected is within 5 standard deviations.
+    const int BOUND = 10;
+    int counts[10]  = { 0 };
+    for (int i = 0; i < BOUND * 10000; i++) {
+        uint64_t value = rng_bounded(&a, BOUND);
+        assert(value < BOUND);
+        counts[value]++;
+    }
+    for (int i = 0; i < BOUND; i++)
+        assert(counts[i] > 10000 - 500 && counts[i] < 10000 + 500);
+    for (int i = 0; i < 1000; i++) {
+        assert(rng_bounded(&a, 1) == 0);
+        assert(rng_bounded(&a, UINT64_MAX) < UINT64_MAX);
+        double value = rng_double(&a);
+        assert(value >= 0 && value < 1);
+    }
+
+    // Shuffles are reproducible from the seed of the generator.
+    int x[100], y[100];
+    for (int i = 0; i < 100; i++)
+        x[i] = y[i] = i;
+    rng_seed(&a, 7);
+    rng_seed(&b, 7);
+    randomize_array_with(&a, x, 100, sizeof(int));
+    randomize_array_with(&b, y, 100, sizeof(int));
+    assert(memcmp(x, y, sizeof(x)) == 0);
+
+    // Every thread has a generator of its own, seeded on first use.
+    assert(rng_thread() == rng_thread());
+    assert(rng_next(rng_thread()) != rng_next(rng_thread()));
+}
+
+void test_parallel(void)
+{
+    // Setup. Large enough for 4 threads of a megabyte.
+    const size_t SIZE = 1 << 21;
+    int *array        = (int *)malloc(SIZE * sizeof(int));
+    int *copy         = (int *)malloc(SIZE * sizeof(int));
+    bool *seen        = (bool *)malloc(SIZE * sizeof(bool));
+
+    // An odd number of threads leaves a block out of the first merges.
+    for (unsigned threads = 3; threads <= 4; threads++) {
+        for (size_t i = 0; i < SIZE; i++)
+            array[i] = i;
+
+        // Randomize the array.
+        struct rng rng;
+        rng_seed(&rng, threads);
+        randomize_array_parallel_with(&rng, array, SIZE, sizeof(int), threads);
+
+        // Test. The result is a permutation, and elements are as likely to
+        // end up in every quarter of the array from every quarter of it: each
+        // count of SIZE / 16 expected is within 5 standard deviations, about
+        // its square root.
+        size_t counts[4][4] = { { 0 } };
+        memset(seen, 0, SIZE * sizeof(bool));
+        for (size_t i = 0; i < SIZE; i++) {
+            assert(array[i] >= 0 && array[i] < SIZE && !seen[array[i]]);
+            seen[array[i]] = true;
+            counts[array[i] / (SIZE / 4)][i / (SIZE / 4)]++;
+        }
+        for (int from = 0; from < 4; from++)
+            for (int to = 0; to < 4; to++)
+                assert(counts[from][to] > SIZE / 16 - 5 * 362
+                    && counts[from][to] < SIZE / 16 + 5 * 362);
+
+        // Shuffles are reproducible from the seed and number of threads.
+        for (size_t i = 0; i < SIZE; i++)
+            copy[i] = i;
+        rng_seed(&rng, threads);
+        randomize_array_parallel_with(&rng, copy, SIZE, sizeof(int), threads);
+        assert(memcmp(array, copy, SIZE * sizeof(int)) == 0);
+    }
+
+    // Elements of any width are swapped whole.
+    unsigned char *bytes = (unsigned char *)array;
+    long sum             = 0;
+    for (size_t i = 0; i < SIZE / 8; i++)
+        memset(bytes + i * 24, (int)(i % 251), 24);
+    randomize_array_parallel(bytes, SIZE / 8, 24, 4);
+    for (size_t i = 0; i < SIZE / 8; i++) {
+        for (size_t j = 1; j < 24; j++)
+            assert(bytes[i * 24 + j] == bytes[i * 24]);
+        sum += bytes[i * 24] - (int)(i % 251);
+    }
+    assert(sum == 0);
+
+    // Arrays too small to split are shuffled all the same.
+    randomize_array_parallel(array, 10, sizeof(int), 0);
+    randomize_array_parallel(array, 0, sizeof(int), 4);
+
+    // Cleanup.
+    free(array);
+    free(copy);
+    free(seen);
+}
+
+void test_buckets(void)
+{
+    // Setup. Large enough for a few buckets.
+    const size_t SIZE = 1 << 22;
+    int *array        = (int *)malloc(SIZE * sizeof(int));
+    int *copy         = (int *)malloc(SIZE * sizeof(int));
+    bool *seen        = (bool *)malloc(SIZE * sizeof(bool));
+    for (size_t i = 0; i < SIZE; i++)
+        array[i] = copy[i] = i;
+
+    // Randomize the array.
+    struct rng rng;
+    rng_seed(&rng, 1);
+    randomize_array_buckets_with(&rng, array, SIZE, sizeof(int));
+
+    // Test. The result is a permutation, and elements are as likely to end up
+    // in every quarter of the array from every quarter of it, as in
+    // test_parallel().
+    size_t counts[4][4] = { { 0 } };
+    memset(seen, 0, SIZE * sizeof(bool));
+    for (size_t i = 0; i < SIZE; i++) {
+        assert(array[i] >= 0 && array[i] < SIZE && !seen[array[i]]);
+        seen[array[i]] = true;
+        counts[array[i] / (SIZE / 4)][i / (SIZE / 4)]++;
+    }
+    for (int from = 0; from < 4; from++)
+        for (int to = 0; to < 4; to++)
+            assert(counts[from][to] > SIZE / 16 - 5 * 512
+                && counts[from][to] < SIZE / 16 + 5 * 512);
+
+    // Shuffles are reproducible from the seed.
+    rng_seed(&rng, 1);
+    randomize_array_buckets_with(&rng, copy, SIZE, sizeof(int));
+    assert(memcmp(array, copy, SIZE * sizeof(int)) == 0);
+
+    // Elements of any width are copied whole: each holds its index, then
+    // copies of its last byte.
+    const size_t NEL = 1 << 13, WIDTH = 1000;
+    unsigned char *bytes = (unsigned char *)malloc(NEL * WIDTH);
+    for (size_t i = 0; i < NEL; i++) {
+        memcpy(bytes + i * WIDTH, &i, sizeof(i));
+        memset(bytes + i * WIDTH + sizeof(i), (int)(i % 251),
+            WIDTH - sizeof(i));
+    }
+    randomize_array_buckets(bytes, NEL, WIDTH);
+    memset(seen, 0, NEL * sizeof(bool));
+    bool array_is_randomized = false;
+    for (size_t i = 0; i < NEL; i++) {
+        size_t index;
+        memcpy(&index, bytes + i * WIDTH, sizeof(index));
+        assert(index < NEL && !seen[index]);
+        seen[index] = true;
+        for (size_t j = sizeof(index); j < WIDTH; j++)
+            assert(bytes[i * WIDTH + j] == index % 251);
+        if (index != i)
+            array_is_randomized = true;
+    }
+    assert(array_is_randomized);
+
+    // Cleanup.
+    free(array);
+    free(copy);
+    free(seen);
+    free(bytes);
+}
+
+// Whether every one of `n` counts is within 5 standard deviations of
+// `expected`, for `trials` draws of probability expected / trials each.
+bool counts_are_even(const size_t *counts, size_t n, double expected,
+    size_t trials)
+{
+    double deviation = sqrt(expected * (1 - expected / trials));
+    for (size_t i = 0; i < n; i++)
+        if (fabs(counts[i] - expected) > 5 * deviation)
+            return false;
+    return true;
+}
+
+void test_sampling(void)
+{
+    // Setup.
+    const size_t N = 100, K = 10, TRIALS = 20000;
+    int array[100], sample[10];
+    size_t indices[100], counts[100];
+    bool seen[100];
+    struct rng rng;
+    rng_seed(&rng, 3);
+
+    // Partial Fisher-Yates: the first K elements are distinct, and every
+    // element is as likely to be among them.
+    for (size_t i = 0; i < N; i++)
+        array[i] = i;
+    memset(counts, 0, sizeof(counts));
+    for (size_t t = 0; t < TRIALS; t++) {
+        sample_array(&rng, array, N, sizeof(int), K);
+        memset(seen, 0, sizeof(seen));
+        for (size_t i = 0; i < K; i++) {
+            assert(!seen[array[i]]);
+            seen[array[i]] = true;
+            counts[array[i]]++;
+        }
+    }
+    assert(counts_are_even(counts, N, (double)TRIALS * K / N, TRIALS));
+
+    // Floyd: distinct indices in range, each as likely, and all of them when
+    // asked for as many.
+    memset(counts, 0, sizeof(counts));
+    for (size_t t = 0; t < TRIALS; t++) {
+        assert(sample_indices(&rng, N, K, indices));
+        memset(seen, 0, sizeof(seen));
+        for (size_t i = 0; i < K; i++) {
+            assert(indices[i] < N && !seen[indices[i]]);
+            seen[indices[i]] = true;
+            counts[indices[i]]++;
+        }
+    }
+    assert(counts_are_even(counts, N, (double)TRIALS * K / N, TRIALS));
+    assert(sample_indices(&rng, N, N, indices));
+    memset(seen, 0, sizeof(seen));
+    for (size_t i = 0; i < N; i++) {
+        assert(indices[i] < N && !seen[indices[i]]);
+        seen[indices[i]] = true;
+    }
+    assert(sample_indices(&rng, 0, 0, indices));
+    assert(sample_indices(&rng, SIZE_MAX, 3, indices));
+
+    // Reservoir: distinct elements of the stream, each as likely, whether
+    // offered one at a time or all at once.
+    memset(counts, 0, sizeof(counts));
+    for (size_t t = 0; t < TRIALS; t++) {
+        struct reservoir reservoir;
+        reservoir_init(&reservoir, &rng, sample, K, sizeof(int));
+        for (size_t i = 0; i < N; i++) {
+            assert(reservoir_size(&reservoir) == (i < K ? i : K));
+            reservoir_add(&reservoir, &array[i]);
+        }
+        assert(reservoir_size(&reservoir) == K);
+        memset(seen, 0, sizeof(seen));
+        for (size_t i = 0; i < K; i++) {
+            assert(sample[i] >= 0 && sample[i] < N && !seen[sample[i]]);
+            seen[sample[i]] = true;
+            counts[sample[i]]++;
+        }
+    }
+    assert(counts_are_even(counts, N, (double)TRIALS * K / N, TRIALS));
+
+    int other[10];
+    struct rng copy = rng;
+    struct reservoir one, all;
+    reservoir_init(&one, &rng, sample, K, sizeof(int));
+    reservoir_init(&all, &copy, other, K, sizeof(int));
+    for (size_t i = 0; i < N; i++)
+        reservoir_add(&one, &array[i]);
+    reservoir_add_array(&all, array, 3);
+    reservoir_add_array(&all, array + 3, N - 3);
+    assert(memcmp(sample, other, sizeof(sample)) == 0);
+
+    // Alias table: every index as likely as its weight, and never one of
+    // weight 0.
+    const double weights[] = { 1, 2, 3, 4, 0, 10 };
+    struct alias_table table;
+    assert(alias_table_init(&table, weights, 6));
+    memset(counts, 0, sizeof(counts));
+    for (size_t t = 0; t < TRIALS; t++)
+        counts[alias_table_sample(&table, &rng)]++;
+    assert(counts[4] == 0);
+    for (size_t i = 0; i < 6; i++)
+        if (weights[i])
+            assert(counts_are_even(
+                &counts[i], 1, TRIALS * weights[i] / 20, TRIALS));
+    alias_table_free(&table);
+
+    const double invalid[] = { 1, -1 }, zero[] = { 0, 0 };
+    assert(!alias_table_init(&table, invalid, 2));
+    assert(!alias_table_init(&table, zero, 2));
+    assert(!alias_table_init(&table, weights, 0));
+}
+
 void test(void)
 {
     test_integers();
@@ -140,5 +480,20 @@ void test(void)
     test_structures();
     printf("Structure array tests passed!\n");
 
+    test_widths();
+    printf("Element width tests passed!\n");
+
+    test_rng();
+    printf("Random number generator tests passed!\n");
+
+    test_parallel();
+    printf("Parallel shuffle tests passed!\n");
+
+    test_buckets();
+    printf("Bucket shuffle tests passed!\n");
+
+    test_sampling();
+    printf("Sampling tests passed!\n");
+
     printf("\nAll tests passed!\n");
 }
@@ -1,28 +1,52 @@
-#include <stdlib.h>
 #include <string.h>
 
 #include "randomize_array.h"
+#include "swap.h"
 
-#define SWAP(a, b, width)                                                     \
-    do {                                                                      \
-        char *__a  = a;                                                       \
-        char *__b  = b;                                                       \
-        char *temp = (char *)malloc(width);                                   \
-        memcpy(temp, __a, width);                                             \
-        memcpy(__a, __b, width);                                              \
-        memcpy(__b, temp, width);                                             \
-        free(temp);                                                           \
-    } while (0);
+// Defines a Fisher-Yates shuffle of elements `width` bytes wide, a constant
+// which lets the compiler swap them with plain loads and stores.
+#define SHUFFLE_(width)                                                       \
+    static void shuffle_##width(struct rng *rng, char *arr, size_t nel)       \
+    {                                                                         \
+        char a[width], b[width];                                              \
+                                                                              \
+        for (; nel > 1; nel--) {                                              \
+            char *x = arr + rng_bounded(rng, nel) * width;                    \
+            char *y = arr + (nel - 1) * width;                                \
+            memcpy(a, x, width);                                              \
+            memcpy(b, y, width);                                              \
+            memcpy(x, b, width);                                              \
+            memcpy(y, a, width);                                              \
+        }                                                                     \
+    }
+
+SHUFFLE_(1)
+SHUFFLE_(2)
+SHUFFLE_(4)
+SHUFFLE_(8)
+SHUFFLE_(16)
 
-/**
- * NOTE: rand() must be seeded in the program that uses this function.
- */
 void randomize_array(void *array, size_t nel, size_t width)
+{
+    randomize_array_with(rng_thread(), array, nel, width);
+}
+
+void randomize_array_with(
+    struct rng *rng, void *array, size_t nel, size_t width)
 {
     char *arr = (char *)array;
 
-    do {
-        int i = rand() % nel--;
-        SWAP(arr + i * width, arr + nel * width, width);
-    } while (nel);
+    switch (width) {
+    case 1: shuffle_1(rng, arr, nel); return;
+    case 2: shuffle_2(rng, arr, nel); return;
+    case 4: shuffle_4(rng, arr, nel); return;
+    case 8: shuffle_8(rng, arr, nel); return;
+    case 16: shuffle_16(rng, arr, nel); return;
+    }
+
+    for (; nel > 1; nel--) {
+        size_t i = rng_bounded(rng, nel);
+        if (i != nel - 1)
+            swap(arr + i * width, arr + (nel - 1) * width, width);
+    }
 }
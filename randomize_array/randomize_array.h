@@ -1,8 +1,33 @@
 #include <stdio.h>
 
+#include "rng.h"
+
 #ifndef RANDOMIZE_ARRAY_H
 #define RANDOMIZE_ARRAY_H
 
+// Shuffles `nel` elements of `width` bytes each in place, without allocating,
+// drawing from the generator of the calling thread.
 void randomize_array(void *array, size_t nel, size_t width);
 
+// The same, drawing from `rng`, for shuffles reproducible from its seed.
+void randomize_array_with(
+    struct rng *rng, void *array, size_t nel, size_t width);
+
+// The same shuffles on at most `threads` threads, or one per online CPU if 0,
+// for very large arrays. Arrays of less than about a megabyte per thread are
+// shuffled on fewer threads, or the calling one alone. Shuffles drawing from
+// `rng` are reproducible from its seed and the number of threads.
+void randomize_array_parallel(
+    void *array, size_t nel, size_t width, unsigned threads);
+void randomize_array_parallel_with(struct rng *rng, void *array, size_t nel,
+    size_t width, unsigned threads);
+
+// The same shuffles for arrays much larger than the caches, where Fisher-Yates
+// misses them on every swap: elements are first spread to buckets the size of
+// a cache in a sequential pass, each then shuffled in cache. They allocate a
+// scratch copy of the array, and fall back to randomize_array() if they can't.
+void randomize_array_buckets(void *array, size_t nel, size_t width);
+void randomize_array_buckets_with(
+    struct rng *rng, void *array, size_t nel, size_t width);
+
 #endif
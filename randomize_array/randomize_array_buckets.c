@@ -0,0 +1,106 @@
+/**
+ * Cache-aware shuffle for arrays much larger than the caches.
+ *
+ * Fisher-Yates swaps with a random element at every step, which misses the
+ * caches and the TLB every time once the array outgrows them. Instead, every
+ * element is given a random bucket, and the elements are copied to their
+ * buckets in a single pass of sequential reads and writes into a scratch
+ * buffer. Every bucket is then small enough for Fisher-Yates to run in
+ * cache, or split again the same way. Elements land in every bucket
+ * independently of each other, and in a random order within it, so the
+ * result is as uniform as a plain Fisher-Yates shuffle.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "randomize_array.h"
+
+// Largest buckets, in bytes, shuffled with Fisher-Yates: about the size of
+// the L2 cache of a core, where its random accesses hit.
+#define BUCKET_SIZE (2 << 20)
+
+// Most buckets a pass splits elements into, as a power of 2. Beyond it, the
+// pages being written to no longer fit in the TLB.
+#define MAX_BUCKET_BITS 8
+
+// Copies an element, with plain loads and stores for the common widths.
+static inline void copy(char *to, const char *from, size_t width)
+{
+    switch (width) {
+    case 4: memcpy(to, from, 4); return;
+    case 8: memcpy(to, from, 8); return;
+    case 16: memcpy(to, from, 16); return;
+    }
+    memcpy(to, from, width);
+}
+
+// Shuffles the `nel` elements of `array` with the help of `scratch`, which
+// holds as many.
+static void shuffle(struct rng *rng, char *array, char *scratch, size_t nel,
+    size_t width)
+{
+    size_t size = nel * width;
+    if (size <= BUCKET_SIZE) {
+        randomize_array_with(rng, array, nel, width);
+        return;
+    }
+
+    // Aim for buckets of half the size which still fits, so that the ones
+    // that turn out a little larger than average don't need another pass.
+    int bits = 1;
+    while (bits < MAX_BUCKET_BITS && size >> bits > BUCKET_SIZE / 2)
+        bits++;
+    size_t buckets = (size_t)1 << bits;
+
+    // Draw the bucket of every element twice from the same state, first to
+    // count the elements of every bucket, then to put them there, rather than
+    // storing them. Every draw gives the buckets of as many elements as it
+    // has bits for.
+    size_t starts[(1 << MAX_BUCKET_BITS) + 1] = { 0 };
+    size_t ends[1 << MAX_BUCKET_BITS];
+    struct rng replay = *rng;
+    int per_draw      = 64 / bits;
+    for (size_t i = 0; i < nel;) {
+        uint64_t draw = rng_next(&replay);
+        for (int k = 0; k < per_draw && i < nel; k++, i++, draw <<= bits)
+            starts[(draw >> (64 - bits)) + 1]++;
+    }
+    for (size_t b = 0; b < buckets; b++) {
+        starts[b + 1] += starts[b];
+        ends[b] = starts[b];
+    }
+    for (size_t i = 0; i < nel;) {
+        uint64_t draw = rng_next(rng);
+        for (int k = 0; k < per_draw && i < nel; k++, i++, draw <<= bits) {
+            size_t b = draw >> (64 - bits);
+            copy(scratch + ends[b]++ * width, array + i * width, width);
+        }
+    }
+
+    // Shuffle every bucket, while its part of the array serves as scratch,
+    // and copy it back from the cache.
+    for (size_t b = 0; b < buckets; b++) {
+        size_t start = starts[b] * width, count = starts[b + 1] - starts[b];
+        shuffle(rng, scratch + start, array + start, count, width);
+        memcpy(array + start, scratch + start, count * width);
+    }
+}
+
+void randomize_array_buckets_with(
+    struct rng *rng, void *array, size_t nel, size_t width)
+{
+    char *scratch;
+    if (nel * width <= BUCKET_SIZE || !(scratch = malloc(nel * width))) {
+        randomize_array_with(rng, array, nel, width);
+        return;
+    }
+
+    shuffle(rng, (char *)array, scratch, nel, width);
+    free(scratch);
+}
+
+void randomize_array_buckets(void *array, size_t nel, size_t width)
+{
+    randomize_array_buckets_with(rng_thread(), array, nel, width);
+}
@@ -0,0 +1,161 @@
+/**
+ * Multi-threaded shuffle for very large arrays, after MergeShuffle by Bacher,
+ * Bodini, Hollender and Lumbroso.
+ *
+ * The array is cut into one block per thread, each shuffled on its own by
+ * randomize_array_with(), then neighbouring blocks are merged pairwise, every
+ * pair on a thread of its own, until a single one is left. A merge flips a
+ * coin to pick the side every next element comes from, then inserts those
+ * left once a side runs out at random positions, which makes the merge of two
+ * uniformly shuffled blocks a uniform shuffle of both. Every block, and then
+ * every merge, draws from its own stream of the generator, split off with
+ * rng_jump().
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "randomize_array.h"
+#include "swap.h"
+
+// Most blocks an array is cut into, each shuffled on a thread of its own.
+#define MAX_THREADS 64
+
+// Least size of a block, in bytes. Smaller ones take less time to shuffle
+// than to start a thread for, and then to merge.
+#define MIN_CHUNK (1 << 20)
+
+struct job {
+    struct rng rng;
+    char *array;
+    size_t width;
+    size_t start, middle, end; /* Indices of the elements to shuffle */
+};
+
+static void *shuffle_job(void *arg)
+{
+    struct job *job = arg;
+    randomize_array_with(&job->rng, job->array + job->start * job->width,
+        job->end - job->start, job->width);
+    return NULL;
+}
+
+// Merges the shuffled blocks [start, middle) and [middle, end) into a single
+// shuffled one.
+static void *merge_job(void *arg)
+{
+    struct job *job = arg;
+    char *arr       = job->array;
+    size_t width    = job->width;
+    size_t i = job->start, j = job->middle, end = job->end;
+    uint64_t coins = 0;
+    int flips      = 0;
+
+    // The first block always lies between i and j. Every coin flip either
+    // keeps the element at i in place, or swaps in the next one of the second
+    // block and moves the first block along.
+    for (;; i++) {
+        if (flips == 0) {
+            coins = rng_next(&job->rng);
+            flips = 64;
+        }
+        bool second = coins & 1;
+        coins >>= 1;
+        flips--;
+
+        if (!second) {
+            if (i == j)
+                break;
+        } else {
+            if (j == end)
+                break;
+            swap(arr + i * width, arr + j * width, width);
+            j++;
+        }
+    }
+
+    // Insert what's left of either block at random positions, as Fisher-Yates
+    // would, to make up for the bias of the coin flips.
+    for (; i < end; i++) {
+        size_t k = job->start + rng_bounded(&job->rng, i - job->start + 1);
+        if (k != i)
+            swap(arr + i * width, arr + k * width, width);
+    }
+    return NULL;
+}
+
+// Shuffles or merges the `count` blocks of `jobs` side by side, the first on
+// the calling thread. Those whose thread fails to start are done there too,
+// one after the other, which only costs time: the result is the same.
+static void run(struct job *jobs, unsigned count, void *(*function)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    bool started[MAX_THREADS];
+
+    for (unsigned t = 1; t < count; t++)
+        started[t] = pthread_create(&threads[t], NULL, function, &jobs[t]) == 0;
+    function(&jobs[0]);
+    for (unsigned t = 1; t < count; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            function(&jobs[t]);
+    }
+}
+
+void randomize_array_parallel_with(struct rng *rng, void *array, size_t nel,
+    size_t width, unsigned threads)
+{
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads   = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if (width && threads > nel / (MIN_CHUNK / width + 1))
+        threads = nel / (MIN_CHUNK / width + 1);
+    if (threads <= 1) {
+        randomize_array_with(rng, array, nel, width);
+        return;
+    }
+
+    // Block t takes its share of the elements and stream t + 1 of the
+    // generator, which then moves past all of them.
+    struct job blocks[MAX_THREADS];
+    size_t chunk = nel / threads;
+    for (unsigned t = 0; t < threads; t++) {
+        size_t end = t == threads - 1 ? nel : chunk * (t + 1);
+        rng_jump(rng);
+        blocks[t] = (struct job) { *rng, (char *)array, width, chunk * t, 0,
+            end };
+    }
+    rng_jump(rng);
+    run(blocks, threads, shuffle_job);
+
+    // Merge runs of `span` blocks pairwise, each pair drawing from the stream
+    // of its first block, until a single run is left.
+    struct job merges[MAX_THREADS / 2];
+    for (unsigned span = 1; span < threads; span *= 2) {
+        unsigned count = 0;
+        for (unsigned t = 0; t + span < threads; t += 2 * span) {
+            unsigned last = t + 2 * span < threads ? t + 2 * span : threads;
+            merges[count++] = (struct job) { blocks[t].rng, (char *)array,
+                width, blocks[t].start, blocks[t + span].start,
+                blocks[last - 1].end };
+        }
+        run(merges, count, merge_job);
+
+        count = 0;
+        for (unsigned t = 0; t + span < threads; t += 2 * span)
+            blocks[t].rng = merges[count++].rng;
+    }
+}
+
+void randomize_array_parallel(
+    void *array, size_t nel, size_t width, unsigned threads)
+{
+    randomize_array_parallel_with(rng_thread(), array, nel, width, threads);
+}
@@ -0,0 +1,41 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "rng.h"
+
+void rng_jump(struct rng *rng)
+{
+    static const uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+        0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+    uint64_t s[4] = { 0 };
+
+    for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (uint64_t)1 << b)
+                for (int j = 0; j < 4; j++)
+                    s[j] ^= rng->s[j];
+            rng_next(rng);
+        }
+
+    for (int j = 0; j < 4; j++)
+        rng->s[j] = s[j];
+}
+
+struct rng *rng_thread(void)
+{
+    static atomic_uint_fast64_t threads;
+    static _Thread_local struct rng rng;
+    static _Thread_local bool seeded;
+
+    if (!seeded) {
+        struct timespec now;
+        timespec_get(&now, TIME_UTC);
+        // The counter tells apart threads starting within a clock tick.
+        rng_seed(&rng,
+            ((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec)
+                ^ atomic_fetch_add(&threads, 1) << 48);
+        seeded = true;
+    }
+    return &rng;
+}
@@ -0,0 +1,223 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sample.h"
+#include "swap.h"
+
+// Probability 1 of the thresholds of alias tables, which no 53-bit draw
+// reaches.
+#define CERTAIN ((uint64_t)1 << 53)
+
+// Returns a double uniformly distributed in (0, 1], whose logarithm is finite.
+static double uniform(struct rng *rng)
+{
+    return ((rng_next(rng) >> 11) + 1) * 0x1.0p-53;
+}
+
+void sample_array(
+    struct rng *rng, void *array, size_t nel, size_t width, size_t k)
+{
+    char *arr = (char *)array;
+
+    for (size_t i = 0; i < k; i++) {
+        size_t j = i + rng_bounded(rng, nel - i);
+        if (j != i)
+            swap(arr + i * width, arr + j * width, width);
+    }
+}
+
+// Returns the slot of `index` in an open addressing `set` of 2^`bits` slots,
+// which holds indices plus one so that 0 marks an empty slot, or the empty
+// slot where it belongs.
+static size_t *find(size_t *set, int bits, size_t index)
+{
+    size_t mask = ((size_t)1 << bits) - 1;
+    size_t slot = (uint64_t)index * 0x9e3779b97f4a7c15 >> (64 - bits);
+
+    while (set[slot] && set[slot] != index + 1)
+        slot = (slot + 1) & mask;
+    return &set[slot];
+}
+
+bool sample_indices(struct rng *rng, size_t n, size_t k, size_t *indices)
+{
+    if (k == 0)
+        return true;
+
+    // The set of indices drawn so far is kept at most half full.
+    int bits = 1;
+    while (((size_t)1 << bits) < 2 * k)
+        bits++;
+    size_t *set = calloc((size_t)1 << bits, sizeof(size_t));
+    if (!set)
+        return false;
+
+    // Draw from [0, j] for the last k values of j. An index drawn before is
+    // replaced with j itself, which can't have been, so that every subset is
+    // as likely.
+    for (size_t j = n - k, count = 0; j < n; j++) {
+        size_t index = rng_bounded(rng, j + 1);
+        size_t *slot = find(set, bits, index);
+        if (*slot)
+            slot = find(set, bits, index = j);
+        *slot            = index + 1;
+        indices[count++] = index;
+    }
+
+    free(set);
+    return true;
+}
+
+// Draws the number of elements to skip before the next one kept, and updates
+// the position of that one. It's SIZE_MAX once it's beyond any stream.
+static void reservoir_skip(struct reservoir *reservoir)
+{
+    double w    = reservoir->w;
+    double skip = floor(log(uniform(reservoir->rng)) / log(1 - w));
+
+    if (skip < (double)(SIZE_MAX - reservoir->next - 1))
+        reservoir->next += (size_t)skip + 1;
+    else
+        reservoir->next = SIZE_MAX;
+    reservoir->w *= exp(log(uniform(reservoir->rng)) / reservoir->k);
+}
+
+void reservoir_init(struct reservoir *reservoir, struct rng *rng,
+    void *sample, size_t k, size_t width)
+{
+    *reservoir = (struct reservoir) { rng, (char *)sample, k, width, 0,
+        SIZE_MAX, 0 };
+}
+
+void reservoir_add(struct reservoir *reservoir, const void *element)
+{
+    size_t k = reservoir->k, width = reservoir->width;
+
+    if (reservoir->seen < k) {
+        memcpy(reservoir->sample + reservoir->seen * width, element, width);
+        // Once the sample fills, start skipping: the next element kept
+        // comes after those skipped.
+        if (++reservoir->seen == k) {
+            reservoir->w    = exp(log(uniform(reservoir->rng)) / k);
+            reservoir->next = k - 1;
+            reservoir_skip(reservoir);
+        }
+        return;
+    }
+
+    if (reservoir->seen == reservoir->next) {
+        size_t i = rng_bounded(reservoir->rng, k);
+        memcpy(reservoir->sample + i * width, element, width);
+        reservoir_skip(reservoir);
+    }
+    reservoir->seen++;
+}
+
+void reservoir_add_array(
+    struct reservoir *reservoir, const void *array, size_t nel)
+{
+    const char *arr = (const char *)array;
+    size_t width    = reservoir->width;
+    size_t i        = 0;
+
+    while (i < nel && reservoir->seen < reservoir->k)
+        reservoir_add(reservoir, arr + i++ * width);
+
+    while (i < nel) {
+        size_t skip = reservoir->next - reservoir->seen;
+        if (skip >= nel - i) {
+            reservoir->seen += nel - i;
+            return;
+        }
+        i += skip;
+        reservoir->seen += skip;
+        reservoir_add(reservoir, arr + i++ * width);
+    }
+}
+
+size_t reservoir_size(const struct reservoir *reservoir)
+{
+    return reservoir->seen < reservoir->k ? reservoir->seen : reservoir->k;
+}
+
+bool alias_table_init(
+    struct alias_table *table, const double *weights, size_t n)
+{
+    double total = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!(weights[i] >= 0))
+            return false;
+        total += weights[i];
+    }
+    if (!(total > 0) || !isfinite(total))
+        return false;
+
+    table->n         = n;
+    table->threshold = malloc(n * sizeof(uint64_t));
+    table->alias     = malloc(n * sizeof(size_t));
+    double *scaled   = malloc(n * sizeof(double));
+    size_t *work     = malloc(n * sizeof(size_t));
+    if (!table->threshold || !table->alias || !scaled || !work) {
+        alias_table_free(table);
+        free(scaled);
+        free(work);
+        return false;
+    }
+
+    // Scale the weights to average 1, and stack up the indices below it at
+    // the front of the work list and the others at its back.
+    size_t small = 0, large = n;
+    for (size_t i = 0; i < n; i++) {
+        scaled[i] = weights[i] / total * n;
+        if (scaled[i] < 1)
+            work[small++] = i;
+        else
+            work[--large] = i;
+    }
+
+    // Every small index is topped up to 1 by a large one, its alias, which
+    // may then turn small itself.
+    while (small > 0 && large < n) {
+        size_t less = work[--small], more = work[large];
+        table->threshold[less] = (uint64_t)(scaled[less] * CERTAIN);
+        table->alias[less]     = more;
+        scaled[more] -= 1 - scaled[less];
+        if (scaled[more] < 1) {
+            large++;
+            work[small++] = more;
+        }
+    }
+
+    // Those left are 1, give or take rounding errors.
+    while (small > 0) {
+        size_t i            = work[--small];
+        table->threshold[i] = CERTAIN;
+        table->alias[i]     = i;
+    }
+    while (large < n) {
+        size_t i            = work[large++];
+        table->threshold[i] = CERTAIN;
+        table->alias[i]     = i;
+    }
+
+    free(scaled);
+    free(work);
+    return true;
+}
+
+void alias_table_free(struct alias_table *table)
+{
+    free(table->threshold);
+    free(table->alias);
+    table->threshold = NULL;
+    table->alias     = NULL;
+    table->n         = 0;
+}
+
+size_t alias_table_sample(const struct alias_table *table, struct rng *rng)
+{
+    size_t i = rng_bounded(rng, table->n);
+    return rng_next(rng) >> 11 < table->threshold[i] ? i : table->alias[i];
+}
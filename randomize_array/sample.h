@@ -0,0 +1,71 @@
+/**
+ * Random sampling, for when a few elements of an array or a stream are needed
+ * rather than a shuffle of all of them. Every function draws from the
+ * generator given, for samples reproducible from its seed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+// Moves a uniform sample of `k` of the `nel` elements of `array`, `width`
+// bytes each, to its front in random order: the first k steps of a
+// Fisher-Yates shuffle, in O(k) time. `k` must be at most `nel`.
+void sample_array(
+    struct rng *rng, void *array, size_t nel, size_t width, size_t k);
+
+// Writes `k` distinct indices drawn uniformly from [0, n) to `indices`, in
+// O(k) time and space whatever `n`, with Floyd's algorithm. They aren't in
+// random order; shuffle them if that matters. `k` must be at most `n`.
+// Returns false if memory runs out.
+bool sample_indices(struct rng *rng, size_t n, size_t k, size_t *indices);
+
+// Uniform sample of `k` elements of a stream of unknown length, with Li's
+// Algorithm L: after the first `k`, it draws how many elements to skip before
+// the next one it keeps, in O(k (1 + log(n / k))) draws for `n` elements.
+struct reservoir {
+    struct rng *rng;
+    char *sample;
+    size_t k, width;
+    size_t seen; /* Number of elements offered so far */
+    size_t next; /* Index of the next element to keep, once the sample fills */
+    double w;
+};
+
+// Starts sampling into `sample`, which holds `k` elements of `width` bytes.
+void reservoir_init(struct reservoir *reservoir, struct rng *rng,
+    void *sample, size_t k, size_t width);
+// Offers the next element of the stream.
+void reservoir_add(struct reservoir *reservoir, const void *element);
+// Offers the next `nel` elements of the stream at once, without as much as
+// looking at those skipped. The sample is the same as if they had been
+// offered one at a time.
+void reservoir_add_array(
+    struct reservoir *reservoir, const void *array, size_t nel);
+// Number of elements of the sample, which is less than `k` only until that
+// many have been offered.
+size_t reservoir_size(const struct reservoir *reservoir);
+
+// Weighted sampler with O(1) draws, from an alias table built in O(n) time
+// with Vose's method.
+struct alias_table {
+    size_t n;
+    uint64_t *threshold; /* Of 53-bit draws below which to keep the index */
+    size_t *alias;       /* Index drawn otherwise */
+};
+
+// Builds the table for indices [0, n) drawn with probabilities proportional
+// to `weights`. Returns false if memory runs out, or if a weight is negative,
+// or they don't sum up to a positive number.
+bool alias_table_init(
+    struct alias_table *table, const double *weights, size_t n);
+void alias_table_free(struct alias_table *table);
+// Returns an index drawn from the table.
+size_t alias_table_sample(const struct alias_table *table, struct rng *rng);
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * Swap of two elements of any width, shared by the shuffles and the samplers
+ * of this directory.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#ifndef SWAP_H
+#define SWAP_H
+
+// Elements wider than this are swapped through a stack buffer this size, a
+// chunk at a time, so that no swap ever allocates.
+#define SCRATCH_SIZE 256
+
+// Swaps the elements at `a` and `b`, with plain loads and stores for the
+// common widths.
+static inline void swap(char *a, char *b, size_t width)
+{
+#define SWAP_(n)                                                              \
+    do {                                                                      \
+        char x[n], y[n];                                                      \
+        memcpy(x, a, n);                                                      \
+        memcpy(y, b, n);                                                      \
+        memcpy(a, y, n);                                                      \
+        memcpy(b, x, n);                                                      \
+    } while (0)
+
+    switch (width) {
+    case 1: SWAP_(1); return;
+    case 2: SWAP_(2); return;
+    case 4: SWAP_(4); return;
+    case 8: SWAP_(8); return;
+    case 16: SWAP_(16); return;
+    }
+#undef SWAP_
+
+    char temp[SCRATCH_SIZE];
+    for (size_t n; width; a += n, b += n, width -= n) {
+        n = width < SCRATCH_SIZE ? width : SCRATCH_SIZE;
+        memcpy(temp, a, n);
+        memcpy(a, b, n);
+        memcpy(b, temp, n);
+    }
+}
+
+#endif
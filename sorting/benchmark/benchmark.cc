@@ -0,0 +1,20 @@
+#include <cstddef>
+#include <ctime>
+
+#include "benchmark.hh"
+
+struct timespec now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts;
+}
+
+// Returns number of seconds between b and a.
+double calculate(const struct timespec *b, const struct timespec *a)
+{
+    if (b == NULL || a == NULL)
+        return 0.0;
+
+    return (a->tv_sec - b->tv_sec) + (a->tv_nsec - b->tv_nsec) / 1e9;
+}
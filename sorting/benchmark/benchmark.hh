@@ -0,0 +1,16 @@
+/**
+ * Contains declarations for functions to measure wall-clock time.
+ */
+
+#ifndef BENCHMARK_HH
+#define BENCHMARK_HH
+
+#include <ctime>
+
+// Returns the current time of the monotonic clock.
+struct timespec now(void);
+
+// Returns number of seconds between b and a.
+double calculate(const struct timespec *b, const struct timespec *a);
+
+#endif
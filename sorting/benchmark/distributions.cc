@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "distributions.hh"
+
+using namespace std;
+
+// Number of distinct values for the few-unique distribution.
+static const uint64_t FEW_UNIQUE_VALUES = 16;
+
+// Number of ranks for the Zipf distribution.
+static const size_t ZIPF_RANKS = 1 << 16;
+
+static const char *names[DIST_COUNT]
+    = { "random", "sorted", "reversed", "organ_pipe", "few_unique", "zipf" };
+
+static uint64_t random_key(void);
+static double random_unit(void);
+static void store_key(char *element, size_t width, uint64_t key);
+
+const char *distribution_name(enum distribution distribution)
+{
+    return names[distribution];
+}
+
+void generate(
+    void *array, size_t nel, size_t width, enum distribution distribution)
+{
+    char *arr = (char *)array;
+
+    // The cumulative distribution function for Zipf, built only when needed.
+    vector<double> cdf;
+    if (distribution == DIST_ZIPF) {
+        cdf.resize(ZIPF_RANKS);
+        double sum = 0.0;
+        for (size_t i = 0; i < ZIPF_RANKS; i++)
+            cdf[i] = sum += 1.0 / (i + 1);
+        for (size_t i = 0; i < ZIPF_RANKS; i++)
+            cdf[i] /= sum;
+    }
+
+    for (size_t i = 0; i < nel; i++) {
+        uint64_t key = 0;
+        switch (distribution) {
+        case DIST_RANDOM:
+            key = random_key();
+            break;
+        case DIST_SORTED:
+            key = i;
+            break;
+        case DIST_REVERSED:
+            key = nel - i;
+            break;
+        case DIST_ORGAN_PIPE:
+            key = i < nel / 2 ? i : nel - i;
+            break;
+        case DIST_FEW_UNIQUE:
+            key = random_key() % FEW_UNIQUE_VALUES;
+            break;
+        case DIST_ZIPF:
+            key = lower_bound(cdf.begin(), cdf.end(), random_unit())
+                - cdf.begin();
+            break;
+        case DIST_COUNT:
+            break;
+        }
+        store_key(arr + i * width, width, key);
+    }
+}
+
+int key32_comparator(const void *a, const void *b)
+{
+    uint32_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return (x > y) - (x < y);
+}
+
+int key64_comparator(const void *a, const void *b)
+{
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return (x > y) - (x < y);
+}
+
+int (*key_comparator(size_t width))(const void *, const void *)
+{
+    return width < sizeof(uint64_t) ? key32_comparator : key64_comparator;
+}
+
+// Combines several calls to rand(), since RAND_MAX may be as small as 2^15.
+static uint64_t random_key(void)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < 5; i++)
+        key = (key << 15) ^ (uint64_t)rand();
+    return key;
+}
+
+static double random_unit(void)
+{
+    return (random_key() >> 11) * (1.0 / (UINT64_C(1) << 53));
+}
+
+static void store_key(char *element, size_t width, uint64_t key)
+{
+    if (width < sizeof(uint64_t)) {
+        uint32_t key32 = (uint32_t)key;
+        memcpy(element, &key32, sizeof(key32));
+        memset(element + sizeof(key32), (int)key, width - sizeof(key32));
+    } else {
+        memcpy(element, &key, sizeof(key));
+        memset(element + sizeof(key), (int)key, width - sizeof(key));
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * Contains declarations for generating benchmark inputs.
+ *
+ * Every element is `width` bytes wide and starts with its key: an unsigned
+ * 32-bit integer when the width is 4, and an unsigned 64-bit integer
+ * otherwise. The remaining bytes are payload that only has to be moved
+ * around along with the key.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef DISTRIBUTIONS_HH
+#define DISTRIBUTIONS_HH
+
+enum distribution {
+    DIST_RANDOM,     /* Uniformly random keys */
+    DIST_SORTED,     /* Already sorted keys */
+    DIST_REVERSED,   /* Keys sorted in descending order */
+    DIST_ORGAN_PIPE, /* Ascending first half, descending second half */
+    DIST_FEW_UNIQUE, /* Random keys drawn from 16 distinct values */
+    DIST_ZIPF,       /* Zipf distributed keys (s = 1) */
+    DIST_COUNT
+};
+
+const char *distribution_name(enum distribution distribution);
+
+// Fills `array` with `nel` elements of `width` bytes each, whose keys follow
+// the given distribution. rand() must be seeded by the caller.
+void generate(
+    void *array, size_t nel, size_t width, enum distribution distribution);
+
+// Comparators for the keys written by generate().
+int key32_comparator(const void *a, const void *b);
+int key64_comparator(const void *a, const void *b);
+
+// Returns the comparator that matches the keys of elements of `width` bytes.
+int (*key_comparator(size_t width))(const void *, const void *);
+
+#endif
@@ -0,0 +1,401 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <getopt.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hh"
+#include "distributions.hh"
+#include "merge_sort.hh"
+#include "pivots.hh"
+#include "quicksort.hh"
+#include "rng.hh"
+
+using namespace std;
+
+typedef int (*comparator_t)(const void *, const void *);
+
+// A sort engine under benchmark.
+struct engine {
+    const char *name;
+    void (*sort)(void *, size_t, size_t, comparator_t);
+
+    // Bitmask of the distributions on which the engine degrades to quadratic
+    // time (and linear recursion depth).
+    unsigned quadratic;
+
+    // Statistics of the last run, see sort_stats.hh.
+    const struct sort_stats *(*stats)(void);
+};
+
+// Benchmark settings, overridable from the command line.
+struct settings {
+    size_t min_size        = 1000;
+    size_t max_size        = 10000000;
+    vector<size_t> widths  = { 4, 8, 16, 64, 256 };
+    int repeat             = 3;
+    size_t max_bytes       = (size_t)1 << 30;
+    size_t quadratic_limit = 10000;
+    unsigned seed          = 0;
+    const char *baseline   = NULL;
+    double tolerance       = 0.10;
+};
+
+#define BIT(distribution) (1u << (distribution))
+
+static void quicksort_first(void *, size_t, size_t, comparator_t);
+static void quicksort_last(void *, size_t, size_t, comparator_t);
+static void quicksort_median(void *, size_t, size_t, comparator_t);
+static void quicksort_random(void *, size_t, size_t, comparator_t);
+static void merge_sort_default(void *, size_t, size_t, comparator_t);
+static void merge_sort_low_memory(void *, size_t, size_t, comparator_t);
+
+static const unsigned DUPLICATES = BIT(DIST_FEW_UNIQUE) | BIT(DIST_ZIPF);
+static const unsigned PRESORTED
+    = BIT(DIST_SORTED) | BIT(DIST_REVERSED) | BIT(DIST_ORGAN_PIPE);
+
+static const struct engine engines[] = {
+    { "quicksort/first", quicksort_first, PRESORTED | DUPLICATES,
+        quicksort_stats },
+    { "quicksort/last", quicksort_last, PRESORTED | DUPLICATES,
+        quicksort_stats },
+    { "quicksort/median", quicksort_median,
+        BIT(DIST_REVERSED) | BIT(DIST_ORGAN_PIPE) | DUPLICATES,
+        quicksort_stats },
+    { "quicksort/random", quicksort_random, DUPLICATES, quicksort_stats },
+    { "merge_sort", merge_sort_default, 0, merge_sort_stats },
+    { "merge_sort/low_memory", merge_sort_low_memory, 0, merge_sort_stats },
+};
+
+static const size_t ENGINES = sizeof(engines) / sizeof(engines[0]);
+
+static void usage(const char *program);
+static bool parse_arguments(int argc, char **argv, struct settings *settings);
+static size_t parse_size(const char *string);
+static map<string, double> load_baseline(const char *path);
+static string row_key(
+    const char *engine, const char *distribution, size_t width, size_t nel);
+static bool is_sorted(
+    const char *array, size_t nel, size_t width, comparator_t comparator);
+static void print_stats(const struct sort_stats *stats);
+
+int main(int argc, char **argv)
+{
+    struct settings settings;
+    if (!parse_arguments(argc, argv, &settings)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    map<string, double> baseline;
+    if (settings.baseline != NULL)
+        baseline = load_baseline(settings.baseline);
+
+    // The seed also makes the pivots of quicksort reproducible.
+    unsigned seed = settings.seed ? settings.seed : time(NULL);
+    srand(seed);
+    rng_seed(rng_thread(), seed);
+
+    printf("engine,distribution,width,nel,seconds,ns_per_element,status");
+#ifdef SORT_STATS
+    printf(",comparisons,moves,max_depth,partitions,imbalance");
+#endif
+    printf("\n");
+
+    int regressions = 0;
+    for (size_t nel = settings.min_size; nel <= settings.max_size; nel *= 10) {
+        for (size_t width : settings.widths) {
+            // The input, a working copy and merge sort's auxiliary buffer.
+            bool fits = nel <= settings.max_bytes / width / 3;
+
+            char *input = NULL, *work = NULL;
+            if (fits) {
+                input = (char *)malloc(nel * width);
+                work  = (char *)malloc(nel * width);
+                fits  = input != NULL && work != NULL;
+            }
+
+            comparator_t comparator = key_comparator(width);
+
+            for (int d = 0; d < DIST_COUNT; d++) {
+                enum distribution distribution = (enum distribution)d;
+                const char *dist_name = distribution_name(distribution);
+
+                if (fits)
+                    generate(input, nel, width, distribution);
+
+                for (size_t e = 0; e < ENGINES; e++) {
+                    const struct engine *engine = &engines[e];
+
+                    const char *status = "ok";
+                    if (!fits)
+                        status = "skipped_memory";
+                    else if ((engine->quadratic & BIT(distribution))
+                        && nel > settings.quadratic_limit)
+                        status = "skipped_quadratic";
+
+                    if (strcmp(status, "ok") != 0) {
+                        printf("%s,%s,%zu,%zu,,,%s", engine->name,
+                            dist_name, width, nel, status);
+#ifdef SORT_STATS
+                        printf(",,,,,");
+#endif
+                        printf("\n");
+                        continue;
+                    }
+
+                    // Keep the fastest of the repetitions.
+                    double best = 0.0;
+                    for (int r = 0; r < settings.repeat; r++) {
+                        memcpy(work, input, nel * width);
+
+                        struct timespec before = now();
+                        engine->sort(work, nel, width, comparator);
+                        struct timespec after = now();
+
+                        if (!is_sorted(work, nel, width, comparator)) {
+                            fprintf(stderr, "%s failed to sort %s input\n",
+                                engine->name, dist_name);
+                            return 2;
+                        }
+
+                        double seconds = calculate(&before, &after);
+                        if (r == 0 || seconds < best)
+                            best = seconds;
+                    }
+
+                    printf("%s,%s,%zu,%zu,%.9f,%.3f,%s", engine->name,
+                        dist_name, width, nel, best, best * 1e9 / nel, status);
+                    print_stats(engine->stats());
+                    printf("\n");
+                    fflush(stdout);
+
+                    // Compare against the baseline, if one was provided.
+                    auto it = baseline.find(
+                        row_key(engine->name, dist_name, width, nel));
+                    if (it != baseline.end()
+                        && best > it->second * (1.0 + settings.tolerance)) {
+                        fprintf(stderr,
+                            "REGRESSION %s,%s,%zu,%zu: %.6fs -> %.6fs "
+                            "(%+.1f%%)\n",
+                            engine->name, dist_name, width, nel, it->second,
+                            best, (best / it->second - 1.0) * 100.0);
+                        regressions++;
+                    }
+                }
+            }
+
+            free(input);
+            free(work);
+        }
+
+        // Guard against overflow when max_size is close to SIZE_MAX.
+        if (nel > settings.max_size / 10)
+            break;
+    }
+
+    if (regressions > 0) {
+        fprintf(stderr, "%i regression(s) against %s\n", regressions,
+            settings.baseline);
+        return 3;
+    }
+
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [options] > results.csv\n"
+        "  --min-size N         smallest number of elements (default 1e3)\n"
+        "  --max-size N         largest number of elements (default 1e7)\n"
+        "  --widths W,W,...     element widths in bytes, each >= 4\n"
+        "                       (default 4,8,16,64,256)\n"
+        "  --repeat N           runs per configuration, fastest is kept\n"
+        "                       (default 3)\n"
+        "  --max-bytes N        memory budget for input + copies\n"
+        "                       (default 1GiB)\n"
+        "  --quadratic-limit N  largest input given to an engine on a\n"
+        "                       distribution it is quadratic on (default "
+        "1e4)\n"
+        "  --seed N             seed for the input generator\n"
+        "  --baseline FILE      CSV from a previous run to compare against\n"
+        "  --tolerance F        allowed slowdown before reporting a\n"
+        "                       regression (default 0.10)\n",
+        program);
+}
+
+static bool parse_arguments(int argc, char **argv, struct settings *settings)
+{
+    static const struct option options[] = {
+        { "min-size", required_argument, NULL, 'n' },
+        { "max-size", required_argument, NULL, 'N' },
+        { "widths", required_argument, NULL, 'w' },
+        { "repeat", required_argument, NULL, 'r' },
+        { "max-bytes", required_argument, NULL, 'm' },
+        { "quadratic-limit", required_argument, NULL, 'q' },
+        { "seed", required_argument, NULL, 's' },
+        { "baseline", required_argument, NULL, 'b' },
+        { "tolerance", required_argument, NULL, 't' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (option) {
+        case 'n':
+            settings->min_size = parse_size(optarg);
+            break;
+        case 'N':
+            settings->max_size = parse_size(optarg);
+            break;
+        case 'w': {
+            settings->widths.clear();
+            stringstream list(optarg);
+            string width;
+            while (getline(list, width, ','))
+                settings->widths.push_back(parse_size(width.c_str()));
+            break;
+        }
+        case 'r':
+            settings->repeat = atoi(optarg);
+            break;
+        case 'm':
+            settings->max_bytes = parse_size(optarg);
+            break;
+        case 'q':
+            settings->quadratic_limit = parse_size(optarg);
+            break;
+        case 's':
+            settings->seed = (unsigned)parse_size(optarg);
+            break;
+        case 'b':
+            settings->baseline = optarg;
+            break;
+        case 't':
+            settings->tolerance = atof(optarg);
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (optind != argc || settings->min_size == 0 || settings->repeat < 1
+        || settings->widths.empty())
+        return false;
+
+    for (size_t width : settings->widths)
+        if (width < 4)
+            return false;
+
+    return true;
+}
+
+// Accepts both plain integers and scientific notation, e.g. 1e9.
+static size_t parse_size(const char *string)
+{
+    return (size_t)strtod(string, NULL);
+}
+
+static map<string, double> load_baseline(const char *path)
+{
+    map<string, double> baseline;
+
+    ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Could not open baseline %s\n", path);
+        exit(1);
+    }
+
+    string line;
+    getline(file, line); // Header.
+    while (getline(file, line)) {
+        stringstream row(line);
+        string engine, distribution, width, nel, seconds;
+        getline(row, engine, ',');
+        getline(row, distribution, ',');
+        getline(row, width, ',');
+        getline(row, nel, ',');
+        getline(row, seconds, ',');
+        if (seconds.empty())
+            continue;
+
+        baseline[row_key(engine.c_str(), distribution.c_str(),
+            strtoull(width.c_str(), NULL, 10),
+            strtoull(nel.c_str(), NULL, 10))]
+            = atof(seconds.c_str());
+    }
+
+    return baseline;
+}
+
+static string row_key(
+    const char *engine, const char *distribution, size_t width, size_t nel)
+{
+    return string(engine) + "," + distribution + "," + to_string(width) + ","
+        + to_string(nel);
+}
+
+static bool is_sorted(
+    const char *array, size_t nel, size_t width, comparator_t comparator)
+{
+    for (size_t i = 1; i < nel; i++)
+        if (comparator(array + (i - 1) * width, array + i * width) > 0)
+            return false;
+    return true;
+}
+
+// Prints the statistics as CSV columns, the imbalance histogram as a single
+// space separated column. Prints nothing unless built with SORT_STATS.
+static void print_stats(const struct sort_stats *stats)
+{
+#ifdef SORT_STATS
+    printf(",%llu,%llu,%zu,%llu,", stats->comparisons, stats->moves,
+        stats->max_depth, stats->partitions);
+    for (int i = 0; i < SORT_STATS_BUCKETS; i++)
+        printf(i ? " %llu" : "%llu", stats->imbalance[i]);
+#endif
+}
+
+// Engine wrappers for every way of choosing a pivot.
+static void quicksort_first(
+    void *array, size_t nel, size_t width, comparator_t comparator)
+{
+    quicksort(array, nel, width, comparator, choose_first_element_as_pivot);
+}
+
+static void quicksort_last(
+    void *array, size_t nel, size_t width, comparator_t comparator)
+{
+    quicksort(array, nel, width, comparator, choose_last_element_as_pivot);
+}
+
+static void quicksort_median(
+    void *array, size_t nel, size_t width, comparator_t comparator)
+{
+    quicksort(array, nel, width, comparator, choose_median_as_pivot);
+}
+
+static void quicksort_random(
+    void *array, size_t nel, size_t width, comparator_t comparator)
+{
+    quicksort(array, nel, width, comparator, choose_random_pivot);
+}
+
+// Engine wrappers for every mode of merge sort.
+static void merge_sort_default(
+    void *array, size_t nel, size_t width, comparator_t comparator)
+{
+    merge_sort(array, nel, width, comparator, MERGE_SORT_DEFAULT);
+}
+
+static void merge_sort_low_memory(
+    void *array, size_t nel, size_t width, comparator_t comparator)
+{
+    merge_sort(array, nel, width, comparator, MERGE_SORT_LOW_MEMORY);
+}
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "multiway_partition.hh"
+#include "parallel_for.hh"
+
+using namespace std;
+
+// Bytes buffered per bucket (and per thread) before they are written out.
+// A few cache lines, so that every bucket's buffer stays in L1 for a
+// moderate number of buckets while the writes to dst come in whole lines.
+static const size_t BUFFER_BYTES = 256;
+
+// Elements at least this wide are written out in whole lines anyway, so they
+// are copied straight to dst.
+static const size_t CACHE_LINE = 64;
+
+// Fewest elements worth handing to a thread of its own.
+static const size_t MIN_ELEMENTS_PER_THREAD = 1 << 15;
+
+// The arguments of a partition.
+struct job {
+    const char *src;
+    char *dst;
+    const char *src_payloads;
+    char *dst_payloads;
+    size_t nel;
+    size_t width;
+    size_t payload_width;
+    size_t buckets;
+    size_t (*classify)(const void *element, void *context);
+    void *context;
+};
+
+template <class Id>
+static void partition(const struct job *job, size_t *bounds, unsigned threads);
+static void scatter(const char *src, char *dst, char *buffers, size_t *fill,
+    size_t *offsets, size_t index, size_t bucket, size_t width, size_t slots);
+static void drain(char *dst, const char *buffers, const size_t *fill,
+    const size_t *offsets, size_t buckets, size_t width, size_t slots);
+
+void multiway_partition(const void *src, void *dst, const void *src_payloads,
+    void *dst_payloads, size_t nel, size_t width, size_t payload_width,
+    size_t buckets, size_t (*classify)(const void *element, void *context),
+    void *context, size_t *bounds, unsigned threads)
+{
+    if (threads == 0) {
+        threads = thread::hardware_concurrency();
+        threads = min<size_t>(threads, nel / MIN_ELEMENTS_PER_THREAD);
+    }
+    threads = max(threads, 1u);
+
+    const struct job job = { (const char *)src, (char *)dst,
+        (const char *)src_payloads, (char *)dst_payloads, nel, width,
+        payload_width, buckets, classify, context };
+
+    // Bucket ids are kept between the passes, in the narrowest type that
+    // holds them.
+    if (buckets <= UINT8_MAX + 1)
+        partition<uint8_t>(&job, bounds, threads);
+    else if (buckets <= UINT16_MAX + 1)
+        partition<uint16_t>(&job, bounds, threads);
+    else
+        partition<uint32_t>(&job, bounds, threads);
+}
+
+template <class Id>
+static void partition(const struct job *job, size_t *bounds, unsigned threads)
+{
+    const size_t nel = job->nel, buckets = job->buckets;
+    Id *ids = (Id *)malloc(nel * sizeof(Id));
+
+    // Counts of every bucket in every thread's chunk, and later the index in
+    // dst every thread writes its next element of every bucket to.
+    vector<size_t> offsets(threads * buckets, 0);
+
+    parallel_for(threads, [&](unsigned t) {
+        size_t *counts = &offsets[t * buckets];
+        for (size_t i = nel * t / threads, end = nel * (t + 1) / threads;
+             i < end; i++) {
+            const char *element = job->src + i * job->width;
+            size_t bucket       = job->classify(element, job->context);
+            ids[i]              = (Id)bucket;
+            counts[bucket]++;
+        }
+    });
+
+    // Buckets in order and, within every bucket, the threads in order, which
+    // keeps the partition stable.
+    size_t sum = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        bounds[b] = sum;
+        for (unsigned t = 0; t < threads; t++) {
+            size_t count               = offsets[t * buckets + b];
+            offsets[t * buckets + b]   = sum;
+            sum += count;
+        }
+    }
+    bounds[buckets] = sum;
+
+    const size_t slots
+        = job->width < CACHE_LINE ? BUFFER_BYTES / job->width : 0;
+    const size_t payload_slots
+        = job->payload_width && job->payload_width < CACHE_LINE
+        ? BUFFER_BYTES / job->payload_width
+        : 0;
+
+    parallel_for(threads, [&](unsigned t) {
+        size_t begin = nel * t / threads, end = nel * (t + 1) / threads;
+        bool payloads = job->src_payloads != NULL;
+
+        // Elements and payloads have buffers of their own, which fill up at
+        // different times, so the payloads track their offsets separately.
+        size_t *key_offsets = &offsets[t * buckets];
+        vector<size_t> payload_offsets(key_offsets, key_offsets + buckets);
+        vector<size_t> key_fill(buckets, 0), payload_fill(buckets, 0);
+        char *key_buffers = slots > 1
+            ? (char *)malloc(buckets * slots * job->width)
+            : NULL;
+        char *payload_buffers = payloads && payload_slots > 1
+            ? (char *)malloc(buckets * payload_slots * job->payload_width)
+            : NULL;
+
+        for (size_t i = begin; i < end; i++) {
+            size_t bucket = ids[i];
+            scatter(job->src, job->dst, key_buffers, key_fill.data(),
+                key_offsets, i, bucket, job->width, slots);
+            if (payloads)
+                scatter(job->src_payloads, job->dst_payloads,
+                    payload_buffers, payload_fill.data(),
+                    payload_offsets.data(), i, bucket, job->payload_width,
+                    payload_slots);
+        }
+
+        drain(job->dst, key_buffers, key_fill.data(), key_offsets, buckets,
+            job->width, slots);
+        if (payloads)
+            drain(job->dst_payloads, payload_buffers, payload_fill.data(),
+                payload_offsets.data(), buckets, job->payload_width,
+                payload_slots);
+
+        free(key_buffers);
+        free(payload_buffers);
+    });
+
+    free(ids);
+}
+
+// Appends element `index` of src to the buffer of its bucket, writing the
+// buffer out to dst once it is full. Without buffers, the element is copied
+// straight to dst.
+static void scatter(const char *src, char *dst, char *buffers, size_t *fill,
+    size_t *offsets, size_t index, size_t bucket, size_t width, size_t slots)
+{
+    if (buffers == NULL) {
+        memcpy(dst + offsets[bucket]++ * width, src + index * width, width);
+        return;
+    }
+
+    char *buffer = buffers + bucket * slots * width;
+    memcpy(buffer + fill[bucket] * width, src + index * width, width);
+    if (++fill[bucket] == slots) {
+        memcpy(dst + offsets[bucket] * width, buffer, slots * width);
+        offsets[bucket] += slots;
+        fill[bucket] = 0;
+    }
+}
+
+// Writes out what is left in the buffers.
+static void drain(char *dst, const char *buffers, const size_t *fill,
+    const size_t *offsets, size_t buckets, size_t width, size_t slots)
+{
+    if (buffers == NULL)
+        return;
+
+    for (size_t b = 0; b < buckets; b++)
+        memcpy(dst + offsets[b] * width, buffers + b * slots * width,
+            fill[b] * width);
+}
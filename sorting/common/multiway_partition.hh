@@ -0,0 +1,34 @@
+/**
+ * Contains the stable multiway partition shared by the sort engines:
+ * classifying elements into buckets, then moving every bucket to its own
+ * range.
+ */
+
+#include <cstddef>
+
+#ifndef MULTIWAY_PARTITION_HH
+#define MULTIWAY_PARTITION_HH
+
+/**
+ * Moves the `nel` elements of `src` (`width` bytes each) to `dst`, grouped by
+ * the bucket `classify(element, context)` returns for them, which must be in
+ * [0, buckets). Bucket b ends up in [bounds[b], bounds[b + 1]) of dst, so
+ * `bounds` must have room for buckets + 1 entries. Elements of the same
+ * bucket keep their order. `src_payloads`, if not NULL, are moved to
+ * `dst_payloads` in lockstep. The ranges of src and dst must not overlap.
+ *
+ * The work is spread over `threads` threads, 0 picks a number based on the
+ * number of elements and cores. Every thread classifies a chunk of the
+ * elements and counts its buckets, the counts are summed up by bucket and
+ * then thread so that every thread owns a range of every bucket, and every
+ * thread scatters its chunk through a small buffer per bucket, so that dst
+ * is written a few cache lines at a time rather than an element at a time.
+ * `classify` is called exactly once per element, possibly from several
+ * threads at once.
+ */
+void multiway_partition(const void *src, void *dst, const void *src_payloads,
+    void *dst_payloads, size_t nel, size_t width, size_t payload_width,
+    size_t buckets, size_t (*classify)(const void *element, void *context),
+    void *context, size_t *bounds, unsigned threads = 0);
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * Contains the thread helper shared by the parallel sort engines.
+ */
+
+#include <thread>
+#include <vector>
+
+#ifndef PARALLEL_FOR_HH
+#define PARALLEL_FOR_HH
+
+// Calls function(t) for every t in [0, threads), each on a thread of its own.
+// Thread 0 is the calling thread.
+template <class Function>
+static void parallel_for(unsigned threads, Function &&function)
+{
+    if (threads == 1) {
+        function(0);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(function, t);
+    function(0);
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * Contains the instrumentation shared by the sort engines.
+ *
+ * Statistics are only collected when compiled with -DSORT_STATS. Otherwise
+ * every STATS() statement expands to nothing and the engines run exactly the
+ * same code as before.
+ */
+
+#include <cstddef>
+
+#ifndef SORT_STATS_HH
+#define SORT_STATS_HH
+
+// Number of buckets of the partition imbalance histogram.
+#define SORT_STATS_BUCKETS 10
+
+struct sort_stats {
+    unsigned long long comparisons; /* Calls made to the comparator */
+    unsigned long long moves;       /* Elements copied, a swap counts as 3 */
+    size_t depth;                   /* Current recursion depth */
+    size_t max_depth;               /* Deepest recursion reached */
+    unsigned long long partitions;  /* Partitions (or merges) performed */
+
+    // Histogram of the size of the smaller side of every partition relative
+    // to the whole: bucket 0 holds the most lopsided partitions, bucket
+    // SORT_STATS_BUCKETS - 1 the perfectly balanced ones.
+    unsigned long long imbalance[SORT_STATS_BUCKETS];
+};
+
+#ifdef SORT_STATS
+#define STATS(statement)                                                      \
+    do {                                                                      \
+        statement;                                                            \
+    } while (0)
+#else
+#define STATS(statement)                                                      \
+    do {                                                                      \
+    } while (0)
+#endif
+
+inline void sort_stats_enter(struct sort_stats *stats)
+{
+    if (++stats->depth > stats->max_depth)
+        stats->max_depth = stats->depth;
+}
+
+inline void sort_stats_leave(struct sort_stats *stats)
+{
+    stats->depth--;
+}
+
+// Records a partition (or merge) of `left + right` elements into two sides.
+inline void sort_stats_partition(
+    struct sort_stats *stats, size_t left, size_t right)
+{
+    size_t total = left + right;
+    if (total == 0)
+        return;
+
+    size_t smaller = left < right ? left : right;
+    size_t bucket  = smaller * 2 * SORT_STATS_BUCKETS / total;
+    if (bucket >= SORT_STATS_BUCKETS)
+        bucket = SORT_STATS_BUCKETS - 1;
+
+    stats->partitions++;
+    stats->imbalance[bucket]++;
+}
+
+// Adds the statistics collected by another thread to `total`.
+inline void sort_stats_add(
+    struct sort_stats *total, const struct sort_stats *part)
+{
+    total->comparisons += part->comparisons;
+    total->moves += part->moves;
+    total->partitions += part->partitions;
+    if (part->max_depth > total->max_depth)
+        total->max_depth = part->max_depth;
+    for (int i = 0; i < SORT_STATS_BUCKETS; i++)
+        total->imbalance[i] += part->imbalance[i];
+}
+
+#endif
@@ -1,5 +1,9 @@
 #include "merge_sort.hh"
 #include "randomize_array.hh"
+#include "sorted_set.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <iostream>
 
 #pragma GCC diagnostic ignored "-Wunused-variable"
@@ -10,6 +14,8 @@ using namespace std;
 // Comparator declarations.
 int integer_comparator(const void *a, const void *b);
 int char_comparator(const void *a, const void *b);
+int uint32_comparator(const void *a, const void *b);
+int uint64_comparator(const void *a, const void *b);
 int string_comparator(const void *a, const void *b);
 int struct_comparator(const void *a, const void *b);
 
@@ -19,6 +25,12 @@ void test_integers(void);
 void test_chars(void);
 void test_strings(void);
 void test_structures(void);
+void test_by_key(void);
+void test_sizes(int flags);
+void test_stats(void);
+void test_unique(int flags);
+void test_sorted_sets(void);
+void test_segments(unsigned threads);
 
 // Test whether an array is sorted according to the comparator provided.
 void test_array_is_sorted(void *array, size_t nel, size_t width,
@@ -51,6 +63,36 @@ void test(void)
     // Test merge sort with structure.
     test_structures();
     printf("Structure array tests passed!\n");
+
+    // Test merge sort with parallel key and payload arrays.
+    test_by_key();
+    printf("Key/payload tests passed!\n");
+
+    // Test merge sort with sizes around the run and block boundaries.
+    test_sizes(MERGE_SORT_DEFAULT);
+    printf("Size tests passed!\n");
+
+    // Test the low memory mode with the same sizes.
+    test_sizes(MERGE_SORT_LOW_MEMORY);
+    printf("Low memory tests passed!\n");
+
+    // Test sorting with duplicates removed, in both modes.
+    test_unique(MERGE_SORT_DEFAULT);
+    test_unique(MERGE_SORT_LOW_MEMORY);
+    printf("Unique tests passed!\n");
+
+    // Test the set operations on sorted arrays.
+    test_sorted_sets();
+    printf("Sorted set tests passed!\n");
+
+    // Test sorting many segments at once, with any number of threads.
+    const unsigned THREADS[] = { 0, 1, 3 };
+    for (unsigned threads : THREADS)
+        test_segments(threads);
+    printf("Segment tests passed with any number of threads\n");
+
+    // Test the statistics collected by merge sort.
+    test_stats();
 }
 
 void test_integers(void)
@@ -142,6 +184,310 @@ void test_structures(void)
     free(array);
 }
 
+void test_by_key(void)
+{
+    // Setup. Few distinct keys, and the original index as the payload.
+    const int SIZE  = 1000;
+    int *keys       = (int *)malloc(SIZE * sizeof(int));
+    size_t *indices = (size_t *)malloc(SIZE * sizeof(size_t));
+    for (int i = 0; i < SIZE; i++) {
+        keys[i]    = rand() % 10;
+        indices[i] = i;
+    }
+    int *original = (int *)malloc(SIZE * sizeof(int));
+    memcpy(original, keys, SIZE * sizeof(int));
+
+    // Sort and test.
+    merge_sort_by_key(
+        keys, indices, SIZE, sizeof(int), sizeof(size_t), integer_comparator);
+    test_array_is_sorted(keys, SIZE, sizeof(int), integer_comparator);
+
+    // Every payload must still belong to its key, and equal keys must keep
+    // their original order.
+    for (int i = 0; i < SIZE; i++) {
+        assert(original[indices[i]] == keys[i]);
+        if (i > 0 && keys[i - 1] == keys[i])
+            assert(indices[i - 1] < indices[i]);
+    }
+
+    // Cleanup.
+    free(keys);
+    free(indices);
+    free(original);
+}
+
+void test_sizes(int flags)
+{
+    // Spans runs, partial runs, cache blocks and several 4-way merge passes
+    // over the blocks.
+    const size_t SIZES[] = { 0, 1, 2, 15, 16, 17, 64, 65, 1000, 32768, 32769,
+        300000, 600000 };
+
+    for (size_t size : SIZES) {
+        // Setup. Duplicate keys, and the original index as the payload.
+        int *keys       = (int *)malloc((size + 1) * sizeof(int));
+        size_t *indices = (size_t *)malloc((size + 1) * sizeof(size_t));
+        for (size_t i = 0; i < size; i++) {
+            keys[i]    = rand() % 1000;
+            indices[i] = i;
+        }
+        int *original = (int *)malloc((size + 1) * sizeof(int));
+        memcpy(original, keys, size * sizeof(int));
+
+        // Sort and test.
+        merge_sort_by_key(keys, indices, size, sizeof(int), sizeof(size_t),
+            integer_comparator, flags);
+        test_array_is_sorted(keys, size, sizeof(int), integer_comparator);
+        for (size_t i = 0; i < size; i++) {
+            assert(original[indices[i]] == keys[i]);
+            if (i > 0 && keys[i - 1] == keys[i])
+                assert(indices[i - 1] < indices[i]);
+        }
+
+        // Cleanup.
+        free(keys);
+        free(indices);
+        free(original);
+    }
+}
+
+void test_unique(int flags)
+{
+    const size_t SIZES[] = { 0, 1, 2, 17, 1000, 32769, 300000 };
+
+    for (size_t size : SIZES) {
+        // Setup. Keys in [0, size / 2), and the original index as the payload.
+        int *keys       = (int *)malloc((size + 1) * sizeof(int));
+        size_t *indices = (size_t *)malloc((size + 1) * sizeof(size_t));
+        for (size_t i = 0; i < size; i++) {
+            keys[i]    = rand() % (size / 2 + 1);
+            indices[i] = i;
+        }
+        int *original = (int *)malloc((size + 1) * sizeof(int));
+        memcpy(original, keys, size * sizeof(int));
+        int *expected = (int *)malloc((size + 1) * sizeof(int));
+        memcpy(expected, keys, size * sizeof(int));
+        sort(expected, expected + size);
+        size_t distinct = unique(expected, expected + size) - expected;
+
+        // The first of every equal run is kept, with its payload.
+        size_t nel = merge_sort_unique_by_key(keys, indices, size, sizeof(int),
+            sizeof(size_t), integer_comparator, flags);
+        assert(nel == distinct);
+        for (size_t i = 0; i < nel; i++) {
+            assert(keys[i] == expected[i]);
+            assert(original[indices[i]] == keys[i]);
+            for (size_t j = 0; j < indices[i]; j++)
+                if (size < 2000)
+                    assert(original[j] != keys[i]);
+        }
+
+        // Keys only.
+        memcpy(keys, original, size * sizeof(int));
+        nel = merge_sort_unique(keys, size, sizeof(int), integer_comparator,
+            flags);
+        assert(nel == distinct);
+        assert(memcmp(keys, expected, nel * sizeof(int)) == 0);
+
+        // Cleanup.
+        free(keys);
+        free(indices);
+        free(original);
+        free(expected);
+    }
+}
+
+// Random set of nel integers in [0, range).
+template <class T> static T *random_set(size_t nel, size_t range, size_t *size)
+{
+    T *set = (T *)malloc((nel + 1) * sizeof(T));
+    for (size_t i = 0; i < nel; i++)
+        set[i] = rand() % range;
+    sort(set, set + nel);
+    *size = unique(set, set + nel) - set;
+    return set;
+}
+
+template <class T> static void test_sorted_sets(size_t a_nel, size_t b_nel)
+{
+    // Setup. Overlapping ranges so that all operations have work to do.
+    size_t a_size, b_size;
+    T *a = random_set<T>(a_nel, 2 * a_nel + 1, &a_size);
+    T *b = random_set<T>(b_nel, 2 * a_nel + 1, &b_size);
+    T *result   = (T *)malloc((a_size + b_size + 1) * sizeof(T));
+    T *generic  = (T *)malloc((a_size + b_size + 1) * sizeof(T));
+    T *expected = (T *)malloc((a_size + b_size + 1) * sizeof(T));
+
+    // Both the typed and the comparator versions must match the standard
+    // library.
+    size_t nel = set_union(a, a + a_size, b, b + b_size, expected) - expected;
+    assert(sorted_union(a, a_size, b, b_size, result) == nel);
+    assert(memcmp(result, expected, nel * sizeof(T)) == 0);
+    assert(sorted_union(a, a_size, b, b_size, (void *)generic, sizeof(T),
+               sizeof(T) == 4 ? uint32_comparator : uint64_comparator)
+        == nel);
+    assert(memcmp(generic, expected, nel * sizeof(T)) == 0);
+
+    nel = set_intersection(a, a + a_size, b, b + b_size, expected) - expected;
+    assert(sorted_intersection(a, a_size, b, b_size, result) == nel);
+    assert(memcmp(result, expected, nel * sizeof(T)) == 0);
+    assert(sorted_intersection(a, a_size, b, b_size, (void *)generic,
+               sizeof(T),
+               sizeof(T) == 4 ? uint32_comparator : uint64_comparator)
+        == nel);
+    assert(memcmp(generic, expected, nel * sizeof(T)) == 0);
+
+    nel = set_difference(a, a + a_size, b, b + b_size, expected) - expected;
+    assert(sorted_difference(a, a_size, b, b_size, result) == nel);
+    assert(memcmp(result, expected, nel * sizeof(T)) == 0);
+    assert(sorted_difference(a, a_size, b, b_size, (void *)generic, sizeof(T),
+               sizeof(T) == 4 ? uint32_comparator : uint64_comparator)
+        == nel);
+    assert(memcmp(generic, expected, nel * sizeof(T)) == 0);
+
+    // Cleanup.
+    free(a);
+    free(b);
+    free(result);
+    free(generic);
+    free(expected);
+}
+
+void test_sorted_sets(void)
+{
+    // Empty inputs, similar sizes (SIMD blocks) and very different sizes
+    // (galloping), both ways round.
+    const size_t SIZES[][2] = { { 0, 0 }, { 0, 10 }, { 10, 0 }, { 3, 5 },
+        { 1000, 1000 }, { 100000, 70000 }, { 100000, 100 }, { 100, 100000 } };
+
+    for (const size_t *sizes : SIZES) {
+        test_sorted_sets<uint32_t>(sizes[0], sizes[1]);
+        test_sorted_sets<uint64_t>(sizes[0], sizes[1]);
+    }
+}
+
+// Returns segments + 1 offsets of segments of random lengths up to
+// `longest`, and stores the total number of elements in `nel`.
+static size_t *random_offsets(size_t segments, size_t longest, size_t *nel)
+{
+    size_t *offsets = (size_t *)malloc((segments + 1) * sizeof(size_t));
+    offsets[0]      = 0;
+    for (size_t i = 0; i < segments; i++)
+        offsets[i + 1] = offsets[i] + rand() % (longest + 1);
+    *nel = offsets[segments];
+    return offsets;
+}
+
+template <class Key> static void test_key_segments(unsigned threads)
+{
+    // Setup. Mostly segments the sorting network handles, and a few that
+    // need merging.
+    const size_t SEGMENTS[][2] = { { 0, 0 }, { 1, 0 }, { 10000, 70 },
+        { 20, 5000 } };
+
+    for (const size_t *segments : SEGMENTS) {
+        size_t nel;
+        size_t *offsets = random_offsets(segments[0], segments[1], &nel);
+        Key *keys       = (Key *)malloc((nel + 1) * sizeof(Key));
+        Key *expected   = (Key *)malloc((nel + 1) * sizeof(Key));
+        for (size_t i = 0; i < nel; i++)
+            keys[i] = expected[i] = (Key)(((uint64_t)rand() << 33)
+                ^ ((uint64_t)rand() << 10) ^ rand());
+
+        // Sort and test.
+        merge_sort_segments(keys, offsets, segments[0], threads);
+        for (size_t i = 0; i < segments[0]; i++)
+            sort(expected + offsets[i], expected + offsets[i + 1]);
+        assert(memcmp(keys, expected, nel * sizeof(Key)) == 0);
+
+        // Cleanup.
+        free(offsets);
+        free(keys);
+        free(expected);
+    }
+}
+
+void test_segments(unsigned threads)
+{
+    // Setup. Few distinct keys, and the original index as the payload.
+    size_t nel;
+    size_t *offsets = random_offsets(5000, 100, &nel);
+    int *keys       = (int *)malloc((nel + 1) * sizeof(int));
+    size_t *indices = (size_t *)malloc((nel + 1) * sizeof(size_t));
+    for (size_t i = 0; i < nel; i++) {
+        keys[i]    = rand() % 10;
+        indices[i] = i;
+    }
+    int *original = (int *)malloc((nel + 1) * sizeof(int));
+    memcpy(original, keys, nel * sizeof(int));
+
+    // Sort and test. Every segment must be sorted and stable, and no element
+    // may leave its segment.
+    merge_sort_segments_by_key(keys, indices, offsets, 5000, sizeof(int),
+        sizeof(size_t), integer_comparator, threads);
+    for (size_t s = 0; s < 5000; s++) {
+        size_t first = offsets[s], last = offsets[s + 1];
+        test_array_is_sorted(
+            keys + first, last - first, sizeof(int), integer_comparator);
+        for (size_t i = first; i < last; i++) {
+            assert(indices[i] >= first && indices[i] < last);
+            assert(original[indices[i]] == keys[i]);
+            if (i > first && keys[i - 1] == keys[i])
+                assert(indices[i - 1] < indices[i]);
+        }
+    }
+
+    // Cleanup.
+    free(offsets);
+    free(keys);
+    free(indices);
+    free(original);
+
+    // Integer keys.
+    test_key_segments<int32_t>(threads);
+    test_key_segments<uint32_t>(threads);
+    test_key_segments<int64_t>(threads);
+    test_key_segments<uint64_t>(threads);
+}
+
+void test_stats(void)
+{
+#ifdef SORT_STATS
+    // Setup.
+    const int SIZE = 1000;
+    int *array     = (int *)malloc(SIZE * sizeof(int));
+    for (int i = 0; i < SIZE; i++)
+        array[i] = i;
+
+    // Insertion sort needs a single comparison per element of a sorted run,
+    // and runs that are already in order are copied without merging.
+    merge_sort(array, SIZE, sizeof(int), integer_comparator);
+    const struct sort_stats *stats = merge_sort_stats();
+    assert(stats->comparisons < 2 * SIZE);
+    assert(stats->max_depth == 0);
+    assert(stats->partitions > 0);
+
+    // Statistics are reset on every call.
+    randomize_array(array, SIZE, sizeof(int));
+    merge_sort(array, SIZE, sizeof(int), integer_comparator);
+    test_array_is_sorted(array, SIZE, sizeof(int), integer_comparator);
+    assert(stats->comparisons > 2 * SIZE);
+    assert(stats->comparisons < 2 * SIZE * 10);
+    assert(stats->moves >= SIZE);
+
+    // Counts of every thread sorting segments are summed up.
+    const size_t offsets[] = { 0, SIZE / 4, SIZE / 2, SIZE };
+    merge_sort_segments(array, offsets, 3, sizeof(int), integer_comparator, 3);
+    assert(stats->comparisons >= SIZE - 3);
+    assert(stats->moves >= SIZE);
+
+    // Cleanup.
+    free(array);
+
+    printf("Statistics tests passed!\n");
+#endif
+}
+
 void test_array_is_sorted(void *array, size_t nel, size_t width,
     int (*comparator)(const void *a, const void *b))
 {
@@ -156,6 +502,18 @@ int integer_comparator(const void *a, const void *b)
     return *(const int *)a - *(const int *)b;
 }
 
+int uint32_comparator(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int uint64_comparator(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
 int char_comparator(const void *a, const void *b)
 {
     return *(const char *)a - *(const char *)b;
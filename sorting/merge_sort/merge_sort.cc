@@ -1,71 +1,890 @@
 #include "merge_sort.hh"
+#include "parallel_for.hh"
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Runs of this many elements are sorted with insertion sort before merging.
+#define RUN 16
+
+// Size of the cache the first merge passes are blocked for. Every block of
+// elements (along with its share of the auxiliary arrays) fits in it, so the
+// passes within a block never go to memory.
+#define L2_CACHE_SIZE (256 * 1024)
+
+// Number of runs merged together by every merge pass.
+#define WAYS 4
+
+// Segments of integer keys up to this long are sorted by a sorting network.
+#define NETWORK 64
+
+// Fewest elements worth handing to a thread of its own.
+#define MIN_ELEMENTS_PER_THREAD (1 << 16)
+
+// An array of keys and the payloads permuted in lockstep with it, if any.
+struct arrays {
+    char *keys;
+    char *payloads;
+};
+
+// Element sizes and ordering shared by every step of the sort.
+struct layout {
+    size_t width;
+    size_t payload_width;
+    int (*comparator)(const void *a, const void *b);
+};
+
+// Sorts a segment of up to NETWORK integer keys without the comparator.
+typedef void (*small_sort)(char *keys, size_t nel);
+
 void merge_sort(void *array, size_t nel, size_t width,
-    int (*comparator)(const void *a, const void *b));
-static void msort(void *array, void *aux, int first, int last, size_t width,
-    int (*comparator)(const void *a, const void *b));
-static void merge(void *array, void *aux, int first, int middle, int last,
-    size_t width, int (*comparator)(const void *a, const void *b));
+    int (*comparator)(const void *a, const void *b), int flags);
+static size_t sort(struct arrays array, size_t nel, int flags, bool unique,
+    const struct layout *layout);
+static void sort_segments(struct arrays array, const size_t *offsets,
+    size_t segments, unsigned threads, small_sort small,
+    const struct layout *layout);
+static void sort_key_segments(void *keys, const size_t *offsets,
+    size_t segments, size_t width,
+    int (*comparator)(const void *a, const void *b), small_sort small,
+    unsigned threads);
+static size_t sort_with(struct arrays array, struct arrays aux, size_t nel,
+    bool unique, const struct layout *layout);
+static size_t sort_block(struct arrays array, struct arrays aux, size_t first,
+    size_t last, bool unique, const struct layout *layout);
+static void sort_low_memory(
+    struct arrays array, size_t nel, const struct layout *layout);
+static void insertion_sort(struct arrays array, struct arrays temp,
+    size_t first, size_t last, const struct layout *layout);
+static size_t merge_pass(struct arrays src, struct arrays dst, size_t first,
+    size_t last, size_t run, bool unique, const struct layout *layout);
+static size_t merge(struct arrays src, struct arrays dst,
+    const size_t bounds[WAYS + 1], bool unique, const struct layout *layout);
+static int winner(struct arrays src, const size_t heads[WAYS],
+    const size_t ends[WAYS], int a, int b, const struct layout *layout);
+static void merge_in_place(struct arrays array, struct arrays buffer,
+    size_t buffer_nel, size_t first, size_t middle, size_t last,
+    const struct layout *layout);
+static void merge_forward(struct arrays array, struct arrays buffer,
+    size_t first, size_t middle, size_t last, const struct layout *layout);
+static void merge_backward(struct arrays array, struct arrays buffer,
+    size_t first, size_t middle, size_t last, const struct layout *layout);
+static size_t rotate(struct arrays array, struct arrays buffer,
+    size_t buffer_nel, size_t first, size_t middle, size_t last,
+    const struct layout *layout);
+static void reverse(struct arrays array, struct arrays temp, size_t first,
+    size_t last, const struct layout *layout);
+static size_t lower_bound(struct arrays array, size_t first, size_t last,
+    const char *key, const struct layout *layout);
+static size_t upper_bound(struct arrays array, size_t first, size_t last,
+    const char *key, const struct layout *layout);
+static void copy(struct arrays dst, size_t to, struct arrays src, size_t from,
+    size_t count, const struct layout *layout);
+static size_t unique_copy(struct arrays dst, size_t to, struct arrays src,
+    size_t from, size_t last, const struct layout *layout);
+static struct arrays offset(
+    struct arrays array, size_t index, const struct layout *layout);
+static void swap(struct arrays *a, struct arrays *b);
+template <class Key> static void small_sort_keys(char *keys, size_t nel);
+template <class Key> static int key_comparator(const void *a, const void *b);
+#ifdef __SSE2__
+template <size_t SIZE>
+static void network_sort(int32_t *keys, size_t nel, uint32_t bias);
+static __m128i select(__m128i mask, __m128i a, __m128i b);
+#endif
+
+#ifdef SORT_STATS
+// Statistics of the current (or last) call on this thread.
+static thread_local struct sort_stats stats;
+
+// The caller's comparator, wrapped so that every call is counted.
+static thread_local int (*user_comparator)(const void *a, const void *b);
+
+static int counting_comparator(const void *a, const void *b)
+{
+    stats.comparisons++;
+    return user_comparator(a, b);
+}
+#endif
 
 void merge_sort(void *array, size_t nel, size_t width,
-    int (*comparator)(const void *a, const void *b))
+    int (*comparator)(const void *a, const void *b), int flags)
+{
+    merge_sort_by_key(array, NULL, nel, width, 0, comparator, flags);
+}
+
+void merge_sort_by_key(void *keys, void *payloads, size_t nel,
+    size_t key_width, size_t payload_width,
+    int (*comparator)(const void *a, const void *b), int flags)
+{
+#ifdef SORT_STATS
+    stats           = sort_stats();
+    user_comparator = comparator;
+    comparator      = counting_comparator;
+#endif
+
+    const struct layout layout = { key_width, payload_width, comparator };
+    const struct arrays array  = { (char *)keys, (char *)payloads };
+
+    sort(array, nel, flags, false, &layout);
+}
+
+size_t merge_sort_unique(void *array, size_t nel, size_t width,
+    int (*comparator)(const void *a, const void *b), int flags)
+{
+    return merge_sort_unique_by_key(
+        array, NULL, nel, width, 0, comparator, flags);
+}
+
+size_t merge_sort_unique_by_key(void *keys, void *payloads, size_t nel,
+    size_t key_width, size_t payload_width,
+    int (*comparator)(const void *a, const void *b), int flags)
+{
+#ifdef SORT_STATS
+    stats           = sort_stats();
+    user_comparator = comparator;
+    comparator      = counting_comparator;
+#endif
+
+    const struct layout layout = { key_width, payload_width, comparator };
+    const struct arrays array  = { (char *)keys, (char *)payloads };
+
+    return sort(array, nel, flags, true, &layout);
+}
+
+void merge_sort_segments(void *array, const size_t *offsets, size_t segments,
+    size_t width, int (*comparator)(const void *a, const void *b),
+    unsigned threads)
+{
+    merge_sort_segments_by_key(
+        array, NULL, offsets, segments, width, 0, comparator, threads);
+}
+
+void merge_sort_segments_by_key(void *keys, void *payloads,
+    const size_t *offsets, size_t segments, size_t key_width,
+    size_t payload_width, int (*comparator)(const void *a, const void *b),
+    unsigned threads)
+{
+#ifdef SORT_STATS
+    stats           = sort_stats();
+    user_comparator = comparator;
+    comparator      = counting_comparator;
+#endif
+
+    const struct layout layout = { key_width, payload_width, comparator };
+    const struct arrays array  = { (char *)keys, (char *)payloads };
+
+    sort_segments(array, offsets, segments, threads, NULL, &layout);
+}
+
+void merge_sort_segments(int32_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads)
+{
+    sort_key_segments(keys, offsets, segments, sizeof(int32_t),
+        key_comparator<int32_t>, small_sort_keys<int32_t>, threads);
+}
+
+void merge_sort_segments(uint32_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads)
+{
+    sort_key_segments(keys, offsets, segments, sizeof(uint32_t),
+        key_comparator<uint32_t>, small_sort_keys<uint32_t>, threads);
+}
+
+void merge_sort_segments(int64_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads)
+{
+    sort_key_segments(keys, offsets, segments, sizeof(int64_t),
+        key_comparator<int64_t>, small_sort_keys<int64_t>, threads);
+}
+
+void merge_sort_segments(uint64_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads)
+{
+    sort_key_segments(keys, offsets, segments, sizeof(uint64_t),
+        key_comparator<uint64_t>, small_sort_keys<uint64_t>, threads);
+}
+
+static void sort_key_segments(void *keys, const size_t *offsets,
+    size_t segments, size_t width,
+    int (*comparator)(const void *a, const void *b), small_sort small,
+    unsigned threads)
+{
+#ifdef SORT_STATS
+    stats           = sort_stats();
+    user_comparator = comparator;
+    comparator      = counting_comparator;
+#endif
+
+    const struct layout layout = { width, 0, comparator };
+    const struct arrays array  = { (char *)keys, NULL };
+
+    sort_segments(array, offsets, segments, threads, small, &layout);
+}
+
+// Sorts every segment of the array on its own. The segments are spread over
+// the threads by the number of elements: thread t sorts the segments that
+// start in the t-th share of the elements. Every thread allocates auxiliary
+// arrays as large as its longest segment once, and reuses them for all of
+// its segments. Segments of up to NETWORK elements are handed to `small`, if
+// any.
+static void sort_segments(struct arrays array, const size_t *offsets,
+    size_t segments, unsigned threads, small_sort small,
+    const struct layout *layout)
 {
-    // Create an auxiliary array once, in order to save repetitive malloc
+    if (segments == 0)
+        return;
+
+    const size_t nel = offsets[segments] - offsets[0];
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        threads = std::min<size_t>(threads, nel / MIN_ELEMENTS_PER_THREAD);
+    }
+    threads = std::max(std::min<size_t>(threads, segments), (size_t)1);
+
+    std::vector<size_t> begin(threads + 1);
+    for (unsigned t = 0; t < threads; t++)
+        begin[t] = std::lower_bound(offsets, offsets + segments,
+                       offsets[0] + nel / threads * t)
+            - offsets;
+    begin[threads] = segments;
+
+#ifdef SORT_STATS
+    // Every thread counts on its own, and the counts are summed up after.
+    int (*caller_comparator)(const void *a, const void *b) = user_comparator;
+    std::vector<struct sort_stats> counts(threads);
+#endif
+
+    parallel_for(threads, [&](unsigned t) {
+#ifdef SORT_STATS
+        stats           = sort_stats();
+        user_comparator = caller_comparator;
+#endif
+
+        size_t longest = 0;
+        for (size_t s = begin[t]; s < begin[t + 1]; s++)
+            longest = std::max(longest, offsets[s + 1] - offsets[s]);
+
+        struct arrays aux = { (char *)malloc(longest * layout->width),
+            array.payloads ? (char *)malloc(longest * layout->payload_width)
+                           : NULL };
+
+        for (size_t s = begin[t]; s < begin[t + 1]; s++) {
+            size_t first = offsets[s], nel = offsets[s + 1] - first;
+            if (nel <= 1)
+                continue;
+
+            if (small && nel <= NETWORK)
+                small(array.keys + first * layout->width, nel);
+            else
+                sort_with(
+                    offset(array, first, layout), aux, nel, false, layout);
+        }
+
+        free(aux.keys);
+        free(aux.payloads);
+
+#ifdef SORT_STATS
+        counts[t] = stats;
+#endif
+    });
+
+#ifdef SORT_STATS
+    stats = sort_stats();
+    for (const struct sort_stats &count : counts)
+        sort_stats_add(&stats, &count);
+#endif
+}
+
+// Sorts the array, dropping all but the first of every run of equal elements
+// if `unique` is set. Returns the number of elements kept.
+static size_t sort(struct arrays array, size_t nel, int flags, bool unique,
+    const struct layout *layout)
+{
+    // If there is only 1 element or less, then it is already sorted.
+    if (nel <= 1)
+        return nel;
+
+    // Merging in place cannot drop elements, so duplicates are dropped in a
+    // separate pass afterwards.
+    if (flags & MERGE_SORT_LOW_MEMORY) {
+        sort_low_memory(array, nel, layout);
+        return unique ? unique_copy(array, 0, array, 0, nel, layout) : nel;
+    }
+
+    // Create the auxiliary arrays once, in order to save repetitive malloc
     // calls.
-    void *aux = (void *)malloc(nel * width);
+    struct arrays aux = { (char *)malloc(nel * layout->width),
+        array.payloads ? (char *)malloc(nel * layout->payload_width) : NULL };
 
-    // Sort the array.
-    msort(array, aux, 0, nel - 1, width, comparator);
+    size_t kept = sort_with(array, aux, nel, unique, layout);
 
     // Housekeeping.
-    free(aux);
+    free(aux.keys);
+    free(aux.payloads);
+
+    return kept;
+}
+
+// Sorts the array like sort() does by default, using auxiliary arrays of at
+// least `nel` elements provided by the caller.
+static size_t sort_with(struct arrays array, struct arrays aux, size_t nel,
+    bool unique, const struct layout *layout)
+{
+    // Sort cache-sized blocks first. The block size is a multiple of RUN, so
+    // that merge passes within a block line up with the insertion sorted
+    // runs. If everything fits in a single block, its last merge pass is the
+    // final one and drops the duplicates.
+    size_t block = L2_CACHE_SIZE / 2 / (layout->width + layout->payload_width);
+    block        = block < RUN ? RUN : block / RUN * RUN;
+    if (nel <= block)
+        return sort_block(array, aux, 0, nel, unique, layout);
+
+    for (size_t first = 0; first < nel; first += block)
+        sort_block(array, aux, first, first + block < nel ? first + block : nel,
+            false, layout);
+
+    // Then merge the sorted blocks, alternating between the array and the
+    // auxiliary array as the source of every pass. The final pass merges all
+    // remaining runs at once and drops the duplicates.
+    struct arrays src = array, dst = aux;
+    size_t kept       = nel;
+    for (size_t run = block; run < nel; run *= WAYS) {
+        bool final = run * WAYS >= nel;
+        kept       = merge_pass(src, dst, 0, nel, run, unique && final, layout);
+        swap(&src, &dst);
+    }
+
+    // After an odd number of passes, the result is in the auxiliary array.
+    if (src.keys != array.keys)
+        copy(array, 0, src, 0, kept, layout);
+
+    return kept;
+}
+
+const struct sort_stats *merge_sort_stats(void)
+{
+#ifdef SORT_STATS
+    return &stats;
+#else
+    static const struct sort_stats none = sort_stats();
+    return &none;
+#endif
+}
+
+// Sorts the elements in [first, last) of the array, using the same range of
+// the auxiliary array. Returns the end of the sorted elements, which is
+// before `last` only if `unique` is set and duplicates were dropped.
+static size_t sort_block(struct arrays array, struct arrays aux, size_t first,
+    size_t last, bool unique, const struct layout *layout)
+{
+    for (size_t run = first; run < last; run += RUN)
+        insertion_sort(array, offset(aux, first, layout), run,
+            run + RUN < last ? run + RUN : last, layout);
+
+    // A single run has no merge pass to drop the duplicates in.
+    if (last - first <= RUN)
+        return unique ? unique_copy(array, first, array, first, last, layout)
+                      : last;
+
+    struct arrays src = array, dst = aux;
+    size_t end        = last;
+    for (size_t run = RUN; run < last - first; run *= WAYS) {
+        bool final = run * WAYS >= last - first;
+        end = merge_pass(src, dst, first, last, run, unique && final, layout);
+        swap(&src, &dst);
+    }
+
+    if (src.keys != array.keys)
+        copy(array, first, src, first, end - first, layout);
+
+    return end;
+}
+
+// Sorts the array using a buffer of about sqrt(nel) elements: runs are
+// insertion sorted, then merged in place pairwise, bottom-up.
+static void sort_low_memory(
+    struct arrays array, size_t nel, const struct layout *layout)
+{
+    size_t buffer_nel = (size_t)sqrt((double)nel) + 1;
+    if (buffer_nel < RUN)
+        buffer_nel = RUN;
+
+    struct arrays buffer = { (char *)malloc(buffer_nel * layout->width),
+        array.payloads ? (char *)malloc(buffer_nel * layout->payload_width)
+                       : NULL };
+
+    for (size_t run = 0; run < nel; run += RUN)
+        insertion_sort(
+            array, buffer, run, run + RUN < nel ? run + RUN : nel, layout);
+
+    for (size_t run = RUN; run < nel; run *= 2)
+        for (size_t first = 0; first + run < nel; first += 2 * run)
+            merge_in_place(array, buffer, buffer_nel, first, first + run,
+                first + 2 * run < nel ? first + 2 * run : nel, layout);
+
+    // Housekeeping.
+    free(buffer.keys);
+    free(buffer.payloads);
+}
+
+// Stable insertion sort of [first, last), using the first element of `temp`
+// to hold the element being inserted.
+static void insertion_sort(struct arrays array, struct arrays temp,
+    size_t first, size_t last, const struct layout *layout)
+{
+    const size_t width = layout->width;
+
+    for (size_t i = first + 1; i < last; i++) {
+        if (layout->comparator(
+                array.keys + (i - 1) * width, array.keys + i * width)
+            <= 0)
+            continue;
+
+        // Shift the larger elements one position to the right.
+        copy(temp, 0, array, i, 1, layout);
+        size_t j = i;
+        do {
+            copy(array, j, array, j - 1, 1, layout);
+        } while (--j > first
+            && layout->comparator(array.keys + (j - 1) * width, temp.keys)
+                > 0);
+        copy(array, j, temp, 0, 1, layout);
+    }
 }
 
-static void msort(void *array, void *aux, int first, int last, size_t width,
-    int (*comparator)(const void *a, const void *b))
+// Merges every WAYS consecutive runs of `run` elements in [first, last) of
+// src into the same range of dst. `unique` may only be set for the final
+// pass, which merges a single group of runs. Returns the end of the output.
+static size_t merge_pass(struct arrays src, struct arrays dst, size_t first,
+    size_t last, size_t run, bool unique, const struct layout *layout)
 {
-    if (first == last)
+    size_t end = last;
+    for (size_t start = first; start < last; start += WAYS * run) {
+        size_t bounds[WAYS + 1];
+        for (int i = 0; i <= WAYS; i++)
+            bounds[i] = start + i * run < last ? start + i * run : last;
+        end = merge(src, dst, bounds, unique, layout);
+    }
+    return end;
+}
+
+// Merges the sorted runs [bounds[i], bounds[i + 1]) of src into dst, starting
+// at bounds[0]. Runs are paired up in a tournament: the winners of runs 0 & 1
+// and of runs 2 & 3 are kept, so every element costs 2 comparisons, like 2
+// passes of 2-way merging would, but memory is only traversed once. Ties go
+// to the earlier run, which keeps the merge stable.
+//
+// If `unique` is set, an element equal to the last one written is dropped,
+// so only the first of every run of equal elements is kept. Returns the end
+// of the output.
+static size_t merge(struct arrays src, struct arrays dst,
+    const size_t bounds[WAYS + 1], bool unique, const struct layout *layout)
+{
+    STATS(sort_stats_partition(&stats, bounds[2] - bounds[0],
+        bounds[WAYS] - bounds[2]));
+
+    // If the runs are already in order, e.g. for presorted input, just copy
+    // them over.
+    const size_t width = layout->width;
+    bool in_order      = true;
+    for (int i = 1; i < WAYS && in_order; i++)
+        if (bounds[i] > bounds[0] && bounds[i] < bounds[i + 1])
+            in_order = layout->comparator(src.keys + (bounds[i] - 1) * width,
+                           src.keys + bounds[i] * width)
+                <= 0;
+
+    if (in_order) {
+        if (unique)
+            return unique_copy(
+                dst, bounds[0], src, bounds[0], bounds[WAYS], layout);
+
+        copy(dst, bounds[0], src, bounds[0], bounds[WAYS] - bounds[0], layout);
+        return bounds[WAYS];
+    }
+
+    size_t heads[WAYS], ends[WAYS];
+    for (int i = 0; i < WAYS; i++) {
+        heads[i] = bounds[i];
+        ends[i]  = bounds[i + 1];
+    }
+
+    int left  = winner(src, heads, ends, 0, 1, layout);
+    int right = winner(src, heads, ends, 2, 3, layout);
+
+    size_t k = bounds[0];
+    for (size_t remaining = bounds[WAYS] - bounds[0]; remaining > 0;
+         remaining--) {
+        int pick = winner(src, heads, ends, left, right, layout);
+
+        if (!unique || k == bounds[0]
+            || layout->comparator(dst.keys + (k - 1) * width,
+                   src.keys + heads[pick] * width)
+                != 0)
+            copy(dst, k++, src, heads[pick], 1, layout);
+        heads[pick]++;
+
+        if (pick < 2)
+            left = winner(src, heads, ends, 0, 1, layout);
+        else
+            right = winner(src, heads, ends, 2, 3, layout);
+    }
+
+    return k;
+}
+
+// Returns whichever of the runs a and b has the smaller head, preferring a
+// (the earlier run) on ties. Exhausted runs always lose.
+static int winner(struct arrays src, const size_t heads[WAYS],
+    const size_t ends[WAYS], int a, int b, const struct layout *layout)
+{
+    if (heads[b] == ends[b])
+        return a;
+    if (heads[a] == ends[a])
+        return b;
+
+    const size_t width = layout->width;
+    return layout->comparator(
+               src.keys + heads[b] * width, src.keys + heads[a] * width)
+            < 0
+        ? b
+        : a;
+}
+
+// Stably merges the sorted ranges [first, middle) and [middle, last) of the
+// array, using a buffer of `buffer_nel` elements. Whenever one of the ranges
+// fits in the buffer, it is moved there and merged back. Otherwise, the
+// longer range is cut in half, the shorter one at the matching position
+// (found by binary search), the middle parts are swapped by a rotation and
+// both halves are merged recursively.
+static void merge_in_place(struct arrays array, struct arrays buffer,
+    size_t buffer_nel, size_t first, size_t middle, size_t last,
+    const struct layout *layout)
+{
+    const size_t width = layout->width;
+
+    if (first == middle || middle == last)
         return;
 
-    int middle = (first + last) / 2;
+    // Nothing to do if the ranges are already in order.
+    if (layout->comparator(
+            array.keys + (middle - 1) * width, array.keys + middle * width)
+        <= 0)
+        return;
+
+    size_t left = middle - first, right = last - middle;
+    STATS(sort_stats_partition(&stats, left, right));
+
+    if (left <= buffer_nel && left <= right) {
+        merge_forward(array, buffer, first, middle, last, layout);
+        return;
+    }
+    if (right <= buffer_nel) {
+        merge_backward(array, buffer, first, middle, last, layout);
+        return;
+    }
+
+    size_t left_cut, right_cut;
+    if (left > right) {
+        left_cut  = first + left / 2;
+        right_cut = lower_bound(
+            array, middle, last, array.keys + left_cut * width, layout);
+    } else {
+        right_cut = middle + right / 2;
+        left_cut  = upper_bound(
+            array, first, middle, array.keys + right_cut * width, layout);
+    }
+
+    size_t new_middle = rotate(
+        array, buffer, buffer_nel, left_cut, middle, right_cut, layout);
+
+    STATS(sort_stats_enter(&stats));
+    merge_in_place(
+        array, buffer, buffer_nel, first, left_cut, new_middle, layout);
+    merge_in_place(
+        array, buffer, buffer_nel, new_middle, right_cut, last, layout);
+    STATS(sort_stats_leave(&stats));
+}
+
+// Merges with the left range moved to the buffer, front to back.
+static void merge_forward(struct arrays array, struct arrays buffer,
+    size_t first, size_t middle, size_t last, const struct layout *layout)
+{
+    const size_t width = layout->width;
+    size_t left       = middle - first;
+
+    copy(buffer, 0, array, first, left, layout);
+
+    size_t i = 0, j = middle, k = first;
+    while (i < left && j < last) {
+        if (layout->comparator(array.keys + j * width, buffer.keys + i * width)
+            < 0)
+            copy(array, k++, array, j++, 1, layout);
+        else
+            copy(array, k++, buffer, i++, 1, layout);
+    }
+
+    // Whatever is left of the right range is already in place.
+    copy(array, k, buffer, i, left - i, layout);
+}
+
+// Merges with the right range moved to the buffer, back to front.
+static void merge_backward(struct arrays array, struct arrays buffer,
+    size_t first, size_t middle, size_t last, const struct layout *layout)
+{
+    const size_t width = layout->width;
+    size_t right      = last - middle;
+
+    copy(buffer, 0, array, middle, right, layout);
+
+    // Indices are one past the elements they refer to.
+    size_t i = middle, j = right, k = last;
+    while (i > first && j > 0) {
+        if (layout->comparator(
+                buffer.keys + (j - 1) * width, array.keys + (i - 1) * width)
+            < 0)
+            copy(array, --k, array, --i, 1, layout);
+        else
+            copy(array, --k, buffer, --j, 1, layout);
+    }
+
+    // Whatever is left of the left range is already in place.
+    copy(array, first, buffer, 0, j, layout);
+}
 
-    // Sort the left subarray.
-    msort(array, aux, first, middle, width, comparator);
+// Swaps the ranges [first, middle) and [middle, last), through the buffer if
+// the shorter one fits, by reversals otherwise. Returns the new position of
+// the element that was at `first`.
+static size_t rotate(struct arrays array, struct arrays buffer,
+    size_t buffer_nel, size_t first, size_t middle, size_t last,
+    const struct layout *layout)
+{
+    size_t left = middle - first, right = last - middle;
 
-    // Sort the right subarray.
-    msort(array, aux, middle + 1, last, width, comparator);
+    if (left == 0 || right == 0)
+        return first + right;
 
-    // Merge the two subarrays.
-    merge(array, aux, first, middle, last, width, comparator);
+    if (left <= right && left <= buffer_nel) {
+        copy(buffer, 0, array, first, left, layout);
+        copy(array, first, array, middle, right, layout);
+        copy(array, first + right, buffer, 0, left, layout);
+    } else if (right <= buffer_nel) {
+        copy(buffer, 0, array, middle, right, layout);
+        copy(array, first + right, array, first, left, layout);
+        copy(array, first, buffer, 0, right, layout);
+    } else {
+        reverse(array, buffer, first, middle, layout);
+        reverse(array, buffer, middle, last, layout);
+        reverse(array, buffer, first, last, layout);
+    }
+
+    return first + right;
 }
 
-static void merge(void *array, void *aux, int first, int middle, int last,
-    size_t width, int (*comparator)(const void *a, const void *b))
+// Reverses [first, last), using the first element of `temp` for swapping.
+static void reverse(struct arrays array, struct arrays temp, size_t first,
+    size_t last, const struct layout *layout)
 {
-    char *arr  = (char *)array;
-    char *temp = (char *)aux;
+    while (first + 1 < last) {
+        last--;
+        copy(temp, 0, array, first, 1, layout);
+        copy(array, first, array, last, 1, layout);
+        copy(array, last, temp, 0, 1, layout);
+        first++;
+    }
+}
 
-    // Copy elements into the auxiliary array.
-    for (int i = first; i <= last; i++)
-        memcpy(temp + i * width, arr + i * width, width);
+// Returns the first index in [first, last) whose element is not less than
+// `key`.
+static size_t lower_bound(struct arrays array, size_t first, size_t last,
+    const char *key, const struct layout *layout)
+{
+    while (first < last) {
+        size_t middle = first + (last - first) / 2;
+        if (layout->comparator(array.keys + middle * layout->width, key) < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first;
+}
 
-    // Merge the 2 subarrays.
-    int i = first;
-    int j = middle + 1;
-    int k = first;
-    while (i <= middle && j <= last) {
-        if (comparator(temp + i * width, temp + j * width) <= 0)
-            memcpy(arr + k++ * width, temp + i++ * width, width);
+// Returns the first index in [first, last) whose element is greater than
+// `key`.
+static size_t upper_bound(struct arrays array, size_t first, size_t last,
+    const char *key, const struct layout *layout)
+{
+    while (first < last) {
+        size_t middle = first + (last - first) / 2;
+        if (layout->comparator(key, array.keys + middle * layout->width) < 0)
+            last = middle;
         else
-            memcpy(arr + k++ * width, temp + j++ * width, width);
+            first = middle + 1;
     }
+    return first;
+}
 
-    // Copy over any remaining elements, if any.
-    while (i <= middle)
-        memcpy(arr + k++ * width, temp + i++ * width, width);
+// Copies [from, last) of src to dst, starting at index `to`, dropping every
+// element equal to the one before it. The ranges may overlap as long as `to`
+// is not after `from`. Returns the end of the output.
+static size_t unique_copy(struct arrays dst, size_t to, struct arrays src,
+    size_t from, size_t last, const struct layout *layout)
+{
+    const size_t width = layout->width;
 
-    while (j <= last)
-        memcpy(arr + k++ * width, temp + j++ * width, width);
+    if (from == last)
+        return to;
+
+    copy(dst, to++, src, from++, 1, layout);
+    for (; from < last; from++)
+        if (layout->comparator(
+                dst.keys + (to - 1) * width, src.keys + from * width)
+            != 0)
+            copy(dst, to++, src, from, 1, layout);
+
+    return to;
+}
+
+// Copies `count` elements, along with their payloads if any, from index
+// `from` of src to index `to` of dst.
+static void copy(struct arrays dst, size_t to, struct arrays src, size_t from,
+    size_t count, const struct layout *layout)
+{
+    STATS(stats.moves += count);
+
+    memmove(dst.keys + to * layout->width, src.keys + from * layout->width,
+        count * layout->width);
+    if (dst.payloads != NULL)
+        memmove(dst.payloads + to * layout->payload_width,
+            src.payloads + from * layout->payload_width,
+            count * layout->payload_width);
+}
+
+// Returns the arrays starting at `index`.
+static struct arrays offset(
+    struct arrays array, size_t index, const struct layout *layout)
+{
+    struct arrays result = { array.keys + index * layout->width,
+        array.payloads ? array.payloads + index * layout->payload_width
+                       : NULL };
+    return result;
+}
+
+static void swap(struct arrays *a, struct arrays *b)
+{
+    struct arrays temp = *a;
+    *a                 = *b;
+    *b                 = temp;
+}
+
+// Sorts a short segment of integer keys: by insertion sort if very short,
+// by a sorting network on SSE2 registers if the keys are 32 bits wide.
+template <class Key> static void small_sort_keys(char *array, size_t nel)
+{
+    Key *keys = (Key *)array;
+
+#ifdef __SSE2__
+    if (sizeof(Key) == sizeof(int32_t) && nel > 8) {
+        // Flipping the sign bit of unsigned keys maps them to signed order.
+        uint32_t bias = (Key)-1 > 0 ? 0x80000000u : 0;
+        if (nel <= 16)
+            network_sort<16>((int32_t *)keys, nel, bias);
+        else if (nel <= 32)
+            network_sort<32>((int32_t *)keys, nel, bias);
+        else
+            network_sort<64>((int32_t *)keys, nel, bias);
+        return;
+    }
+#endif
+
+    for (size_t i = 1; i < nel; i++) {
+        Key key  = keys[i];
+        size_t j = i;
+        for (; j > 0 && keys[j - 1] > key; j--)
+            keys[j] = keys[j - 1];
+        keys[j] = key;
+    }
+}
+
+template <class Key> static int key_comparator(const void *a, const void *b)
+{
+    Key x = *(const Key *)a, y = *(const Key *)b;
+    return (x > y) - (x < y);
+}
+
+#ifdef __SSE2__
+// Sorts nel <= SIZE keys with a bitonic sorting network, 4 keys per
+// register. The keys are padded to SIZE with the largest key, and `bias` is
+// xor-ed into every key on the way in and out. Compare-exchanges of keys 4 or
+// more apart work on whole registers; the ones of keys 1 or 2 apart compare a
+// register with a shuffle of itself, and keep the minimum or the maximum of
+// every lane according to a mask.
+template <size_t SIZE>
+static void network_sort(int32_t *keys, size_t nel, uint32_t bias)
+{
+    alignas(16) int32_t buffer[SIZE];
+    for (size_t i = 0; i < nel; i++)
+        buffer[i] = keys[i] ^ bias;
+    for (size_t i = nel; i < SIZE; i++)
+        buffer[i] = INT32_MAX;
+
+    __m128i *vectors       = (__m128i *)buffer;
+    const __m128i pairs_up = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i halves_up = _mm_set_epi32(0, 0, -1, -1);
+    const __m128i ones      = _mm_set1_epi32(-1);
+
+    // Keys are compared with the key `j` apart, in ascending order if bit `k`
+    // of their index is clear and descending order otherwise.
+    for (size_t k = 2; k <= SIZE; k *= 2) {
+        for (size_t j = k / 2; j >= 4; j /= 2) {
+            for (size_t a = 0; a < SIZE / 4; a++) {
+                if (a & (j / 4))
+                    continue;
+
+                __m128i x = vectors[a], y = vectors[a + j / 4];
+                __m128i greater = _mm_cmpgt_epi32(x, y);
+                __m128i low     = select(greater, y, x);
+                __m128i high    = select(greater, x, y);
+
+                bool ascending     = ((a * 4) & k) == 0;
+                vectors[a]         = ascending ? low : high;
+                vectors[a + j / 4] = ascending ? high : low;
+            }
+        }
+
+        for (size_t j = k < 4 ? k / 2 : 2; j >= 1; j /= 2) {
+            for (size_t a = 0; a < SIZE / 4; a++) {
+                __m128i x = vectors[a];
+                __m128i y = j == 2 ? _mm_shuffle_epi32(x, 0x4E)
+                                   : _mm_shuffle_epi32(x, 0xB1);
+
+                // Lanes that keep the minimum. On the first stage, the
+                // direction changes every 2 keys.
+                __m128i keep_low = j == 2 ? halves_up : pairs_up;
+                if (k == 2)
+                    keep_low = _mm_set_epi32(-1, 0, 0, -1);
+                else if ((a * 4) & k)
+                    keep_low = _mm_xor_si128(keep_low, ones);
+
+                __m128i greater = _mm_cmpgt_epi32(x, y);
+                vectors[a]      = select(keep_low, select(greater, y, x),
+                         select(greater, x, y));
+            }
+        }
+    }
+
+    for (size_t i = 0; i < nel; i++)
+        keys[i] = buffer[i] ^ bias;
+}
+
+// Picks the lanes of a where mask is set, and those of b elsewhere.
+static __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
 }
+#endif
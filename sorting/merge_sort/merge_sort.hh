@@ -1,9 +1,83 @@
+#include <cstdint>
 #include <cstdio>
 
+#include "sort_stats.hh"
+
 #ifndef MERGE_SORT_HH
 #define MERGE_SORT_HH
 
+// Flags to choose between the modes of merge sort.
+enum merge_sort_flags {
+    // Allocates an auxiliary array as large as the input.
+    MERGE_SORT_DEFAULT = 0,
+
+    // Allocates only about sqrt(nel) elements of scratch space and merges in
+    // place, trading some speed for half the peak memory. Still stable.
+    MERGE_SORT_LOW_MEMORY = 1 << 0,
+};
+
 void merge_sort(void *array, size_t nel, size_t width,
-    int (*comparator)(const void *a, const void *b));
+    int (*comparator)(const void *a, const void *b),
+    int flags = MERGE_SORT_DEFAULT);
+
+// Sorts `keys` with a stable merge sort, permuting `payloads` in lockstep, so
+// that the payload at index i still belongs to the key at index i afterwards.
+// Keys are `key_width` bytes wide and payloads `payload_width` bytes wide.
+// `payloads` may be NULL, in which case this is the same as merge_sort().
+void merge_sort_by_key(void *keys, void *payloads, size_t nel,
+    size_t key_width, size_t payload_width,
+    int (*comparator)(const void *a, const void *b),
+    int flags = MERGE_SORT_DEFAULT);
+
+// Sorts the array like merge_sort() and drops duplicates, keeping only the
+// first (in the original order) of every run of equal elements. Duplicates
+// are dropped during the final merge pass. Returns the number of elements
+// kept, which are at the start of the array.
+size_t merge_sort_unique(void *array, size_t nel, size_t width,
+    int (*comparator)(const void *a, const void *b),
+    int flags = MERGE_SORT_DEFAULT);
+
+// Same as merge_sort_unique(), permuting `payloads` in lockstep like
+// merge_sort_by_key(). The payloads of dropped keys are dropped too.
+size_t merge_sort_unique_by_key(void *keys, void *payloads, size_t nel,
+    size_t key_width, size_t payload_width,
+    int (*comparator)(const void *a, const void *b),
+    int flags = MERGE_SORT_DEFAULT);
+
+// Sorts every segment [offsets[i], offsets[i + 1]) of the array on its own,
+// for i in [0, segments), as if merge_sort() was called on each of them.
+// `offsets` holds segments + 1 ascending indices. Auxiliary arrays are
+// allocated once per call rather than once per segment, which is what
+// dominates the cost of sorting many short arrays.
+//
+// `threads` is the number of threads to spread the segments over, 0 picks
+// one based on the number of elements and the number of cores.
+void merge_sort_segments(void *array, const size_t *offsets, size_t segments,
+    size_t width, int (*comparator)(const void *a, const void *b),
+    unsigned threads = 0);
+
+// Same as merge_sort_segments(), permuting `payloads` in lockstep like
+// merge_sort_by_key().
+void merge_sort_segments_by_key(void *keys, void *payloads,
+    const size_t *offsets, size_t segments, size_t key_width,
+    size_t payload_width, int (*comparator)(const void *a, const void *b),
+    unsigned threads = 0);
+
+// Same as merge_sort_segments() for integer keys in ascending order. Short
+// segments are sorted without comparator calls, those of 32-bit keys by a
+// sorting network on SSE2 registers.
+void merge_sort_segments(int32_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads = 0);
+void merge_sort_segments(uint32_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads = 0);
+void merge_sort_segments(int64_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads = 0);
+void merge_sort_segments(uint64_t *keys, const size_t *offsets,
+    size_t segments, unsigned threads = 0);
+
+// Returns the statistics of the last call to merge_sort() made on this
+// thread. They are only collected when compiled with -DSORT_STATS, otherwise
+// every counter stays zero.
+const struct sort_stats *merge_sort_stats(void);
 
 #endif
@@ -0,0 +1,261 @@
+#include <cstring>
+
+#include "sorted_set.hh"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Above this ratio between the sizes of the inputs, galloping beats the
+// SIMD block intersection.
+#define GALLOP_RATIO 32
+
+// Orders elements either through a comparator or, for integer keys, with the
+// built-in operators. Both provide `less` and `equal` on indices into the
+// arrays they are given.
+struct generic_order {
+    size_t width;
+    int (*comparator)(const void *a, const void *b);
+
+    bool less(const char *a, size_t i, const char *b, size_t j) const
+    {
+        return comparator(a + i * width, b + j * width) < 0;
+    }
+
+    bool equal(const char *a, size_t i, const char *b, size_t j) const
+    {
+        return comparator(a + i * width, b + j * width) == 0;
+    }
+
+    void copy(char *result, size_t k, const char *a, size_t i, size_t n) const
+    {
+        memcpy(result + k * width, a + i * width, n * width);
+    }
+};
+
+template <class T> struct integer_order {
+    bool less(const T *a, size_t i, const T *b, size_t j) const
+    {
+        return a[i] < b[j];
+    }
+
+    bool equal(const T *a, size_t i, const T *b, size_t j) const
+    {
+        return a[i] == b[j];
+    }
+
+    void copy(T *result, size_t k, const T *a, size_t i, size_t n) const
+    {
+        memcpy(result + k, a + i, n * sizeof(T));
+    }
+};
+
+// Returns the first index in [first, last) of `array` whose element is not
+// less than key[index], probing first, first + 1, first + 3, first + 7, ...
+// before searching the last gap in binary. Costs about 2 * log2(distance)
+// comparisons, and a single one when the answer is `first`.
+template <class T, class Order>
+static size_t gallop(const T *array, size_t first, size_t last, const T *key,
+    size_t index, const Order &order)
+{
+    size_t step = 1, low = first, high = first;
+    while (high < last && order.less(array, high, key, index)) {
+        low = high + 1;
+        high += step;
+        step *= 2;
+    }
+    if (high > last)
+        high = last;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (order.less(array, middle, key, index))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+template <class T, class Order>
+static size_t set_union(const T *a, size_t a_nel, const T *b, size_t b_nel,
+    T *result, const Order &order)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_nel && j < b_nel) {
+        // Elements of a less than b[j].
+        size_t next = gallop(a, i, a_nel, b, j, order);
+        order.copy(result, k, a, i, next - i);
+        k += next - i;
+        if ((i = next) == a_nel)
+            break;
+
+        // Elements of b less than a[i].
+        next = gallop(b, j, b_nel, a, i, order);
+        order.copy(result, k, b, j, next - j);
+        k += next - j;
+        if ((j = next) == b_nel)
+            break;
+
+        // a[i] <= b[j] now, and only once is enough if they're equal.
+        if (order.equal(a, i, b, j)) {
+            order.copy(result, k++, a, i++, 1);
+            j++;
+        }
+    }
+
+    order.copy(result, k, a, i, a_nel - i);
+    k += a_nel - i;
+    order.copy(result, k, b, j, b_nel - j);
+    return k + b_nel - j;
+}
+
+template <class T, class Order>
+static size_t set_intersection(const T *a, size_t a_nel, const T *b,
+    size_t b_nel, T *result, const Order &order)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_nel && j < b_nel) {
+        if ((i = gallop(a, i, a_nel, b, j, order)) == a_nel)
+            break;
+        if ((j = gallop(b, j, b_nel, a, i, order)) == b_nel)
+            break;
+        if (order.equal(a, i, b, j)) {
+            order.copy(result, k++, a, i++, 1);
+            j++;
+        }
+    }
+    return k;
+}
+
+template <class T, class Order>
+static size_t set_difference(const T *a, size_t a_nel, const T *b,
+    size_t b_nel, T *result, const Order &order)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_nel && j < b_nel) {
+        size_t next = gallop(a, i, a_nel, b, j, order);
+        order.copy(result, k, a, i, next - i);
+        k += next - i;
+        if ((i = next) == a_nel)
+            break;
+
+        if ((j = gallop(b, j, b_nel, a, i, order)) == b_nel)
+            break;
+        if (order.equal(a, i, b, j)) {
+            i++;
+            j++;
+        }
+    }
+
+    order.copy(result, k, a, i, a_nel - i);
+    return k + a_nel - i;
+}
+
+#ifdef __SSE2__
+// Intersects blocks of 4 keys of a with blocks of 4 keys of b: every key of
+// the a block is compared against all 4 rotations of the b block, and the
+// block with the smaller last key is advanced (both on a tie). The remainder
+// is left to the scalar code.
+static size_t intersection_sse2(const uint32_t *a, size_t a_nel,
+    const uint32_t *b, size_t b_nel, uint32_t *result, size_t *i, size_t *j)
+{
+    size_t k = 0;
+    while (*i + 4 <= a_nel && *j + 4 <= b_nel) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + *i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + *j));
+
+        __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4E)),
+                _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+
+        // One bit per key of the a block, written in order.
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(match));
+        while (mask) {
+            result[k++] = a[*i + __builtin_ctz(mask)];
+            mask &= mask - 1;
+        }
+
+        uint32_t a_last = a[*i + 3], b_last = b[*j + 3];
+        if (a_last <= b_last)
+            *i += 4;
+        if (b_last <= a_last)
+            *j += 4;
+    }
+    return k;
+}
+#endif
+
+size_t sorted_union(const void *a, size_t a_nel, const void *b, size_t b_nel,
+    void *result, size_t width,
+    int (*comparator)(const void *a, const void *b))
+{
+    return set_union((const char *)a, a_nel, (const char *)b, b_nel,
+        (char *)result, generic_order { width, comparator });
+}
+
+size_t sorted_intersection(const void *a, size_t a_nel, const void *b,
+    size_t b_nel, void *result, size_t width,
+    int (*comparator)(const void *a, const void *b))
+{
+    return set_intersection((const char *)a, a_nel, (const char *)b, b_nel,
+        (char *)result, generic_order { width, comparator });
+}
+
+size_t sorted_difference(const void *a, size_t a_nel, const void *b,
+    size_t b_nel, void *result, size_t width,
+    int (*comparator)(const void *a, const void *b))
+{
+    return set_difference((const char *)a, a_nel, (const char *)b, b_nel,
+        (char *)result, generic_order { width, comparator });
+}
+
+size_t sorted_union(const uint32_t *a, size_t a_nel, const uint32_t *b,
+    size_t b_nel, uint32_t *result)
+{
+    return set_union(a, a_nel, b, b_nel, result, integer_order<uint32_t>());
+}
+
+size_t sorted_union(const uint64_t *a, size_t a_nel, const uint64_t *b,
+    size_t b_nel, uint64_t *result)
+{
+    return set_union(a, a_nel, b, b_nel, result, integer_order<uint64_t>());
+}
+
+size_t sorted_intersection(const uint32_t *a, size_t a_nel, const uint32_t *b,
+    size_t b_nel, uint32_t *result)
+{
+    size_t i = 0, j = 0, k = 0;
+
+#ifdef __SSE2__
+    if (a_nel < b_nel * GALLOP_RATIO && b_nel < a_nel * GALLOP_RATIO)
+        k = intersection_sse2(a, a_nel, b, b_nel, result, &i, &j);
+#endif
+
+    return k
+        + set_intersection(a + i, a_nel - i, b + j, b_nel - j, result + k,
+            integer_order<uint32_t>());
+}
+
+size_t sorted_intersection(const uint64_t *a, size_t a_nel, const uint64_t *b,
+    size_t b_nel, uint64_t *result)
+{
+    return set_intersection(
+        a, a_nel, b, b_nel, result, integer_order<uint64_t>());
+}
+
+size_t sorted_difference(const uint32_t *a, size_t a_nel, const uint32_t *b,
+    size_t b_nel, uint32_t *result)
+{
+    return set_difference(
+        a, a_nel, b, b_nel, result, integer_order<uint32_t>());
+}
+
+size_t sorted_difference(const uint64_t *a, size_t a_nel, const uint64_t *b,
+    size_t b_nel, uint64_t *result)
+{
+    return set_difference(
+        a, a_nel, b, b_nel, result, integer_order<uint64_t>());
+}
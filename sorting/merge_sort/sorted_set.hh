@@ -0,0 +1,52 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef SORTED_SET_HH
+#define SORTED_SET_HH
+
+/**
+ * Set operations on sorted arrays without duplicates, such as the ones
+ * merge_sort_unique() produces. Every operation writes its result, which is
+ * sorted and without duplicates as well, to `result` and returns the number
+ * of elements written. `result` must have room for a_nel + b_nel elements
+ * (union), min(a_nel, b_nel) (intersection) or a_nel (difference), and must
+ * not overlap the inputs.
+ *
+ * Runs of elements that belong to only one of the inputs are skipped (or
+ * copied in bulk) after an exponential search, so the cost depends on the
+ * number of such runs rather than on the size of the larger input when the
+ * sizes are very different.
+ */
+
+// Elements in a, b or both.
+size_t sorted_union(const void *a, size_t a_nel, const void *b, size_t b_nel,
+    void *result, size_t width,
+    int (*comparator)(const void *a, const void *b));
+
+// Elements in both a and b.
+size_t sorted_intersection(const void *a, size_t a_nel, const void *b,
+    size_t b_nel, void *result, size_t width,
+    int (*comparator)(const void *a, const void *b));
+
+// Elements in a but not in b.
+size_t sorted_difference(const void *a, size_t a_nel, const void *b,
+    size_t b_nel, void *result, size_t width,
+    int (*comparator)(const void *a, const void *b));
+
+// Same operations for integer keys, without the comparator calls. The
+// intersection of 32-bit keys compares blocks of 4 keys against 4 keys at
+// once with SSE2 when the inputs are of similar sizes.
+size_t sorted_union(const uint32_t *a, size_t a_nel, const uint32_t *b,
+    size_t b_nel, uint32_t *result);
+size_t sorted_union(const uint64_t *a, size_t a_nel, const uint64_t *b,
+    size_t b_nel, uint64_t *result);
+size_t sorted_intersection(const uint32_t *a, size_t a_nel, const uint32_t *b,
+    size_t b_nel, uint32_t *result);
+size_t sorted_intersection(const uint64_t *a, size_t a_nel, const uint64_t *b,
+    size_t b_nel, uint64_t *result);
+size_t sorted_difference(const uint32_t *a, size_t a_nel, const uint32_t *b,
+    size_t b_nel, uint32_t *result);
+size_t sorted_difference(const uint64_t *a, size_t a_nel, const uint64_t *b,
+    size_t b_nel, uint64_t *result);
+
+#endif
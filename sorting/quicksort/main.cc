@@ -4,6 +4,7 @@
 #include <cstring>
 #include <ctime>
 
+#include "multiway_partition.hh"
 #include "pivots.hh"
 #include "quicksort.hh"
 #include "randomize_array.hh"
@@ -29,6 +30,12 @@ void test_strings(int (*choose_pivot)(
     const void *, size_t, size_t, int (*)(const void *, const void *)));
 void test_structures(int (*choose_pivot)(
     const void *, size_t, size_t, int (*)(const void *, const void *)));
+void test_by_key(int (*choose_pivot)(
+    const void *, size_t, size_t, int (*)(const void *, const void *)));
+void test_large(int (*choose_pivot)(
+    const void *, size_t, size_t, int (*)(const void *, const void *)));
+void test_multiway_partition(unsigned threads, size_t width);
+void test_stats(void);
 
 // Test whether an array is sorted according to the comparator
 // provided.
@@ -68,6 +75,25 @@ void test_all(void)
     for (int i = 0; i < SIZE; i++)
         test_structures(choose_pivot[i]);
     printf("Structure array tests passed with all ways of choosing a pivot\n");
+
+    for (int i = 0; i < SIZE; i++)
+        test_by_key(choose_pivot[i]);
+    printf("Key/payload tests passed with all ways of choosing a pivot\n");
+
+    // Below the parallel partitions, the first and last element pivots are
+    // quadratic on the runs of duplicates.
+    for (int i = 2; i < SIZE; i++)
+        test_large(choose_pivot[i]);
+    printf("Parallel partition tests passed\n");
+
+    const unsigned THREADS[] = { 0, 1, 3 };
+    for (unsigned threads : THREADS) {
+        test_multiway_partition(threads, sizeof(int));
+        test_multiway_partition(threads, 200);
+    }
+    printf("Multiway partition tests passed with any number of threads\n");
+
+    test_stats();
 }
 
 void test_integers(int (*choose_pivot)(
@@ -124,7 +150,7 @@ void test_strings(int (*choose_pivot)(
     }
 
     // Randomize the strings before sorting.
-    randomize_array(array, SIZE, sizeof(char *));
+    randomize_array(array, SIZE);
 
     // Sort and test.
     quicksort(array, SIZE, sizeof(char *), string_comparator, choose_pivot);
@@ -163,6 +189,143 @@ void test_structures(int (*choose_pivot)(
     free(array);
 }
 
+void test_by_key(int (*choose_pivot)(
+    const void *, size_t, size_t, int (*)(const void *, const void *)))
+{
+    // Setup.
+    const int SIZE   = 1000;
+    const int LENGTH = 8;
+    int *keys        = (int *)malloc(SIZE * sizeof(int));
+    char *payloads   = (char *)malloc(SIZE * LENGTH * sizeof(char));
+    for (int i = 0; i < SIZE; i++) {
+        keys[i] = rand() % SIZE;
+        snprintf(payloads + i * LENGTH, LENGTH, "%i", keys[i]);
+    }
+
+    // Sort and test.
+    quicksort_by_key(keys, payloads, SIZE, sizeof(int), LENGTH,
+        integer_comparator, choose_pivot);
+    test_array_is_sorted(keys, SIZE, sizeof(int), integer_comparator);
+
+    // Every payload must still belong to its key.
+    for (int i = 0; i < SIZE; i++)
+        assert(atoi(payloads + i * LENGTH) == keys[i]);
+
+    // Cleanup.
+    free(keys);
+    free(payloads);
+}
+
+void test_large(int (*choose_pivot)(
+    const void *, size_t, size_t, int (*)(const void *, const void *)))
+{
+    // Setup. Large enough for parallel partitions, and with few distinct
+    // keys, which end up equal to the pivot.
+    const int SIZE = 300000;
+    int *keys      = (int *)malloc(SIZE * sizeof(int));
+    int *payloads  = (int *)malloc(SIZE * sizeof(int));
+    for (int i = 0; i < SIZE; i++)
+        keys[i] = payloads[i] = rand() % 100;
+
+    // Sort and test.
+    quicksort_by_key(keys, payloads, SIZE, sizeof(int), sizeof(int),
+        integer_comparator, choose_pivot);
+    test_array_is_sorted(keys, SIZE, sizeof(int), integer_comparator);
+    assert(memcmp(keys, payloads, SIZE * sizeof(int)) == 0);
+
+    // Cleanup.
+    free(keys);
+    free(payloads);
+}
+
+// Classifies integers by their value modulo the number of buckets.
+static size_t modulo_classifier(const void *element, void *context)
+{
+    return *(const unsigned *)element % *(const size_t *)context;
+}
+
+void test_multiway_partition(unsigned threads, size_t width)
+{
+    // Setup. Elements of `width` bytes starting with a key, and the original
+    // index as the payload.
+    const size_t SIZE     = 100000;
+    const size_t BUCKETS  = 37;
+    char *src             = (char *)calloc(SIZE, width);
+    char *dst             = (char *)malloc(SIZE * width);
+    size_t *indices       = (size_t *)malloc(SIZE * sizeof(size_t));
+    size_t *dst_indices   = (size_t *)malloc(SIZE * sizeof(size_t));
+    for (size_t i = 0; i < SIZE; i++) {
+        unsigned key = rand();
+        memcpy(src + i * width, &key, sizeof(key));
+        indices[i] = i;
+    }
+
+    // Partition and test.
+    size_t buckets = BUCKETS, bounds[BUCKETS + 1];
+    multiway_partition(src, dst, indices, dst_indices, SIZE, width,
+        sizeof(size_t), BUCKETS, modulo_classifier, &buckets, bounds, threads);
+    assert(bounds[0] == 0 && bounds[BUCKETS] == SIZE);
+
+    // Every element must be in its bucket, along with its payload, and keep
+    // the order of its bucket.
+    for (size_t b = 0; b < BUCKETS; b++) {
+        for (size_t i = bounds[b]; i < bounds[b + 1]; i++) {
+            assert(modulo_classifier(dst + i * width, &buckets) == b);
+            assert(memcmp(dst + i * width, src + dst_indices[i] * width, width)
+                == 0);
+            if (i > bounds[b])
+                assert(dst_indices[i - 1] < dst_indices[i]);
+        }
+    }
+
+    // Cleanup.
+    free(src);
+    free(dst);
+    free(indices);
+    free(dst_indices);
+}
+
+void test_stats(void)
+{
+#ifdef SORT_STATS
+    // Setup.
+    const int SIZE = 100;
+    int *array     = (int *)malloc(SIZE * sizeof(int));
+    for (int i = 0; i < SIZE; i++)
+        array[i] = i;
+
+    // Choosing the first element of a sorted array as the pivot leaves one
+    // side of every partition empty.
+    quicksort(array, SIZE, sizeof(int), integer_comparator,
+        choose_first_element_as_pivot);
+    const struct sort_stats *stats = quicksort_stats();
+    assert(stats->comparisons == SIZE * (SIZE - 1) / 2);
+    assert(stats->max_depth == SIZE - 1);
+    assert(stats->depth == 0);
+    assert(stats->partitions == SIZE - 1);
+    assert(stats->imbalance[0] == SIZE - 1);
+
+    // Statistics are reset on every call.
+    randomize_array(array, SIZE, sizeof(int));
+    quicksort(array, SIZE, sizeof(int), integer_comparator,
+        choose_median_as_pivot);
+    test_array_is_sorted(array, SIZE, sizeof(int), integer_comparator);
+    assert(stats->comparisons < SIZE * (SIZE - 1) / 2);
+    assert(stats->max_depth < SIZE - 1);
+    assert(stats->moves > 0);
+
+    unsigned long long partitions = 0;
+    for (int i = 0; i < SORT_STATS_BUCKETS; i++)
+        partitions += stats->imbalance[i];
+    assert(partitions == stats->partitions);
+
+    // Cleanup.
+    free(array);
+
+    printf("Statistics tests passed\n");
+#endif
+}
+
 // For testing whether an array is sorted.
 void test_array_is_sorted(const void *array, size_t nel, size_t width,
     int (*comparator)(const void *, const void *))
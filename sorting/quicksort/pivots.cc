@@ -2,6 +2,7 @@
 #include <cstdlib>
 
 #include "pivots.hh"
+#include "rng.hh"
 
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
@@ -50,5 +51,5 @@ int choose_median_as_pivot(const void *array, size_t nel, size_t width,
 int choose_random_pivot(
     const void *, size_t nel, size_t, int (*)(const void *, const void *))
 {
-    return rand() % nel;
+    return rng_bounded(rng_thread(), nel);
 }
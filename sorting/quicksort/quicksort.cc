@@ -1,8 +1,15 @@
 #include <cstdlib>
 #include <cstring>
+#include <thread>
 
+#include "multiway_partition.hh"
 #include "quicksort.hh"
 
+// Arrays at least this long are partitioned out of place, in parallel, into
+// the elements less than, equal to and greater than the pivot. On a single
+// core, that only costs an extra array and a copy, so it is skipped.
+#define PARALLEL_PARTITION (1 << 16)
+
 #define SWAP(a, b, aux, width)                                                \
     do {                                                                      \
         char *__a  = a;                                                       \
@@ -11,33 +18,187 @@
         memcpy(temp, __a, width);                                             \
         memcpy(__a, __b, width);                                              \
         memcpy(__b, temp, width);                                             \
+        STATS(stats.moves += 3);                                              \
     } while (0);
 
-static void qsort(void *array, void *aux, size_t nel, size_t width,
+#ifdef SORT_STATS
+// Statistics of the current (or last) call on this thread.
+static thread_local struct sort_stats stats;
+
+// The caller's comparator, wrapped so that every call is counted, including
+// the ones made while choosing a pivot.
+static thread_local int (*user_comparator)(const void *, const void *);
+
+static int counting_comparator(const void *a, const void *b)
+{
+    stats.comparisons++;
+    return user_comparator(a, b);
+}
+#endif
+
+// Comparator and pivot of a three-way partition.
+struct three_way {
+    int (*comparator)(const void *, const void *);
+    const void *pivot;
+};
+
+static void partition_sort(char *arr, char *pay, char *scratch,
+    char *scratch_payloads, bool in_scratch, void *aux, size_t nel,
+    size_t width, size_t payload_width,
+    int (*comparator)(const void *, const void *),
+    int (*choose_pivot)(
+        const void *, size_t, size_t, int (*)(const void *, const void *)));
+
+static size_t classify(const void *element, void *context);
+
+static void qsort(void *array, void *payloads, void *aux, size_t nel,
+    size_t width, size_t payload_width,
     int (*comparator)(const void *, const void *),
     int (*choose_pivot)(
         const void *, size_t, size_t, int (*)(const void *, const void *)));
 
-static int partition(void *array, void *aux, size_t nel, size_t width,
+static int partition(void *array, void *payloads, void *aux, size_t nel,
+    size_t width, size_t payload_width,
     int (*comparator)(const void *, const void *));
 
+static void swap(char *arr, char *payloads, void *aux, size_t i, size_t j,
+    size_t width, size_t payload_width);
+
 void quicksort(void *array, size_t nel, size_t width,
     int (*comparator)(const void *, const void *),
     int (*choose_pivot)(
         const void *, size_t, size_t, int (*)(const void *, const void *)))
+{
+    quicksort_by_key(array, NULL, nel, width, 0, comparator, choose_pivot);
+}
+
+void quicksort_by_key(void *keys, void *payloads, size_t nel, size_t key_width,
+    size_t payload_width, int (*comparator)(const void *, const void *),
+    int (*choose_pivot)(
+        const void *, size_t, size_t, int (*)(const void *, const void *)))
 {
     // Create an auxiliary space once, in order to save repetitive malloc calls
-    // made during swapping.
-    void *aux = (void *)malloc(width);
+    // made during swapping. It is shared by keys and payloads.
+    void *aux = (void *)malloc(
+        key_width > payload_width ? key_width : payload_width);
+
+#ifdef SORT_STATS
+    stats           = sort_stats();
+    user_comparator = comparator;
+    comparator      = counting_comparator;
+#endif
+
+    // Large arrays need scratch arrays to partition into at the top levels.
+    char *scratch = NULL, *scratch_payloads = NULL;
+    if (nel >= PARALLEL_PARTITION && std::thread::hardware_concurrency() > 1) {
+        scratch = (char *)malloc(nel * key_width);
+        if (payloads != NULL)
+            scratch_payloads = (char *)malloc(nel * payload_width);
+    }
 
     // Sort the array.
-    qsort(array, aux, nel, width, comparator, choose_pivot);
+    partition_sort((char *)keys, (char *)payloads, scratch, scratch_payloads,
+        false, aux, nel, key_width, payload_width, comparator, choose_pivot);
 
     // Housekeeping.
     free(aux);
+    free(scratch);
+    free(scratch_payloads);
+}
+
+const struct sort_stats *quicksort_stats(void)
+{
+#ifdef SORT_STATS
+    return &stats;
+#else
+    static const struct sort_stats none = sort_stats();
+    return &none;
+#endif
 }
 
-static void qsort(void *array, void *aux, size_t nel, size_t width,
+// Sorts arrays of at least PARALLEL_PARTITION elements by partitioning them
+// three ways with multiway_partition(). The partition goes from the array to
+// the same range of the scratch arrays, or back, and `in_scratch` tells
+// which one holds the elements on entry. Elements are only copied back to
+// the array when they are done: the ones equal to the pivot right away, the
+// others once their range is small enough for qsort(). Without scratch
+// arrays, everything is left to qsort().
+static void partition_sort(char *arr, char *pay, char *scratch,
+    char *scratch_payloads, bool in_scratch, void *aux, size_t nel,
+    size_t width, size_t payload_width,
+    int (*comparator)(const void *, const void *),
+    int (*choose_pivot)(
+        const void *, size_t, size_t, int (*)(const void *, const void *)))
+{
+    if (nel < PARALLEL_PARTITION || scratch == NULL) {
+        if (in_scratch) {
+            memcpy(arr, scratch, nel * width);
+            if (pay != NULL)
+                memcpy(pay, scratch_payloads, nel * payload_width);
+            STATS(stats.moves += nel);
+        }
+        qsort(arr, pay, aux, nel, width, payload_width, comparator,
+            choose_pivot);
+        return;
+    }
+
+    STATS(sort_stats_enter(&stats));
+
+    char *src = in_scratch ? scratch : arr, *dst = in_scratch ? arr : scratch;
+    char *src_payloads = in_scratch ? scratch_payloads : pay;
+    char *dst_payloads = in_scratch ? pay : scratch_payloads;
+
+    int pivot_index = choose_pivot(src, nel, width, comparator);
+    struct three_way three_way = { comparator, src + pivot_index * width };
+
+#ifdef SORT_STATS
+    // The worker threads have no caller's comparator to count the calls of,
+    // so they call it directly. Every element is compared once.
+    three_way.comparator = user_comparator;
+    stats.comparisons += nel;
+    stats.moves += nel;
+#endif
+
+    size_t bounds[4];
+    multiway_partition(src, dst, src_payloads, dst_payloads, nel, width,
+        payload_width, 3, classify, &three_way, bounds);
+    STATS(sort_stats_partition(&stats, bounds[1], nel - bounds[2]));
+
+    // The elements equal to the pivot are in their final place.
+    if (!in_scratch) {
+        memcpy(arr + bounds[1] * width, scratch + bounds[1] * width,
+            (bounds[2] - bounds[1]) * width);
+        if (pay != NULL)
+            memcpy(pay + bounds[1] * payload_width,
+                scratch_payloads + bounds[1] * payload_width,
+                (bounds[2] - bounds[1]) * payload_width);
+        STATS(stats.moves += bounds[2] - bounds[1]);
+    }
+
+    // Sort the elements less than and greater than the pivot.
+    partition_sort(arr, pay, scratch, scratch_payloads, !in_scratch, aux,
+        bounds[1], width, payload_width, comparator, choose_pivot);
+    partition_sort(arr + bounds[2] * width,
+        pay ? pay + bounds[2] * payload_width : NULL,
+        scratch + bounds[2] * width,
+        pay ? scratch_payloads + bounds[2] * payload_width : NULL, !in_scratch,
+        aux, nel - bounds[2], width, payload_width, comparator, choose_pivot);
+
+    STATS(sort_stats_leave(&stats));
+}
+
+// Classifies an element as less than (0), equal to (1) or greater than (2)
+// the pivot.
+static size_t classify(const void *element, void *context)
+{
+    const struct three_way *three_way = (const struct three_way *)context;
+
+    int order = three_way->comparator(element, three_way->pivot);
+    return order < 0 ? 0 : order == 0 ? 1 : 2;
+}
+
+static void qsort(void *array, void *payloads, void *aux, size_t nel,
+    size_t width, size_t payload_width,
     int (*comparator)(const void *, const void *),
     int (*choose_pivot)(
         const void *, size_t, size_t, int (*)(const void *, const void *)))
@@ -47,35 +208,56 @@ static void qsort(void *array, void *aux, size_t nel, size_t width,
         return;
 
     char *arr = (char *)array;
+    char *pay = (char *)payloads;
+
+    STATS(sort_stats_enter(&stats));
 
     // Choose a pivot by using the method specified.
     int pivot_index = choose_pivot(arr, nel, width, comparator);
 
     // Swap the first element with the pivot element.
-    SWAP(arr, arr + pivot_index * width, aux, width);
+    swap(arr, pay, aux, 0, pivot_index, width, payload_width);
 
     // Partition the array around the pivot.
-    int wall_index = partition(arr, aux, nel, width, comparator);
+    int wall_index
+        = partition(arr, pay, aux, nel, width, payload_width, comparator);
+    STATS(sort_stats_partition(&stats, wall_index, nel - wall_index - 1));
 
     // Sort the left and right subarrays.
-    qsort(arr, aux, wall_index, width, comparator, choose_pivot);
-    qsort(arr + (wall_index + 1) * width, aux, nel - wall_index - 1, width,
-        comparator, choose_pivot);
+    qsort(arr, pay, aux, wall_index, width, payload_width, comparator,
+        choose_pivot);
+    qsort(arr + (wall_index + 1) * width,
+        pay ? pay + (wall_index + 1) * payload_width : NULL, aux,
+        nel - wall_index - 1, width, payload_width, comparator, choose_pivot);
+
+    STATS(sort_stats_leave(&stats));
 }
 
-static int partition(void *array, void *aux, size_t nel, size_t width,
+static int partition(void *array, void *payloads, void *aux, size_t nel,
+    size_t width, size_t payload_width,
     int (*comparator)(const void *, const void *))
 {
     char *arr = (char *)array;
+    char *pay = (char *)payloads;
 
     // Partition the array around the pivot (first element).
     int wall_index = 0;
     for (size_t i = wall_index + 1, last = nel - 1; i <= last; i++)
         if (comparator(arr + i * width, arr) < 0)
-            SWAP(arr + ++wall_index * width, arr + i * width, aux, width);
+            swap(arr, pay, aux, ++wall_index, i, width, payload_width);
 
     // Swap the element at the wall with the pivot.
-    SWAP(arr, arr + wall_index * width, aux, width);
+    swap(arr, pay, aux, 0, wall_index, width, payload_width);
 
     return wall_index;
 }
+
+// Swaps the elements at indices i and j, along with their payloads, if any.
+static void swap(char *arr, char *payloads, void *aux, size_t i, size_t j,
+    size_t width, size_t payload_width)
+{
+    SWAP(arr + i * width, arr + j * width, aux, width);
+    if (payloads != NULL)
+        SWAP(payloads + i * payload_width, payloads + j * payload_width, aux,
+            payload_width);
+}
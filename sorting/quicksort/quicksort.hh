@@ -1,5 +1,7 @@
 #include <cstddef>
 
+#include "sort_stats.hh"
+
 #ifndef QUICKSORT_HH
 #define QUICKSORT_HH
 
@@ -8,4 +10,18 @@ void quicksort(void *array, size_t nel, size_t width,
     int (*choose_pivot)(
         const void *, size_t, size_t, int (*)(const void *, const void *)));
 
+// Sorts `keys` with quicksort, permuting `payloads` in lockstep, so that the
+// payload at index i still belongs to the key at index i afterwards. Keys are
+// `key_width` bytes wide and payloads `payload_width` bytes wide. `payloads`
+// may be NULL, in which case this is the same as quicksort().
+void quicksort_by_key(void *keys, void *payloads, size_t nel, size_t key_width,
+    size_t payload_width, int (*comparator)(const void *, const void *),
+    int (*choose_pivot)(
+        const void *, size_t, size_t, int (*)(const void *, const void *)));
+
+// Returns the statistics of the last call to quicksort() made on this thread.
+// They are only collected when compiled with -DSORT_STATS, otherwise every
+// counter stays zero.
+const struct sort_stats *quicksort_stats(void);
+
 #endif
@@ -1,28 +1,61 @@
-#include <cstdlib>
 #include <cstring>
 
 #include "randomize_array.hh"
 
-#define SWAP(a, b, width)                                                     \
-    do {                                                                      \
-        char *__a  = a;                                                       \
-        char *__b  = b;                                                       \
-        char *temp = (char *)malloc(width);                                   \
-        memcpy(temp, __a, width);                                             \
-        memcpy(__a, __b, width);                                              \
-        memcpy(__b, temp, width);                                             \
-        free(temp);                                                           \
-    } while (0);
-
-/**
- * NOTE: rand() must be seeded in the program that uses this function.
- */
+// Elements wider than this are swapped through a stack buffer this size, a
+// chunk at a time, so that no swap ever allocates.
+static const size_t SCRATCH_SIZE = 256;
+
+// Fisher-Yates shuffle of elements `width` bytes wide, a constant which lets
+// the compiler swap them with plain loads and stores.
+template <size_t width>
+static void shuffle(struct rng *rng, char *arr, size_t nel)
+{
+    char a[width], b[width];
+
+    for (; nel > 1; nel--) {
+        char *x = arr + rng_bounded(rng, nel) * width;
+        char *y = arr + (nel - 1) * width;
+        memcpy(a, x, width);
+        memcpy(b, y, width);
+        memcpy(x, b, width);
+        memcpy(y, a, width);
+    }
+}
+
+static void swap(char *a, char *b, size_t width)
+{
+    char temp[SCRATCH_SIZE];
+
+    for (size_t n; width; a += n, b += n, width -= n) {
+        n = width < SCRATCH_SIZE ? width : SCRATCH_SIZE;
+        memcpy(temp, a, n);
+        memcpy(a, b, n);
+        memcpy(b, temp, n);
+    }
+}
+
 void randomize_array(void *array, size_t nel, size_t width)
+{
+    randomize_array_with(rng_thread(), array, nel, width);
+}
+
+void randomize_array_with(
+    struct rng *rng, void *array, size_t nel, size_t width)
 {
     char *arr = (char *)array;
 
-    do {
-        int i = rand() % nel--;
-        SWAP(arr + i * width, arr + nel * width, width);
-    } while (nel);
+    switch (width) {
+    case 1: shuffle<1>(rng, arr, nel); return;
+    case 2: shuffle<2>(rng, arr, nel); return;
+    case 4: shuffle<4>(rng, arr, nel); return;
+    case 8: shuffle<8>(rng, arr, nel); return;
+    case 16: shuffle<16>(rng, arr, nel); return;
+    }
+
+    for (; nel > 1; nel--) {
+        size_t i = rng_bounded(rng, nel);
+        if (i != nel - 1)
+            swap(arr + i * width, arr + (nel - 1) * width, width);
+    }
 }
@@ -1,8 +1,31 @@
 #include <cstddef>
+#include <utility>
+
+#include "rng.hh"
 
 #ifndef RANDOMIZE_ARRAY_H
 #define RANDOMIZE_ARRAY_H
 
+// Shuffles `nel` elements of `width` bytes each in place, without allocating,
+// drawing from the generator of the calling thread.
 void randomize_array(void *array, size_t nel, size_t width);
 
+// The same, drawing from `rng`, for shuffles reproducible from its seed.
+void randomize_array_with(
+    struct rng *rng, void *array, size_t nel, size_t width);
+
+// The same shuffles for arrays of a known type, which swap elements with
+// std::swap() and so also suit types that aren't trivially copyable.
+template <typename T>
+void randomize_array_with(struct rng *rng, T *array, size_t nel)
+{
+    for (; nel > 1; nel--)
+        std::swap(array[rng_bounded(rng, nel)], array[nel - 1]);
+}
+
+template <typename T> void randomize_array(T *array, size_t nel)
+{
+    randomize_array_with(rng_thread(), array, nel);
+}
+
 #endif
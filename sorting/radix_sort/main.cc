@@ -0,0 +1,180 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "radix_sort.hh"
+
+using namespace std;
+
+// Test prototypes.
+void test_all(void);
+void test_unsigned(unsigned threads);
+void test_signed(unsigned threads);
+void test_by_key(unsigned threads);
+void test_edge_cases(void);
+
+// Returns a random 64-bit integer.
+uint64_t random64(void);
+
+int main(void)
+{
+    test_all();
+    printf("All tests passed!\n");
+    return 0;
+}
+
+void test_all(void)
+{
+    // Seed for generating random numbers.
+    srand(time(NULL));
+
+    // 0 lets the sort pick the number of threads.
+    const unsigned THREADS[] = { 0, 1, 2, 3, 8 };
+
+    for (unsigned threads : THREADS)
+        test_unsigned(threads);
+    printf("Unsigned integer tests passed with any number of threads\n");
+
+    for (unsigned threads : THREADS)
+        test_signed(threads);
+    printf("Signed integer tests passed with any number of threads\n");
+
+    for (unsigned threads : THREADS)
+        test_by_key(threads);
+    printf("Key/payload tests passed with any number of threads\n");
+
+    test_edge_cases();
+    printf("Edge case tests passed\n");
+}
+
+void test_unsigned(unsigned threads)
+{
+    // Setup.
+    const int SIZE    = 100000;
+    uint32_t *array32 = (uint32_t *)malloc(SIZE * sizeof(uint32_t));
+    uint64_t *array64 = (uint64_t *)malloc(SIZE * sizeof(uint64_t));
+    for (int i = 0; i < SIZE; i++)
+        array32[i] = array64[i] = random64();
+
+    // Sort and test.
+    radix_sort(array32, SIZE, threads);
+    radix_sort(array64, SIZE, threads);
+    for (int i = 1; i < SIZE; i++) {
+        assert(array32[i - 1] <= array32[i]);
+        assert(array64[i - 1] <= array64[i]);
+    }
+
+    // Cleanup.
+    free(array32);
+    free(array64);
+}
+
+void test_signed(unsigned threads)
+{
+    // Setup.
+    const int SIZE   = 100000;
+    int32_t *array32 = (int32_t *)malloc(SIZE * sizeof(int32_t));
+    int64_t *array64 = (int64_t *)malloc(SIZE * sizeof(int64_t));
+    for (int i = 0; i < SIZE; i++)
+        array32[i] = array64[i] = (int64_t)random64();
+
+    // Sort and test.
+    radix_sort(array32, SIZE, threads);
+    radix_sort(array64, SIZE, threads);
+    for (int i = 1; i < SIZE; i++) {
+        assert(array32[i - 1] <= array32[i]);
+        assert(array64[i - 1] <= array64[i]);
+    }
+    assert(array32[0] < 0 && array32[SIZE - 1] > 0);
+
+    // Cleanup.
+    free(array32);
+    free(array64);
+}
+
+typedef struct payload {
+    size_t index;
+    char padding[20];
+} Payload;
+
+void test_by_key(unsigned threads)
+{
+    // Setup. Few distinct keys, and the original index as the payload.
+    const int SIZE     = 100000;
+    uint64_t *keys     = (uint64_t *)malloc(SIZE * sizeof(uint64_t));
+    uint64_t *original = (uint64_t *)malloc(SIZE * sizeof(uint64_t));
+    Payload *payloads  = (Payload *)malloc(SIZE * sizeof(Payload));
+    for (int i = 0; i < SIZE; i++) {
+        original[i] = keys[i] = (random64() % 100) << 40;
+        payloads[i].index     = i;
+    }
+
+    // Sort and test.
+    radix_sort_by_key(keys, payloads, SIZE, sizeof(Payload), threads);
+    for (int i = 0; i < SIZE; i++) {
+        // Every payload must still belong to its key.
+        assert(original[payloads[i].index] == keys[i]);
+
+        // Equal keys must keep their original order.
+        if (i > 0) {
+            assert(keys[i - 1] <= keys[i]);
+            if (keys[i - 1] == keys[i])
+                assert(payloads[i - 1].index < payloads[i].index);
+        }
+    }
+
+    // Same with signed 32-bit keys.
+    int32_t *keys32 = (int32_t *)malloc(SIZE * sizeof(int32_t));
+    for (int i = 0; i < SIZE; i++) {
+        keys32[i]         = (int32_t)(original[i] >> 40) - 50;
+        payloads[i].index = i;
+    }
+    radix_sort_by_key(keys32, payloads, SIZE, sizeof(Payload), threads);
+    for (int i = 0; i < SIZE; i++) {
+        assert((int32_t)(original[payloads[i].index] >> 40) - 50 == keys32[i]);
+        if (i > 0 && keys32[i - 1] == keys32[i])
+            assert(payloads[i - 1].index < payloads[i].index);
+    }
+
+    // Cleanup.
+    free(keys);
+    free(keys32);
+    free(original);
+    free(payloads);
+}
+
+void test_edge_cases(void)
+{
+    // Empty and single element arrays.
+    uint32_t one = 42;
+    radix_sort(&one, 0);
+    radix_sort(&one, 1);
+    assert(one == 42);
+
+    // All keys equal, every pass is skipped.
+    const int SIZE = 1000;
+    uint64_t equal[SIZE];
+    int indices[SIZE];
+    for (int i = 0; i < SIZE; i++) {
+        equal[i]   = 7;
+        indices[i] = i;
+    }
+    radix_sort_by_key(equal, indices, SIZE, sizeof(int));
+    for (int i = 0; i < SIZE; i++)
+        assert(equal[i] == 7 && indices[i] == i);
+
+    // More threads than elements.
+    int64_t few[] = { 3, -1, 2 };
+    radix_sort(few, 3, 8);
+    assert(few[0] == -1 && few[1] == 2 && few[2] == 3);
+}
+
+uint64_t random64(void)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 5; i++)
+        value = (value << 15) ^ (uint64_t)rand();
+    return value;
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "parallel_for.hh"
+#include "radix_sort.hh"
+
+using namespace std;
+
+// Number of buckets per pass, i.e. one byte of the key.
+static const size_t RADIX = 256;
+
+// Fewest elements worth handing to a thread of its own.
+static const size_t MIN_ELEMENTS_PER_THREAD = 1 << 16;
+
+// Placeholder for sorts without indices.
+struct no_index {
+};
+
+template <class Key, class Index>
+static void lsd_sort(Key *keys, Index *indices, size_t nel, unsigned threads);
+template <class Key>
+static void lsd_sort_by_key(
+    Key *keys, void *payloads, size_t nel, size_t width, unsigned threads);
+template <class Key, class Index>
+static void sort_and_gather(
+    Key *keys, void *payloads, size_t nel, size_t width, unsigned threads);
+template <class Key> static void flip_sign_bits(Key *keys, size_t nel);
+static unsigned choose_threads(size_t nel, unsigned threads);
+
+void radix_sort(uint32_t *keys, size_t nel, unsigned threads)
+{
+    lsd_sort(keys, (no_index *)NULL, nel, choose_threads(nel, threads));
+}
+
+void radix_sort(uint64_t *keys, size_t nel, unsigned threads)
+{
+    lsd_sort(keys, (no_index *)NULL, nel, choose_threads(nel, threads));
+}
+
+void radix_sort(int32_t *keys, size_t nel, unsigned threads)
+{
+    // Flipping the sign bit maps two's complement order to unsigned order.
+    flip_sign_bits((uint32_t *)keys, nel);
+    radix_sort((uint32_t *)keys, nel, threads);
+    flip_sign_bits((uint32_t *)keys, nel);
+}
+
+void radix_sort(int64_t *keys, size_t nel, unsigned threads)
+{
+    flip_sign_bits((uint64_t *)keys, nel);
+    radix_sort((uint64_t *)keys, nel, threads);
+    flip_sign_bits((uint64_t *)keys, nel);
+}
+
+void radix_sort_by_key(uint32_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads)
+{
+    lsd_sort_by_key(
+        keys, payloads, nel, payload_width, choose_threads(nel, threads));
+}
+
+void radix_sort_by_key(uint64_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads)
+{
+    lsd_sort_by_key(
+        keys, payloads, nel, payload_width, choose_threads(nel, threads));
+}
+
+void radix_sort_by_key(int32_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads)
+{
+    flip_sign_bits((uint32_t *)keys, nel);
+    radix_sort_by_key((uint32_t *)keys, payloads, nel, payload_width, threads);
+    flip_sign_bits((uint32_t *)keys, nel);
+}
+
+void radix_sort_by_key(int64_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads)
+{
+    flip_sign_bits((uint64_t *)keys, nel);
+    radix_sort_by_key((uint64_t *)keys, payloads, nel, payload_width, threads);
+    flip_sign_bits((uint64_t *)keys, nel);
+}
+
+// Picks the narrowest type that can index every element.
+template <class Key>
+static void lsd_sort_by_key(
+    Key *keys, void *payloads, size_t nel, size_t width, unsigned threads)
+{
+    if (nel <= UINT32_MAX)
+        sort_and_gather<Key, uint32_t>(keys, payloads, nel, width, threads);
+    else
+        sort_and_gather<Key, uint64_t>(keys, payloads, nel, width, threads);
+}
+
+// Sorts the keys along with their original indices, then gathers the payloads
+// into their final order in a single pass.
+template <class Key, class Index>
+static void sort_and_gather(
+    Key *keys, void *payloads, size_t nel, size_t width, unsigned threads)
+{
+    Index *indices = (Index *)malloc(nel * sizeof(Index));
+    for (size_t i = 0; i < nel; i++)
+        indices[i] = i;
+
+    lsd_sort(keys, indices, nel, threads);
+
+    char *pay    = (char *)payloads;
+    char *temp   = (char *)malloc(nel * width);
+    size_t chunk = (nel + threads - 1) / threads;
+    parallel_for(threads, [&](unsigned t) {
+        size_t first = t * chunk, last = min(nel, first + chunk);
+        for (size_t i = first; i < last; i++)
+            memcpy(temp + i * width, pay + indices[i] * width, width);
+    });
+    memcpy(pay, temp, nel * width);
+
+    // Housekeeping.
+    free(temp);
+    free(indices);
+}
+
+template <class Key, class Index>
+static void lsd_sort(Key *keys, Index *indices, size_t nel, unsigned threads)
+{
+    constexpr size_t PASSES     = sizeof(Key);
+    constexpr bool WITH_INDICES = !is_same<Index, no_index>::value;
+
+    if (nel <= 1)
+        return;
+
+    // Histogram of every byte of every key, to find the passes that can be
+    // skipped because all keys share the same byte.
+    size_t chunk = (nel + threads - 1) / threads;
+    vector<size_t> counts(threads * PASSES * RADIX);
+    parallel_for(threads, [&](unsigned t) {
+        size_t *count = &counts[t * PASSES * RADIX];
+        size_t first = t * chunk, last = min(nel, first + chunk);
+        for (size_t i = first; i < last; i++)
+            for (size_t pass = 0; pass < PASSES; pass++)
+                count[pass * RADIX + ((keys[i] >> (8 * pass)) & 0xFF)]++;
+    });
+
+    vector<size_t> passes;
+    for (size_t pass = 0; pass < PASSES; pass++) {
+        size_t largest = 0;
+        for (size_t digit = 0; digit < RADIX; digit++) {
+            size_t total = 0;
+            for (unsigned t = 0; t < threads; t++)
+                total += counts[(t * PASSES + pass) * RADIX + digit];
+            largest = max(largest, total);
+        }
+        if (largest != nel)
+            passes.push_back(pass);
+    }
+
+    if (passes.empty())
+        return;
+
+    Key *key_aux     = (Key *)malloc(nel * sizeof(Key));
+    Index *index_aux = NULL;
+    if constexpr (WITH_INDICES)
+        index_aux = (Index *)malloc(nel * sizeof(Index));
+
+    Key *src_keys = keys, *dst_keys = key_aux;
+    Index *src_indices = indices, *dst_indices = index_aux;
+
+    // offsets[t * RADIX + digit] is where thread t scatters its next element
+    // with that digit.
+    vector<size_t> offsets(threads * RADIX);
+    for (size_t pass : passes) {
+        const unsigned shift = 8 * pass;
+
+        // Per-thread histograms of the current order. The first pass can
+        // reuse the ones computed above.
+        vector<size_t> histogram(threads * RADIX);
+        if (pass == passes.front()) {
+            for (unsigned t = 0; t < threads; t++)
+                memcpy(&histogram[t * RADIX],
+                    &counts[(t * PASSES + pass) * RADIX],
+                    RADIX * sizeof(size_t));
+        } else {
+            parallel_for(threads, [&](unsigned t) {
+                size_t *count = &histogram[t * RADIX];
+                size_t first = t * chunk, last = min(nel, first + chunk);
+                for (size_t i = first; i < last; i++)
+                    count[(src_keys[i] >> shift) & 0xFF]++;
+            });
+        }
+
+        // Exclusive prefix sums, by digit first and by thread second, which
+        // keeps the elements of every bucket in their original order.
+        size_t sum = 0;
+        for (size_t digit = 0; digit < RADIX; digit++)
+            for (unsigned t = 0; t < threads; t++) {
+                offsets[t * RADIX + digit] = sum;
+                sum += histogram[t * RADIX + digit];
+            }
+
+        // Scatter.
+        parallel_for(threads, [&](unsigned t) {
+            size_t *offset = &offsets[t * RADIX];
+            size_t first = t * chunk, last = min(nel, first + chunk);
+            for (size_t i = first; i < last; i++) {
+                size_t position = offset[(src_keys[i] >> shift) & 0xFF]++;
+                dst_keys[position] = src_keys[i];
+                if constexpr (WITH_INDICES)
+                    dst_indices[position] = src_indices[i];
+            }
+        });
+
+        swap(src_keys, dst_keys);
+        swap(src_indices, dst_indices);
+    }
+
+    // After an odd number of passes the result is in the auxiliary arrays.
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, nel * sizeof(Key));
+        if constexpr (WITH_INDICES)
+            memcpy(indices, src_indices, nel * sizeof(Index));
+    }
+
+    // Housekeeping.
+    free(key_aux);
+    free(index_aux);
+}
+
+template <class Key> static void flip_sign_bits(Key *keys, size_t nel)
+{
+    const Key SIGN_BIT = (Key)1 << (8 * sizeof(Key) - 1);
+    for (size_t i = 0; i < nel; i++)
+        keys[i] ^= SIGN_BIT;
+}
+
+static unsigned choose_threads(size_t nel, unsigned threads)
+{
+    if (threads == 0) {
+        threads = thread::hardware_concurrency();
+        threads = min<size_t>(threads, nel / MIN_ELEMENTS_PER_THREAD);
+    }
+    return max(threads, 1u);
+}
@@ -0,0 +1,35 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef RADIX_SORT_HH
+#define RADIX_SORT_HH
+
+/**
+ * LSD radix sort for integer keys, one byte per pass. Passes over bytes that
+ * are the same for every key are skipped.
+ *
+ * `threads` is the number of threads to use, 0 picks one based on the number
+ * of elements and the number of cores. Every pass computes per-thread
+ * histograms and scatters each thread's chunk of the input to its own range
+ * of every bucket, so the sort is stable regardless of the number of threads.
+ */
+void radix_sort(uint32_t *keys, size_t nel, unsigned threads = 0);
+void radix_sort(uint64_t *keys, size_t nel, unsigned threads = 0);
+void radix_sort(int32_t *keys, size_t nel, unsigned threads = 0);
+void radix_sort(int64_t *keys, size_t nel, unsigned threads = 0);
+
+/**
+ * Sorts `keys` with a stable radix sort, permuting `payloads` (of
+ * `payload_width` bytes each) in lockstep. Keys are sorted along with their
+ * original indices, so payloads are only moved once, at the end.
+ */
+void radix_sort_by_key(uint32_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads = 0);
+void radix_sort_by_key(uint64_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads = 0);
+void radix_sort_by_key(int32_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads = 0);
+void radix_sort_by_key(int64_t *keys, void *payloads, size_t nel,
+    size_t payload_width, unsigned threads = 0);
+
+#endif
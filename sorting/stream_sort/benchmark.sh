@@ -0,0 +1,33 @@
+#!/bin/sh
+# Times stream_sort against GNU sort on integers generated by rand.c.
+#
+# Usage: ./benchmark.sh [count] [modulus]
+set -e
+
+COUNT=${1:-10000000}
+MOD=${2:-1000000000}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+cc -O2 -o "$DIR/rand" ../../rand.c
+"$DIR/rand" "$COUNT" "$MOD" > "$DIR/numbers"
+
+# Prints the wall-clock seconds a command takes, with output discarded.
+measure() {
+    name=$1
+    shift
+    start=$(date +%s.%N)
+    "$@" > /dev/null
+    end=$(date +%s.%N)
+    awk -v name="$name" -v start="$start" -v end="$end" \
+        'BEGIN { printf "%-40s %8.3f s\n", name, end - start }'
+}
+
+echo "$COUNT integers modulo $MOD, $(nproc) core(s)"
+measure "sort -n" sort -n "$DIR/numbers"
+measure "sort -n (pipe)" sh -c "cat '$DIR/numbers' | sort -n"
+measure "stream_sort" ./stream_sort "$DIR/numbers"
+measure "stream_sort (pipe)" sh -c "cat '$DIR/numbers' | ./stream_sort"
+measure "stream_sort -S 16M (spilling runs)" ./stream_sort -S 16M \
+    "$DIR/numbers"
+measure "sort -n -S 16M (spilling runs)" sort -n -S 16M "$DIR/numbers"
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+#include "stream_sort.hh"
+
+static void usage(const char *program);
+static bool parse_arguments(
+    int argc, char **argv, struct stream_options *options, const char **output);
+static size_t parse_size(const char *string);
+
+int main(int argc, char **argv)
+{
+    const char *directory          = getenv("TMPDIR");
+    struct stream_options options  = { 0, 8, (size_t)1 << 30, 0,
+        directory && *directory ? directory : "/tmp" };
+    const char *output             = NULL;
+    if (!parse_arguments(argc, argv, &options, &output)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Read stdin if no input was given.
+    static const char *const STDIN_ONLY[] = { "-" };
+    const char *const *inputs = optind < argc ? argv + optind : STDIN_ONLY;
+    size_t count              = optind < argc ? argc - optind : 1;
+
+    return stream_sort(inputs, count, output, &options) ? 0 : 1;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [options] [file...]\n"
+        "Sorts newline-delimited integers (or binary records) from the files\n"
+        "or stdin, if none or \"-\" is given.\n"
+        "  -o, --output FILE      write to FILE instead of stdout\n"
+        "  -b, --binary W         sort records of W bytes instead of lines\n"
+        "  -k, --key-width K      width of the unsigned key at the start of\n"
+        "                         every record, 4 or 8 (default 8)\n"
+        "  -S, --memory N         memory for records before spilling sorted\n"
+        "                         runs to disk, K/M/G suffixes allowed\n"
+        "                         (default 1G)\n"
+        "  -T, --temporary-directory DIR\n"
+        "                         directory for the runs (default $TMPDIR or\n"
+        "                         /tmp)\n"
+        "      --threads N        threads to parse and sort with (default 1\n"
+        "                         per core)\n",
+        program);
+}
+
+static bool parse_arguments(
+    int argc, char **argv, struct stream_options *options, const char **output)
+{
+    static const struct option long_options[] = {
+        { "output", required_argument, NULL, 'o' },
+        { "binary", required_argument, NULL, 'b' },
+        { "key-width", required_argument, NULL, 'k' },
+        { "memory", required_argument, NULL, 'S' },
+        { "temporary-directory", required_argument, NULL, 'T' },
+        { "threads", required_argument, NULL, 't' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "o:b:k:S:T:", long_options, NULL))
+        != -1) {
+        switch (option) {
+        case 'o':
+            *output = optarg;
+            break;
+        case 'b':
+            options->record_width = parse_size(optarg);
+            break;
+        case 'k':
+            options->key_width = parse_size(optarg);
+            break;
+        case 'S':
+            options->memory = parse_size(optarg);
+            break;
+        case 'T':
+            options->temporary_directory = optarg;
+            break;
+        case 't':
+            options->threads = (unsigned)parse_size(optarg);
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (options->key_width != 4 && options->key_width != 8)
+        return false;
+
+    // Records must hold their key, and a slice of input must hold a record.
+    if (options->record_width != 0
+        && (options->record_width < options->key_width
+            || options->record_width > (1 << 20)))
+        return false;
+
+    return options->memory > 0;
+}
+
+// Parses a number of bytes with an optional K, M or G suffix.
+static size_t parse_size(const char *string)
+{
+    char *end;
+    double size = strtod(string, &end);
+    switch (*end) {
+    case 'G':
+    case 'g':
+        size *= 1024;
+        // fall through
+    case 'M':
+    case 'm':
+        size *= 1024;
+        // fall through
+    case 'K':
+    case 'k':
+        size *= 1024;
+    }
+    return (size_t)size;
+}
@@ -0,0 +1,653 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "parallel_for.hh"
+#include "radix_sort.hh"
+#include "stream_sort.hh"
+
+using namespace std;
+
+// Most bytes of input parsed at once.
+static const size_t SLICE = 64 << 20;
+
+// Size of the output buffer.
+static const size_t OUTPUT_BUFFER = 1 << 20;
+
+// Smallest read buffer of a run while merging.
+static const size_t MIN_RUN_BUFFER = 64 << 10;
+
+// Integers formatted by a thread at once, when writing from memory.
+static const size_t FORMAT_CHUNK = 1 << 16;
+
+// Longest decimal representation of a 64-bit integer, with sign and newline.
+static const size_t MAX_DIGITS = 21;
+
+// Buffered output to a file descriptor. After a failed write, every further
+// write is skipped and `failed` stays set.
+struct writer {
+    int fd;
+    char *buffer;
+    size_t used;
+    bool failed;
+};
+
+// A sorted run spilled to a temporary file, read back through a buffer
+// while merging.
+struct run {
+    int fd;
+    char *buffer;
+    size_t capacity;
+    size_t position;
+    size_t filled;
+};
+
+// Records held in memory and the runs already spilled to disk.
+struct sorter {
+    const struct stream_options *options;
+    unsigned threads;
+
+    // Bytes per record in memory: the record width, or 8 for integers.
+    size_t width;
+
+    char *records;
+    size_t count;
+    size_t capacity;
+
+    // Most bytes of input handed to add_integers() or add_records() at once,
+    // so that a slice always fits in an empty buffer.
+    size_t slice;
+
+    vector<int> runs;
+};
+
+static bool read_input(struct sorter *sorter, const char *path);
+static bool add_slice(struct sorter *sorter, const char *begin,
+    const char *end, const char *path, size_t offset);
+static bool add_integers(struct sorter *sorter, const char *begin,
+    const char *end, const char *path, size_t offset);
+static bool add_records(struct sorter *sorter, const char *begin,
+    const char *end, const char *path);
+static const char *parse_integers(
+    const char *p, const char *end, int64_t *values);
+static size_t slice_end(const struct sorter *sorter, const char *begin,
+    const char *end, bool last);
+static void sort_records(struct sorter *sorter);
+template <class Key> static void sort_by_key(struct sorter *sorter);
+static bool spill(struct sorter *sorter);
+static bool write_records(struct sorter *sorter, struct writer *writer);
+static bool merge_runs(struct sorter *sorter, struct writer *writer);
+template <class Key>
+static bool merge(struct sorter *sorter, struct run *runs, size_t count,
+    struct writer *writer);
+static bool refill(struct run *run, size_t width);
+static void put(struct writer *writer, const char *data, size_t size);
+static void put_integer(struct writer *writer, int64_t value);
+static char *format_integer(char *out, int64_t value);
+static void flush(struct writer *writer);
+static bool write_all(int fd, const char *data, size_t size);
+
+bool stream_sort(const char *const *inputs, size_t count, const char *output,
+    const struct stream_options *options)
+{
+    struct sorter sorter;
+    sorter.options = options;
+    sorter.threads = options->threads;
+    if (sorter.threads == 0)
+        sorter.threads = max(thread::hardware_concurrency(), 1u);
+    sorter.width = options->record_width ? options->record_width : 8;
+
+    // Radix sort needs an auxiliary array as large as the keys, and sorting
+    // records by key also needs the keys, their indices (and an auxiliary
+    // array for both) and a buffer to gather the records into.
+    size_t per_record = options->record_width
+        ? 2 * sorter.width + 2 * options->key_width + 2 * sizeof(uint64_t)
+        : 2 * sizeof(int64_t);
+    sorter.capacity = max(options->memory / per_record, (size_t)1024);
+    sorter.records  = (char *)malloc(sorter.capacity * sorter.width);
+    sorter.count    = 0;
+    if (sorter.records == NULL) {
+        fprintf(stderr, "stream_sort: cannot allocate %zu bytes\n",
+            sorter.capacity * sorter.width);
+        return false;
+    }
+
+    // Every line takes at least a byte, even a blank one which parses as
+    // invalid only after the slice is counted, so a slice of text holds no
+    // more lines than fit in the records.
+    sorter.slice = options->record_width
+        ? min(SLICE / sorter.width, sorter.capacity) * sorter.width
+        : min(SLICE, sorter.capacity);
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; i++)
+        ok = read_input(&sorter, inputs[i]);
+
+    struct writer writer = { STDOUT_FILENO, NULL, 0, false };
+    if (ok && output != NULL) {
+        writer.fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (writer.fd < 0) {
+            fprintf(stderr, "stream_sort: %s: %s\n", output, strerror(errno));
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        writer.buffer = (char *)malloc(OUTPUT_BUFFER);
+        ok = sorter.runs.empty() ? write_records(&sorter, &writer)
+                                 : merge_runs(&sorter, &writer);
+        flush(&writer);
+        if (writer.failed) {
+            fprintf(stderr, "stream_sort: write error: %s\n", strerror(errno));
+            ok = false;
+        }
+    }
+
+    // Housekeeping.
+    if (output != NULL && writer.fd >= 0 && writer.fd != STDOUT_FILENO)
+        close(writer.fd);
+    for (int fd : sorter.runs)
+        close(fd);
+    free(writer.buffer);
+    free(sorter.records);
+
+    return ok;
+}
+
+// Feeds every record of the input at `path` to the sorter, one slice at a
+// time. Regular files are mapped, anything else (pipes, terminals) is read
+// into a buffer, carrying over the partial record at the end of every read.
+static bool read_input(struct sorter *sorter, const char *path)
+{
+    bool stdin_input = strcmp(path, "-") == 0;
+    int fd           = stdin_input ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "stream_sort: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    bool ok = true;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = info.st_size;
+        char *data  = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "stream_sort: %s: %s\n", path, strerror(errno));
+            ok = false;
+        } else {
+            madvise(data, size, MADV_SEQUENTIAL);
+            for (size_t offset = 0; ok && offset < size;) {
+                size_t end = slice_end(
+                    sorter, data + offset, data + size, true);
+                if (end == 0) {
+                    fprintf(stderr, "stream_sort: %s: %s at byte %zu\n", path,
+                        sorter->options->record_width ? "truncated record"
+                                                      : "line too long",
+                        offset);
+                    ok = false;
+                    break;
+                }
+                ok = add_slice(
+                    sorter, data + offset, data + offset + end, path, offset);
+                offset += end;
+            }
+            munmap(data, size);
+        }
+    } else {
+        char *buffer  = (char *)malloc(sorter->slice);
+        size_t filled = 0, offset = 0;
+        bool eof      = false;
+        while (ok && !eof) {
+            ssize_t bytes = read(fd, buffer + filled, sorter->slice - filled);
+            if (bytes < 0 && errno == EINTR)
+                continue;
+            if (bytes < 0) {
+                fprintf(stderr, "stream_sort: %s: %s\n", path,
+                    strerror(errno));
+                ok = false;
+                break;
+            }
+            eof = bytes == 0;
+            filled += bytes;
+            if (!eof && filled < sorter->slice)
+                continue;
+
+            size_t end = slice_end(sorter, buffer, buffer + filled, eof);
+            if (end == 0 && filled == sorter->slice) {
+                fprintf(stderr, "stream_sort: %s: line too long at byte %zu\n",
+                    path, offset);
+                ok = false;
+                break;
+            }
+            ok = add_slice(sorter, buffer, buffer + end, path, offset);
+            memmove(buffer, buffer + end, filled - end);
+            filled -= end;
+            offset += end;
+        }
+
+        if (ok && filled > 0) {
+            fprintf(stderr, "stream_sort: %s: truncated record at byte %zu\n",
+                path, offset);
+            ok = false;
+        }
+        free(buffer);
+    }
+
+    if (!stdin_input)
+        close(fd);
+    return ok;
+}
+
+// Returns the length of the next slice of [begin, end): at most
+// sorter->slice bytes, ending after a newline or a whole record. If `last`
+// is set, the input ends at `end`, which may then end the slice as well.
+static size_t slice_end(const struct sorter *sorter, const char *begin,
+    const char *end, bool last)
+{
+    size_t size = end - begin;
+    if (size <= sorter->slice && last)
+        return sorter->options->record_width
+            ? size / sorter->width * sorter->width
+            : size;
+
+    size = min(size, sorter->slice);
+    if (sorter->options->record_width)
+        return size / sorter->width * sorter->width;
+
+    const char *newline = (const char *)memrchr(begin, '\n', size);
+    return newline ? newline + 1 - begin : 0;
+}
+
+static bool add_slice(struct sorter *sorter, const char *begin,
+    const char *end, const char *path, size_t offset)
+{
+    if (begin == end)
+        return true;
+    if (sorter->options->record_width)
+        return add_records(sorter, begin, end, path);
+    return add_integers(sorter, begin, end, path, offset);
+}
+
+// Parses the lines of [begin, end) in parallel, one share of the lines per
+// thread: every thread counts its lines first, so that it can then parse
+// them straight into their place in the buffer.
+static bool add_integers(struct sorter *sorter, const char *begin,
+    const char *end, const char *path, size_t offset)
+{
+    const unsigned threads = sorter->threads;
+    size_t size            = end - begin;
+
+    vector<const char *> bounds(threads + 1);
+    bounds[0]       = begin;
+    bounds[threads] = end;
+    for (unsigned t = 1; t < threads; t++) {
+        const char *p = begin + size / threads * t;
+        if (p == begin) {
+            bounds[t] = begin;
+            continue;
+        }
+        const char *newline
+            = (const char *)memchr(p - 1, '\n', end - (p - 1));
+        bounds[t] = max(newline ? newline + 1 : end, bounds[t - 1]);
+    }
+
+    vector<size_t> lines(threads + 1, 0);
+    parallel_for(threads, [&](unsigned t) {
+        size_t count = 0;
+        for (const char *p = bounds[t]; p < bounds[t + 1]; count++) {
+            const char *newline
+                = (const char *)memchr(p, '\n', bounds[t + 1] - p);
+            p = newline ? newline + 1 : bounds[t + 1];
+        }
+        lines[t + 1] = count;
+    });
+    for (unsigned t = 0; t < threads; t++)
+        lines[t + 1] += lines[t];
+
+    if (sorter->count + lines[threads] > sorter->capacity && !spill(sorter))
+        return false;
+
+    int64_t *values = (int64_t *)sorter->records + sorter->count;
+    vector<const char *> errors(threads, NULL);
+    parallel_for(threads, [&](unsigned t) {
+        errors[t] = parse_integers(bounds[t], bounds[t + 1], values + lines[t]);
+    });
+
+    for (const char *error : errors) {
+        if (error != NULL) {
+            fprintf(stderr, "stream_sort: %s: invalid integer at byte %zu\n",
+                path, offset + (error - begin));
+            return false;
+        }
+    }
+
+    sorter->count += lines[threads];
+    return true;
+}
+
+// Parses every line of [p, end) as a decimal integer, optionally preceded by
+// blanks and a minus sign. Returns the start of the first invalid line, or
+// NULL if every line is valid.
+static const char *parse_integers(
+    const char *p, const char *end, int64_t *values)
+{
+    while (p < end) {
+        const char *line = p;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+
+        bool negative = p < end && *p == '-';
+        p += negative;
+        if (p == end || *p < '0' || *p > '9')
+            return line;
+
+        // The magnitude of INT64_MIN is one more than INT64_MAX.
+        const uint64_t limit = (uint64_t)INT64_MAX + negative;
+        uint64_t value       = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            unsigned digit = *p - '0';
+            if (value > (limit - digit) / 10)
+                return line;
+            value = value * 10 + digit;
+        }
+
+        if (p < end && *p == '\r')
+            p++;
+        if (p < end && *p++ != '\n')
+            return line;
+
+        *values++ = negative ? (int64_t)(0 - value) : (int64_t)value;
+    }
+    return NULL;
+}
+
+static bool add_records(struct sorter *sorter, const char *begin,
+    const char *end, const char *path)
+{
+    size_t count = (end - begin) / sorter->width;
+    if (sorter->count + count > sorter->capacity && !spill(sorter))
+        return false;
+
+    memcpy(sorter->records + sorter->count * sorter->width, begin,
+        count * sorter->width);
+    sorter->count += count;
+    return true;
+}
+
+// Sorts the records in memory: integers with a radix sort of their own,
+// binary records by a radix sort of their keys.
+static void sort_records(struct sorter *sorter)
+{
+    if (!sorter->options->record_width)
+        radix_sort((int64_t *)sorter->records, sorter->count, sorter->threads);
+    else if (sorter->options->key_width == sizeof(uint32_t))
+        sort_by_key<uint32_t>(sorter);
+    else
+        sort_by_key<uint64_t>(sorter);
+}
+
+template <class Key> static void sort_by_key(struct sorter *sorter)
+{
+    Key *keys = (Key *)malloc(sorter->count * sizeof(Key));
+    for (size_t i = 0; i < sorter->count; i++)
+        memcpy(&keys[i], sorter->records + i * sorter->width, sizeof(Key));
+
+    radix_sort_by_key(keys, sorter->records, sorter->count, sorter->width,
+        sorter->threads);
+
+    free(keys);
+}
+
+// Sorts the records in memory and writes them to a new temporary file,
+// which is unlinked right away so that it goes away with the process.
+static bool spill(struct sorter *sorter)
+{
+    if (sorter->count == 0)
+        return true;
+
+    const char *directory = sorter->options->temporary_directory;
+    string path = string(directory) + "/stream_sort.XXXXXX";
+    int fd      = mkstemp(&path[0]);
+    if (fd < 0) {
+        fprintf(stderr, "stream_sort: %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    unlink(path.c_str());
+    sorter->runs.push_back(fd);
+
+    sort_records(sorter);
+    if (!write_all(fd, sorter->records, sorter->count * sorter->width)) {
+        fprintf(stderr, "stream_sort: %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    sorter->count = 0;
+    return true;
+}
+
+// Sorts the records in memory and writes them out. Integers are formatted
+// in parallel, every thread into a buffer of its own, and written in order.
+static bool write_records(struct sorter *sorter, struct writer *writer)
+{
+    sort_records(sorter);
+
+    if (sorter->options->record_width) {
+        flush(writer);
+        writer->failed = writer->failed
+            || !write_all(writer->fd, sorter->records,
+                sorter->count * sorter->width);
+        return true;
+    }
+
+    const int64_t *values = (const int64_t *)sorter->records;
+    const unsigned threads = sorter->threads;
+    vector<char *> buffers(threads);
+    vector<size_t> sizes(threads);
+    for (unsigned t = 0; t < threads; t++)
+        buffers[t] = (char *)malloc(FORMAT_CHUNK * MAX_DIGITS);
+
+    for (size_t first = 0; first < sorter->count && !writer->failed;
+         first += threads * FORMAT_CHUNK) {
+        parallel_for(threads, [&](unsigned t) {
+            size_t begin = min(first + t * FORMAT_CHUNK, sorter->count);
+            size_t end   = min(begin + FORMAT_CHUNK, sorter->count);
+            char *out    = buffers[t];
+            for (size_t i = begin; i < end; i++)
+                out = format_integer(out, values[i]);
+            sizes[t] = out - buffers[t];
+        });
+        for (unsigned t = 0; t < threads; t++)
+            put(writer, buffers[t], sizes[t]);
+    }
+
+    for (char *buffer : buffers)
+        free(buffer);
+    return true;
+}
+
+// Spills what is left in memory, then merges all the runs. The memory of
+// the records is handed to the read buffers of the runs.
+static bool merge_runs(struct sorter *sorter, struct writer *writer)
+{
+    if (!spill(sorter))
+        return false;
+    free(sorter->records);
+    sorter->records = NULL;
+
+    const size_t count = sorter->runs.size();
+    size_t buffer = max(sorter->options->memory / (count + 1), MIN_RUN_BUFFER);
+    buffer        = max(buffer / sorter->width, (size_t)1) * sorter->width;
+
+    vector<struct run> runs(count);
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        runs[i] = { sorter->runs[i], (char *)malloc(buffer), buffer, 0, 0 };
+        ok      = ok && lseek(runs[i].fd, 0, SEEK_SET) == 0
+            && refill(&runs[i], sorter->width);
+    }
+
+    if (ok && !sorter->options->record_width)
+        ok = merge<int64_t>(sorter, runs.data(), count, writer);
+    else if (ok && sorter->options->key_width == sizeof(uint32_t))
+        ok = merge<uint32_t>(sorter, runs.data(), count, writer);
+    else if (ok)
+        ok = merge<uint64_t>(sorter, runs.data(), count, writer);
+
+    if (!ok)
+        fprintf(stderr, "stream_sort: cannot read back a run: %s\n",
+            strerror(errno));
+
+    for (struct run &run : runs)
+        free(run.buffer);
+    return ok;
+}
+
+// Merges the runs with a binary heap of their heads. Ties go to the earlier
+// run, which holds the records that came earlier in the input, so the sort
+// stays stable. Returns false if a run cannot be read.
+template <class Key>
+static bool merge(struct sorter *sorter, struct run *runs, size_t count,
+    struct writer *writer)
+{
+    const size_t width = sorter->width;
+    const bool integers = !sorter->options->record_width;
+
+    auto key = [&](size_t r) {
+        Key key;
+        memcpy(&key, runs[r].buffer + runs[r].position, sizeof(Key));
+        return key;
+    };
+    auto less = [&](size_t a, size_t b) {
+        Key x = key(a), y = key(b);
+        return x < y || (x == y && a < b);
+    };
+    auto sift_down = [&](vector<size_t> &heap, size_t i) {
+        for (size_t child; (child = 2 * i + 1) < heap.size(); i = child) {
+            if (child + 1 < heap.size() && less(heap[child + 1], heap[child]))
+                child++;
+            if (!less(heap[child], heap[i]))
+                break;
+            swap(heap[i], heap[child]);
+        }
+    };
+
+    vector<size_t> heap;
+    for (size_t r = 0; r < count; r++)
+        if (runs[r].filled > 0)
+            heap.push_back(r);
+    for (size_t i = heap.size() / 2; i-- > 0;)
+        sift_down(heap, i);
+
+    while (!heap.empty() && !writer->failed) {
+        struct run *run = &runs[heap[0]];
+        if (integers)
+            put_integer(writer, key(heap[0]));
+        else
+            put(writer, run->buffer + run->position, width);
+
+        run->position += width;
+        if (run->position == run->filled && !refill(run, width))
+            return false;
+        if (run->filled == 0) {
+            heap[0] = heap.back();
+            heap.pop_back();
+        }
+        sift_down(heap, 0);
+    }
+    return true;
+}
+
+// Reads the next records of the run into its buffer. At the end of the run,
+// `filled` is left at 0.
+static bool refill(struct run *run, size_t width)
+{
+    run->position = 0;
+    run->filled   = 0;
+    while (run->filled < run->capacity) {
+        ssize_t bytes = read(
+            run->fd, run->buffer + run->filled, run->capacity - run->filled);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+            return false;
+        if (bytes == 0)
+            break;
+        run->filled += bytes;
+    }
+
+    // Runs hold whole records, so a partial one means the file is broken.
+    return run->filled % width == 0;
+}
+
+static void put(struct writer *writer, const char *data, size_t size)
+{
+    if (size > OUTPUT_BUFFER - writer->used) {
+        flush(writer);
+        if (size > OUTPUT_BUFFER) {
+            writer->failed
+                = writer->failed || !write_all(writer->fd, data, size);
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->used, data, size);
+    writer->used += size;
+}
+
+static void put_integer(struct writer *writer, int64_t value)
+{
+    if (OUTPUT_BUFFER - writer->used < MAX_DIGITS)
+        flush(writer);
+    writer->used
+        = format_integer(writer->buffer + writer->used, value) - writer->buffer;
+}
+
+// Writes value and a newline to out, and returns the end of the output.
+static char *format_integer(char *out, int64_t value)
+{
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    if (value < 0)
+        *out++ = '-';
+
+    char digits[MAX_DIGITS];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    while (count)
+        *out++ = digits[--count];
+    *out++ = '\n';
+    return out;
+}
+
+static void flush(struct writer *writer)
+{
+    if (!writer->failed && writer->used > 0)
+        writer->failed = !write_all(writer->fd, writer->buffer, writer->used);
+    writer->used = 0;
+}
+
+static bool write_all(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t bytes = write(fd, data, size);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes < 0)
+            return false;
+        data += bytes;
+        size -= bytes;
+    }
+    return true;
+}
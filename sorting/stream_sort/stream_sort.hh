@@ -0,0 +1,40 @@
+/**
+ * Sorts streams of integers or fixed-width binary records that may not fit
+ * in memory.
+ */
+
+#include <cstddef>
+
+#ifndef STREAM_SORT_HH
+#define STREAM_SORT_HH
+
+struct stream_options {
+    // Width of every binary record in bytes, or 0 for newline-delimited
+    // decimal integers, which are sorted as signed 64-bit integers.
+    size_t record_width;
+
+    // Width of the key at the start of every binary record, 4 or 8 bytes.
+    // Keys are unsigned integers in the byte order of the machine.
+    size_t key_width;
+
+    // Approximate number of bytes the records (and the sort's auxiliary
+    // arrays) may take in memory. Beyond that, sorted runs are spilled to
+    // temporary files and merged at the end.
+    size_t memory;
+
+    // Number of threads to parse and sort with, 0 for one per core.
+    unsigned threads;
+
+    // Directory for the temporary files.
+    const char *temporary_directory;
+};
+
+// Sorts the concatenation of `count` inputs (paths, "-" for stdin) into the
+// file at `output` (NULL for stdout), which is only opened once every input
+// has been read, so it may be one of the inputs. Regular files are mapped
+// into memory, everything else is read. Equal keys keep their input order.
+// Returns false after printing an error message to stderr on failure.
+bool stream_sort(const char *const *inputs, size_t count, const char *output,
+    const struct stream_options *options);
+
+#endif
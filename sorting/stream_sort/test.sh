@@ -0,0 +1,99 @@
+#!/bin/sh
+# Compares the output of stream_sort against GNU sort on generated inputs,
+# both in memory and with runs spilled to disk.
+set -e
+
+SORT=./stream_sort
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# Random integers, including negative ones and the extremes.
+awk 'BEGIN { srand(); for (i = 0; i < 200000; i++)
+    printf "%d\n", int((rand() - 0.5) * 2e15) }' > "$DIR/numbers"
+printf '9223372036854775807\n-9223372036854775808\n0\n  -7\n' >> "$DIR/numbers"
+sort -n "$DIR/numbers" | sed 's/^ *//' > "$DIR/expected"
+
+check() {
+    if ! cmp -s "$DIR/expected" "$DIR/actual"; then
+        echo "FAILED: $1"
+        exit 1
+    fi
+}
+
+$SORT "$DIR/numbers" > "$DIR/actual"
+check "mapped file"
+
+cat "$DIR/numbers" | $SORT > "$DIR/actual"
+check "stdin"
+
+$SORT --threads 3 -S 64K "$DIR/numbers" > "$DIR/actual"
+check "spilled runs"
+
+cat "$DIR/numbers" | $SORT --threads 2 -S 1M -T "$DIR" > "$DIR/actual"
+check "spilled runs from stdin"
+
+# Several inputs, one without a trailing newline, and the output written
+# over one of the inputs.
+head -n 1000 "$DIR/numbers" > "$DIR/first"
+printf '5\n-5\n17' > "$DIR/second"
+cat "$DIR/first" "$DIR/second" | sort -n | sed 's/^ *//' > "$DIR/expected"
+$SORT -o "$DIR/first" "$DIR/first" - < "$DIR/second"
+mv "$DIR/first" "$DIR/actual"
+check "several inputs"
+
+# Empty input.
+$SORT < /dev/null > "$DIR/actual"
+: > "$DIR/expected"
+check "empty input"
+
+# Invalid integers are reported.
+if printf '1\n2x\n' | $SORT > /dev/null 2>&1; then
+    echo "FAILED: invalid input"
+    exit 1
+fi
+if printf '99999999999999999999\n' | $SORT > /dev/null 2>&1; then
+    echo "FAILED: overflow"
+    exit 1
+fi
+
+# Blank lines, a byte each, are as many lines as records fit in a slice:
+# they must be reported rather than overflow the records.
+awk 'BEGIN { for (i = 0; i < 1022; i++) print ""
+             for (i = 0; i < 512; i++) print 1 }' > "$DIR/blank"
+if $SORT -S 16K --threads 2 "$DIR/blank" > /dev/null 2> "$DIR/error" \
+    || ! grep -q 'invalid integer at byte 0$' "$DIR/error"; then
+    echo "FAILED: blank lines"
+    exit 1
+fi
+
+# Binary records of 16 bytes: the key must be sorted and the records must be
+# the same, and records with equal keys must keep their order.
+head -c 1600000 /dev/urandom > "$DIR/records"
+for width in 4 8; do
+    for memory in 1G 256K; do
+        $SORT -b 16 -k $width -S $memory "$DIR/records" > "$DIR/sorted"
+        od -An -v -t u$width -w16 "$DIR/sorted" | awk '{ print $1 }' \
+            > "$DIR/keys"
+        sort -c -n "$DIR/keys" || { echo "FAILED: binary keys"; exit 1; }
+        od -An -v -t x1 -w16 "$DIR/records" | sort > "$DIR/expected"
+        od -An -v -t x1 -w16 "$DIR/sorted" | sort > "$DIR/actual"
+        check "binary records, $width byte keys, $memory"
+    done
+done
+
+# Stability: keys with few distinct values, and the index in the payload.
+awk 'BEGIN { srand(); for (i = 0; i < 50000; i++)
+    printf "%08x%08x\n", int(rand() * 4), i }' \
+    | xxd -r -p > "$DIR/records" 2> /dev/null || true
+if [ -s "$DIR/records" ]; then
+    $SORT -b 8 -k 4 -S 64K "$DIR/records" > "$DIR/sorted"
+    od -An -v -t u4 -w8 "$DIR/sorted" | awk '{ print $1 }' > "$DIR/keys"
+    sort -c -n "$DIR/keys" || { echo "FAILED: stable keys"; exit 1; }
+    od -An -v -t x1 -w8 "$DIR/sorted" \
+        | awk '{ key = $1 $2 $3 $4; index_ = $5 $6 $7 $8
+                 if (key == last && index_ <= previous) exit 1
+                 last = key; previous = index_ }' \
+        || { echo "FAILED: stability"; exit 1; }
+fi
+
+echo "All tests passed!"